@@ -0,0 +1,221 @@
+#include "core.hpp"
+#include "cpu.hpp"
+#include "address_space.hpp"
+#include "devices/memory.hpp"
+#include "devices/uart.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace arm;
+
+namespace {
+
+    constexpr u32 Repetitions = 5;
+
+    struct BenchmarkResult {
+        std::string name;
+        u64 operations;
+        double nsPerOp;
+        bool instructions;
+    };
+
+    volatile u64 sink;
+
+    // Runs the benchmark a few times and keeps the fastest repetition to reduce noise
+    BenchmarkResult runBenchmark(const std::string &name, u64 operations, bool instructions, const std::function<void(u64)> &body) {
+        body(operations / 10);
+
+        double bestTime = std::numeric_limits<double>::max();
+        for (u32 repetition = 0; repetition < Repetitions; repetition++) {
+            auto start = std::chrono::steady_clock::now();
+            body(operations);
+            auto end = std::chrono::steady_clock::now();
+
+            bestTime = std::min(bestTime, std::chrono::duration<double, std::nano>(end - start).count());
+        }
+
+        return { name, operations, bestTime / operations, instructions };
+    }
+
+    void benchmarkDecode(std::vector<BenchmarkResult> &results) {
+        dev::Memory memory(1_MiB);
+        AddressSpace addressSpace;
+        addressSpace.addDevice(&memory, 0x00);
+        Core core(&addressSpace);
+
+        const auto patterns = Core::getInstructionPatterns();
+
+        results.push_back(runBenchmark("Core::decode/full_lut", 10'000'000, true, [&](u64 iterations) {
+            u64 index = 0;
+            for (u64 i = 0; i < iterations; i++) {
+                sink = core.decode(patterns[index].pattern) != nullptr;
+                if (++index == patterns.size())
+                    index = 0;
+            }
+        }));
+    }
+
+    void benchmarkExecute(std::vector<BenchmarkResult> &results) {
+        dev::Memory memory(1_MiB);
+        AddressSpace addressSpace;
+        addressSpace.addDevice(&memory, 0x00);
+        Core core(&addressSpace);
+
+        const auto patterns = Core::getInstructionPatterns();
+
+        // Each LUT pattern with all operand fields zero is a valid instance of its class
+        for (size_t index = 0; index < patterns.size(); index++) {
+            const auto &pattern = patterns[index];
+            const inst_t instruction = pattern.pattern;
+            const InstructionHandler handler = core.decode(instruction);
+
+            // Classes with several encodings (e.g. the immediate offset and pre / post index forms) get their LUT index appended
+            const bool ambiguous = std::count_if(patterns.begin(), patterns.end(), [&](const auto &other) { return std::string_view(other.name) == pattern.name; }) > 1;
+            const std::string name = std::string("Core::execute/") + pattern.name + (ambiguous ? "/" + std::to_string(index) : "");
+
+            results.push_back(runBenchmark(name, 10'000'000, true, [&](u64 iterations) {
+                for (u64 i = 0; i < iterations; i++)
+                    core.execute(handler, instruction);
+            }));
+        }
+    }
+
+    void benchmarkAddressSpace(std::vector<BenchmarkResult> &results) {
+        dev::Memory memory(1_MiB);
+        dev::UART uart;
+        uart.setOutput(-1);
+        AddressSpace addressSpace;
+        addressSpace.addDevice(&memory, 0x0000'0000);
+        addressSpace.addDevice(&uart,   0x8000'0000);
+
+        results.push_back(runBenchmark("AddressSpace::read/ram", 10'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                sink = addressSpace.read((i * 8) & (1_MiB - 1), sizeof(u64));
+        }));
+        results.push_back(runBenchmark("AddressSpace::write/ram", 10'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                addressSpace.write((i * 8) & (1_MiB - 1), sizeof(u64), i);
+        }));
+        results.push_back(runBenchmark("AddressSpace::read/mmio", 10'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                sink = addressSpace.read(0x8000'0000, sizeof(u8));
+        }));
+        results.push_back(runBenchmark("AddressSpace::write/mmio", 1'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                addressSpace.write(0x8000'0000, sizeof(u8), 'A');
+        }));
+
+        if (!addressSpace.enableFastmem())
+            return;
+
+        results.push_back(runBenchmark("AddressSpace::read/ram_fastmem", 10'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                sink = addressSpace.read((i * 8) & (1_MiB - 1), sizeof(u64));
+        }));
+        results.push_back(runBenchmark("AddressSpace::write/ram_fastmem", 10'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                addressSpace.write((i * 8) & (1_MiB - 1), sizeof(u64), i);
+        }));
+        results.push_back(runBenchmark("AddressSpace::read/mmio_fastmem", 1'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                sink = addressSpace.read(0x8000'0000, sizeof(u8));
+        }));
+    }
+
+    void benchmarkMemory(std::vector<BenchmarkResult> &results) {
+        dev::Memory memory(1_MiB);
+
+        for (size_t width : { 1, 2, 4, 8 }) {
+            results.push_back(runBenchmark("Memory::read/" + std::to_string(width * 8), 10'000'000, false, [&](u64 iterations) {
+                for (u64 i = 0; i < iterations; i++)
+                    sink = memory.read((i * width) & (1_MiB - 1), width);
+            }));
+            results.push_back(runBenchmark("Memory::write/" + std::to_string(width * 8), 10'000'000, false, [&](u64 iterations) {
+                for (u64 i = 0; i < iterations; i++)
+                    memory.write((i * width) & (1_MiB - 1), width, i);
+            }));
+        }
+
+        memory.enableDirtyTracking(4_kiB);
+        results.push_back(runBenchmark("Memory::write/64_dirty", 10'000'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                memory.write((i * 8) & (1_MiB - 1), 8, i);
+        }));
+        results.push_back(runBenchmark("Memory::collectAndClearDirty", 100'000, false, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++) {
+                memory.write((i * 4_kiB) & (1_MiB - 1), 8, i);
+                sink = memory.collectAndClearDirty().size();
+            }
+        }));
+        memory.disableDirtyTracking();
+    }
+
+    void benchmarkCpu(std::vector<BenchmarkResult> &results) {
+        dev::Memory memory(1_MiB);
+        Cpu cpu(1);
+        cpu.addDeviceToAddressSpace(&memory, 0x00);
+
+        memory.load({
+            0x91000400, // loop: add x0, x0, #1
+            0xD1000421, //       sub x1, x1, #1
+            0xAA0003E2, //       mov x2, x0
+            0xF9040060, //       str x0, [x3, #0x800]
+            0xF9440064, //       ldr x4, [x3, #0x800]
+            0x54FFFF6E, //       b.al loop
+        });
+
+        cpu.reset();
+        cpu.getCore(0).exitDebugMode();
+
+        results.push_back(runBenchmark("Cpu::tick/alu_loop", 10'000'000, true, [&](u64 iterations) {
+            for (u64 i = 0; i < iterations; i++)
+                cpu.tick();
+        }));
+    }
+
+    void writeResults(FILE *file, const std::vector<BenchmarkResult> &results) {
+        fprintf(file, "{\n  \"benchmarks\": [");
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            fprintf(file, "%s\n    { \"name\": \"%s\", \"operations\": %llu, \"ns_per_op\": %.3f, \"%s\": %.3f }", i == 0 ? "" : ",",
+                    result.name.c_str(), static_cast<unsigned long long>(result.operations), result.nsPerOp,
+                    result.instructions ? "mips" : "mops", 1'000.0 / result.nsPerOp);
+        }
+        fprintf(file, "\n  ]\n}\n");
+    }
+
+}
+
+int main(int argc, char **argv) {
+    // Keep device logging (SVC) and the warnings about unimplemented system registers the MRS / MSR benchmarks access
+    // on every iteration out of the measurements and the JSON on stdout
+    Logger::setLogLevel(LogLevel::Error);
+
+    std::vector<BenchmarkResult> results;
+    benchmarkDecode(results);
+    benchmarkExecute(results);
+    benchmarkAddressSpace(results);
+    benchmarkMemory(results);
+    benchmarkCpu(results);
+
+    FILE *file = stdout;
+    if (argc > 1) {
+        file = fopen(argv[1], "w");
+        if (file == nullptr)
+            Logger::fatal("File %s cannot be written!", argv[1]);
+    }
+
+    writeResults(file, results);
+
+    if (file != stdout)
+        fclose(file);
+
+    return 0;
+}
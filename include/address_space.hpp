@@ -2,8 +2,11 @@
 
 #include <arm.hpp>
 #include "devices/device.hpp"
+#include "fastmem.hpp"
 
 #include <array>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
 namespace arm {
@@ -14,8 +17,20 @@ namespace arm {
 
         u64 read(addr_t address, size_t size);
         void write(addr_t address, size_t size, u64 value);
+        u8* getHostPointer(addr_t address, size_t size, bool write);
+        void commitWrite(addr_t address, size_t size);
+
+        // Blocks were translated from the page holding address, the handler gets called with the page on the first write to it
+        using CodeWriteHandler = std::function<void(addr_t page)>;
+        void markCode(addr_t address);
+        void setCodeWriteHandler(CodeWriteHandler handler);
+
+        // Mirrors host memory backed devices in a guard page arena so accesses to them skip the device lookup
+        bool enableFastmem();
     private:
         std::unordered_map<addr_t, Device*> m_memoryRegions;
+        std::unique_ptr<Fastmem> m_fastmem;
+        CodeWriteHandler m_codeWriteHandler;
     };
 
 }
\ No newline at end of file
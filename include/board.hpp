@@ -5,9 +5,14 @@
 #include "cpu.hpp"
 #include "core.hpp"
 #include "address_space.hpp"
+#include "scheduler.hpp"
+
+#include <chrono>
 
 namespace arm {
 
+    constexpr auto IdleSleepPeriod = std::chrono::milliseconds(1);
+
     class Board {
     public:
         Board();
@@ -18,6 +23,8 @@ namespace arm {
 
         void tick();
 
+        Scheduler& getScheduler();
+
         Cpu CPU = Cpu(1);
         Device *BROM;
         Device *IRAM;
@@ -25,9 +32,11 @@ namespace arm {
         Device *FLASH;
 
         Device *UART1;
+        Device *GIC;
 
     private:
         bool m_powered = false;
+        Scheduler m_scheduler;
     };
 
 }
\ No newline at end of file
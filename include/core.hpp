@@ -4,18 +4,33 @@
 
 #include "register.hpp"
 #include "address_space.hpp"
+#include "scheduler.hpp"
+#include "generic_timer.hpp"
+#include "system_registers.hpp"
+#include "mmu.hpp"
+#include "ir.hpp"
+#include <array>
+#include <atomic>
 #include <functional>
+#include <limits>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace arm {
 
     namespace ui { class Window; }
+    class Lockstep;
 
     #define INSTRUCTION(mask, pattern, name) InstructionPattern{ mask, pattern, &Core::name, #name }
     #define INSTRUCTION_DECL(name) void name(const inst_t &inst, const u8 &Rd, const u8 &Rn, const u8 &Rm, const bool &sf, const u8 &imm3, const u8 &imm6, const u16 &imm12, const u8 &shift, const u8 &size)
     #define INSTRUCTION_DEF(name) void Core::name(const inst_t &inst, const u8 &Rd, const u8 &Rn, const u8 &Rm, const bool &sf, const u8 &imm3, const u8 &imm6, const u16 &imm12, const u8 &shift, const u8 &size)
 
     class Core;
+    class Profiler;
     using InstructionHandler = void (Core::*)(const inst_t &inst, const u8 &Rd, const u8 &Rn, const u8 &Rm, const bool &sf, const u8 &imm3, const u8 &imm6, const u16 &imm12, const u8 &shift, const u8 &size);
 
     struct InstructionPattern {
@@ -25,6 +40,75 @@ namespace arm {
         const char *name;
     };
 
+    enum class ExecutionEngine {
+        Interpreter,
+        BlockCache
+    };
+
+    struct DecodedInstruction {
+        InstructionHandler handler;
+        inst_t instruction;
+        u16 patternIndex;
+    };
+
+    // A block that branches back to itself and does nothing but copy or fill memory, see Core::analyzeMemoryLoop
+    struct MemoryLoop {
+        struct Store {
+            u16 offset;
+            u8 size;
+            u8 reg;
+        };
+
+        struct Update {
+            u8 reg;
+            s64 delta;
+            bool sf;
+        };
+
+        u8 destination;
+        std::optional<u8> source;
+        std::vector<Store> pattern;
+        u16 stride;
+        u16 alignment;
+
+        // Runs while counter != 0 / counter > 0 counting down by step, or while counter != end / counter < end counting up
+        u8 counter;
+        std::optional<u8> end;
+        u8 condition;
+        u64 step;
+        bool is64;
+
+        std::vector<Update> updates;
+    };
+
+    struct TranslationBlock {
+        std::vector<DecodedInstruction> instructions;
+        std::optional<MemoryLoop> memoryLoop;
+        std::optional<ir::Block> ir;
+        bool global = false;
+    };
+
+    struct MemoryWrite {
+        addr_t address;
+        size_t size;
+        u64 value;
+
+        bool operator==(const MemoryWrite &other) const = default;
+    };
+
+    struct InstructionStatistics {
+        u64 executions;
+        u64 memoryBytes;
+    };
+
+    // Offsets into the vector table relative to the selected 0x200 byte group
+    enum class ExceptionType : u16 {
+        Synchronous = 0x000,
+        IRQ         = 0x080,
+        FIQ         = 0x100,
+        SError      = 0x180
+    };
+
     struct PSTATE {
         u8 N : 1;
         u8 Z : 1;
@@ -78,21 +162,58 @@ namespace arm {
         u8 N : 1;
     };
 
+    constexpr u32 MaxBlockInstructions = 64;
+    constexpr u32 UntranslatedContext = 0xFFFF'FFFF;
+    constexpr u32 FPCRHostControlMask = 0b1'11 << 22;   // FZ and RMode, the FPCR fields the host FPU implements
+    constexpr u32 ZeroBlockSize = 64;  // Bytes cleared by DC ZVA, advertised in DCZID_EL0
+    constexpr u16 MaxMemoryLoopStride = 512;
+    constexpr u64 MinimumMemoryLoopIterations = 4;
     constexpr u8 NumBreakpoints = 0x10;
     constexpr u8 TemporarySteppingBreakpointId = NumBreakpoints;
 
     class Core {
     public:
         Core(AddressSpace *addressSpace);
+        ~Core();
 
         void reset();
         void halt();
         void tick();
+        void run(const Scheduler &scheduler);
+
+        // Implements EL2 and starts out in it after reset, otherwise EL1 is the highest exception level
+        void enableVirtualization(bool enabled);
 
-        [[nodiscard]] inst_t prefetch(const addr_t &pc) const;
+        [[nodiscard]] bool isHalted() const;
+        [[nodiscard]] bool isIdle() const;
+        [[nodiscard]] vtime_t getVirtualTime() const;
+
+        [[nodiscard]] inst_t prefetch(const addr_t &pc);
         [[nodiscard]] InstructionHandler decode(const inst_t &instruction);
         void execute(const InstructionHandler &type, const inst_t &instruction);
 
+        [[nodiscard]] static std::span<const InstructionPattern> getInstructionPatterns();
+        [[nodiscard]] static const char* getInstructionName(inst_t instruction);
+
+        void setExecutionEngine(ExecutionEngine engine);
+        [[nodiscard]] ExecutionEngine getExecutionEngine() const;
+        void flushBlockCache();
+
+        void attachScheduler(Scheduler *scheduler);
+        [[nodiscard]] GenericTimer& getTimer();
+
+        /* Interrupts and events, may be called from any thread */
+        void setInterruptPending(bool pending);
+        void signalEvent();
+
+        /* Maintenance operations other cores may be asked to perform, they take effect at this core's next block boundary */
+        using BroadcastHandler = std::function<void(const std::function<void(Core&)> &operation)>;
+        void setBroadcastHandler(BroadcastHandler handler);
+        void invalidateTranslations(u16 vmid, std::optional<u16> asid = std::nullopt);
+        void invalidateTranslation(u16 vmid, addr_t address, std::optional<u16> asid = std::nullopt);
+        void invalidateBlocks(std::optional<addr_t> address = std::nullopt);
+        void invalidateCode(addr_t physicalPage);
+
         /* Debug commands */
         void enterDebugMode();
         void exitDebugMode();
@@ -103,24 +224,147 @@ namespace arm {
         void singleStep();
         void dumpRegisters();
 
+        /* Profiling */
+        void attachProfiler(Profiler *profiler);
+        [[nodiscard]] u64 getRetiredInstructionCount() const;
+
+        /* Statistics */
+        void enableInstructionStatistics(bool enabled);
+        void dumpInstructionStatistics(const std::string &path, bool json) const;
+
         constexpr core::RegisterDouble& GPZR(u8 R) {
             return GPR[R];
         }
 
         constexpr core::RegisterDouble& GPSP(u8 R) {
-            return GPR[R < 31 ? R : 32 + PSTATE.EL];
+            return GPR[R < 31 ? R : 32 + (PSTATE.SP ? PSTATE.EL : 0)];
         }
 
     private:
         friend class arm::ui::Window;
-
-        void setNZCVFlags(u32 oldValue, u32 newValue);
-        void setNZCVFlags(u64 oldValue, u64 newValue);
+        friend class arm::Lockstep;
+
+        // No address and no ASID drops every entry, otherwise only those of the VMID the operation was issued under
+        struct TranslationInvalidation {
+            u16 vmid = 0;
+            std::optional<u16> asid = std::nullopt;
+            std::optional<addr_t> address = std::nullopt;
+        };
+
+        struct BlockInvalidation {
+            std::optional<u16> vmid = std::nullopt;
+            std::optional<u16> asid = std::nullopt;
+            std::optional<addr_t> address = std::nullopt;
+            std::optional<addr_t> physicalPage = std::nullopt;
+        };
+
+        [[nodiscard]] static std::optional<u16> findInstructionPattern(inst_t instruction);
+        [[nodiscard]] static bool isBlockTerminator(InstructionHandler handler);
+        void step();
+        const TranslationBlock& getTranslationBlock(addr_t address);
+        void executeBlock(const TranslationBlock &block);
+        [[nodiscard]] static std::optional<MemoryLoop> analyzeMemoryLoop(addr_t address, const TranslationBlock &block);
+        void runMemoryLoop(const MemoryLoop &loop, size_t blockLength);
+        [[nodiscard]] static InstructionHandler specializeHandler(InstructionHandler handler, inst_t instruction);
+        [[nodiscard]] std::optional<ir::Block> lowerBlock(addr_t address, const TranslationBlock &block);
+        void executeIrBlock(const TranslationBlock &block);
+        [[nodiscard]] bool canRepeatBlock(size_t blockLength) const;
+        void retire();
+
+        [[nodiscard]] u64 addWithCarry(u64 x, u64 y, bool carry, bool sf, bool setFlags);
+        template<bool sf, bool setFlags> [[nodiscard]] u64 addWithCarry(u64 x, u64 y, bool carry);
+        void setNZFlags(u64 result, bool sf);
+        [[nodiscard]] static u64 shiftRegister(u64 value, u8 shiftType, u8 amount, bool sf);
+        [[nodiscard]] static u64 extendRegister(u64 value, u8 option, u8 amount);
         [[nodiscard]] bool doesConditionHold(u8 cond) const;
         [[nodiscard]] u64 decodeImmediateWMask(u32 N, u32 imms, u32 immr);
+        [[nodiscard]] static u64 multiplyHigh(u64 operand1, u64 operand2, bool isSigned);
+        [[nodiscard]] static u64 reverseBits(u64 value);
+
+        void takeException(ExceptionType type, u8 targetEL);
+        void takeAbort(const TranslationFault &fault);
+        void broadcast(const std::function<void(Core&)> &operation);
+        void updateTranslationRegime();
+        void updateBlockContext();
+        void queueTranslationInvalidation(const TranslationInvalidation &invalidation);
+        void applyTranslationInvalidation(const TranslationInvalidation &invalidation);
+        void applyTranslationInvalidations();
+        void queueBlockInvalidation(const BlockInvalidation &invalidation);
+        void applyBlockInvalidations();
+        [[nodiscard]] u64 getProcessState() const;
+        void setProcessState(u64 value);
+
+        [[nodiscard]] u64 readSystemRegister(u16 encoding);
+        void writeSystemRegister(u16 encoding, u64 value);
+
+        [[nodiscard]] u64 readMemory(addr_t address, size_t size);
+        void writeMemory(addr_t address, size_t size, u64 value);
+        void readMemoryBlock(addr_t address, size_t size, void *buffer);
+        void writeMemoryBlock(addr_t address, size_t size, const void *buffer);
+        [[nodiscard]] u8* getAtomicHostPointer(addr_t address, size_t size, AccessType access);
+        void commitAtomicWrite(addr_t address, size_t size, u64 value);
+        [[nodiscard]] core::VectorRegister readMemoryVector(addr_t address, u8 scale);
+        void writeMemoryVector(addr_t address, u8 scale, const core::VectorRegister &value);
+
+        void unimplementedInstruction(const inst_t &inst);
+
+        void prepareFloatingPoint();
+        void collectFloatingPointExceptions();
+        void releaseFloatingPoint();
+        void restoreHostFloatingPoint();
 
         bool m_halted = false;
         AddressSpace *m_addressSpace = nullptr;
+        u64 m_retiredInstructions = 0;
+        vtime_t m_idleTime = 0;
+        vtime_t m_deadline = std::numeric_limits<vtime_t>::max();
+        std::atomic<bool> m_interruptPending = false;
+
+        bool m_virtualization = false;
+
+        /* Low power states */
+        bool m_waiting = false;
+        bool m_waitingForEvent = false;
+        std::atomic<bool> m_eventRegister = false;
+        BroadcastHandler m_broadcastHandler;
+
+        /* Exclusive Monitor */
+        bool m_exclusiveValid = false;
+        addr_t m_exclusiveAddress = 0;
+        u8 m_exclusiveScale = 0;
+        std::array<u64, 2> m_exclusiveValue = { };
+        addr_t m_atomicPhysicalAddress = 0;
+
+        /* Address Translation */
+        Mmu m_mmu;
+
+        /* Execution Engine */
+        ExecutionEngine m_engine = ExecutionEngine::Interpreter;
+
+        // One block cache per VMID:ASID translation context and privilege level so switching processes keeps their blocks warm
+        using BlockCache = std::unordered_map<addr_t, TranslationBlock>;
+        std::unordered_map<u32, BlockCache> m_blockCaches;
+        BlockCache *m_blockCache = nullptr;
+        u32 m_blockContext = UntranslatedContext;
+
+        // Blocks by the physical page they were translated from, so a write to it can find them again
+        std::unordered_map<addr_t, std::vector<std::pair<u32, addr_t>>> m_codeBlocks;
+
+        // Other cores queue invalidations while this one runs, the flags let block boundaries skip the locks when there are none.
+        // The TLB is only ever touched by the core's own thread
+        std::mutex m_pendingTranslationInvalidationsMutex;
+        std::vector<TranslationInvalidation> m_pendingTranslationInvalidations;
+        std::atomic<bool> m_translationInvalidationsPending = false;
+        std::mutex m_pendingBlockInvalidationsMutex;
+        std::vector<BlockInvalidation> m_pendingBlockInvalidations;
+        std::atomic<bool> m_blockInvalidationsPending = false;
+        std::vector<MemoryWrite> *m_memoryWriteLog = nullptr;
+
+        /* Profiling */
+        Profiler *m_profiler = nullptr;
+        bool m_collectStatistics = false;
+        u16 m_currInstructionIndex = 0;
+        std::vector<InstructionStatistics> m_instructionStatistics;
 
         /* Debug */
         bool m_broken = false;
@@ -138,28 +382,29 @@ namespace arm {
 
         /* Floating Point Registers*/
 
+        std::array<core::VectorRegister, 32> V;
         core::RegisterSingle FPCR;
         core::RegisterSingle FPSR;
 
+        // Host FP state is per thread, all cores ticked by it share it
+        static thread_local Core *s_hostFloatingPointOwner;
+        static thread_local u32 s_hostFloatingPointControl;
+
 
         /* System Registers */
 
         core::ELRegister ACTLR;
         core::ELRegister CCSIDR;
         core::ELRegister CLIDR;
-        core::ELRegister CNTFRQ;
-        core::ELRegister CNTPCT;
-        core::ELRegister CNTKCTL;
-        core::ELRegister CNTP_CVAL;
         core::ELRegister CPACR;
         core::ELRegister CSSELR;
-        core::ELRegister CNTP_CTL;
         core::ELRegister CTR;
         core::ELRegister DCZID;
         core::ELRegister ELR;
         core::ELRegister ESR;
         core::ELRegister FAR;
         core::ELRegister HCR;
+        core::ELRegister HPFAR;
         core::ELRegister MAIR;
         core::ELRegister MIDR;
         core::ELRegister MPIDR;
@@ -176,11 +421,14 @@ namespace arm {
         core::ELRegister VTCR;
         core::ELRegister VTTBR;
 
+        GenericTimer m_timer;
+
 
         /* Instruction Handlers */
-        constexpr auto getInstructionPatternLUT() const;
+        static constexpr auto getInstructionPatternLUT();
 
         INSTRUCTION_DECL(NOP);
+        INSTRUCTION_DECL(HLT);
         INSTRUCTION_DECL(ADD_IMMEDIATE);
         INSTRUCTION_DECL(ADD_SHIFTED_REGISTER);
         INSTRUCTION_DECL(ADDS_IMMEDIATE);
@@ -198,16 +446,106 @@ namespace arm {
         INSTRUCTION_DECL(CCMN_IMMEDIATE);
         INSTRUCTION_DECL(CCMN_REGISTER);
         INSTRUCTION_DECL(SVC);
+        INSTRUCTION_DECL(HVC);
         INSTRUCTION_DECL(ADRP);
         INSTRUCTION_DECL(AND_IMMEDIATE);
         INSTRUCTION_DECL(AND_SHIFTED_REGISTER);
         INSTRUCTION_DECL(ANDS_IMMEDIATE);
         INSTRUCTION_DECL(ANDS_SHIFTED_REGISTER);
+        INSTRUCTION_DECL(MADD);
+        INSTRUCTION_DECL(MSUB);
+        INSTRUCTION_DECL(SMADDL);
+        INSTRUCTION_DECL(SMSUBL);
+        INSTRUCTION_DECL(UMADDL);
+        INSTRUCTION_DECL(UMSUBL);
+        INSTRUCTION_DECL(SMULH);
+        INSTRUCTION_DECL(UMULH);
+        INSTRUCTION_DECL(SDIV);
+        INSTRUCTION_DECL(UDIV);
+        INSTRUCTION_DECL(RBIT);
+        INSTRUCTION_DECL(REV16);
+        INSTRUCTION_DECL(REV);
+        INSTRUCTION_DECL(CLZ);
+        INSTRUCTION_DECL(CLS);
+        INSTRUCTION_DECL(CSEL);
+        INSTRUCTION_DECL(SBFM);
+        INSTRUCTION_DECL(BFM);
+        INSTRUCTION_DECL(UBFM);
         INSTRUCTION_DECL(STR_IMMEDIATE);
         INSTRUCTION_DECL(STR_REGISTER);
         INSTRUCTION_DECL(LDR_IMMEDIATE);
         INSTRUCTION_DECL(LDR_REGISTER);
+        INSTRUCTION_DECL(LDRS_IMMEDIATE);
+        INSTRUCTION_DECL(LDRS_REGISTER);
+        INSTRUCTION_DECL(LDR_LITERAL);
+        INSTRUCTION_DECL(STP);
+        INSTRUCTION_DECL(LDP);
         INSTRUCTION_DECL(CBZ);
+        INSTRUCTION_DECL(CBNZ);
+        INSTRUCTION_DECL(MRS);
+        INSTRUCTION_DECL(MSR_REGISTER);
+        INSTRUCTION_DECL(MSR_IMMEDIATE);
+        INSTRUCTION_DECL(ERET);
+
+        INSTRUCTION_DECL(WFI);
+        INSTRUCTION_DECL(WFE);
+        INSTRUCTION_DECL(SEV);
+        INSTRUCTION_DECL(SEVL);
+        INSTRUCTION_DECL(SYS);
+        INSTRUCTION_DECL(DC_ZVA);
+        INSTRUCTION_DECL(CLREX);
+        INSTRUCTION_DECL(DMB);
+        INSTRUCTION_DECL(DSB);
+        INSTRUCTION_DECL(ISB);
+
+        INSTRUCTION_DECL(SIMD_LOAD_STORE_IMMEDIATE);
+        INSTRUCTION_DECL(SIMD_LOAD_STORE);
+        INSTRUCTION_DECL(SIMD_LOAD_STORE_PAIR);
+        INSTRUCTION_DECL(SIMD_LOAD_STORE_MULTIPLE);
+        INSTRUCTION_DECL(SIMD_LOAD_REPLICATE);
+        INSTRUCTION_DECL(SIMD_THREE_SAME);
+        INSTRUCTION_DECL(SIMD_FLOAT_THREE_SAME);
+        INSTRUCTION_DECL(SIMD_THREE_DIFFERENT);
+        INSTRUCTION_DECL(SIMD_TWO_REGISTER_MISC);
+        INSTRUCTION_DECL(SIMD_ACROSS_LANES);
+        INSTRUCTION_DECL(SIMD_COPY);
+        INSTRUCTION_DECL(SIMD_PERMUTE);
+        INSTRUCTION_DECL(SIMD_EXTRACT);
+        INSTRUCTION_DECL(SIMD_TABLE_LOOKUP);
+        INSTRUCTION_DECL(SIMD_MODIFIED_IMMEDIATE);
+        INSTRUCTION_DECL(SIMD_SHIFT_IMMEDIATE);
+        INSTRUCTION_DECL(SIMD_BY_ELEMENT);
+
+        INSTRUCTION_DECL(FP_CONVERT_INTEGER);
+        INSTRUCTION_DECL(FP_ONE_SOURCE);
+        INSTRUCTION_DECL(FP_TWO_SOURCE);
+        INSTRUCTION_DECL(FP_THREE_SOURCE);
+        INSTRUCTION_DECL(FP_COMPARE);
+        INSTRUCTION_DECL(FP_CONDITIONAL_COMPARE);
+        INSTRUCTION_DECL(FP_CONDITIONAL_SELECT);
+        INSTRUCTION_DECL(FP_IMMEDIATE);
+
+        INSTRUCTION_DECL(AES);
+        INSTRUCTION_DECL(SHA_THREE_REGISTER);
+        INSTRUCTION_DECL(SHA_TWO_REGISTER);
+        INSTRUCTION_DECL(CRC32);
+
+        INSTRUCTION_DECL(LOAD_STORE_EXCLUSIVE);
+        INSTRUCTION_DECL(LOAD_ACQUIRE_STORE_RELEASE);
+        INSTRUCTION_DECL(CAS);
+        INSTRUCTION_DECL(ATOMIC_MEMORY);
+
+        /* Specialized Instruction Handlers, see Core::specializeHandler */
+        enum class Operands : u8 {
+            Direct,         // Rd, Rn and Rm are all X0 - X30
+            DiscardResult,  // Rd is the zero register, only the flags are kept
+            Generic,        // Register 31 resolved at runtime the same way the generic handlers do
+            ZeroFirst       // Rn is the zero register
+        };
+
+        template<bool subtract, bool setFlags, bool is64, bool shifted, Operands operands> INSTRUCTION_DECL(ADD_SUB_IMMEDIATE);
+        template<bool subtract, bool setFlags, bool is64, u8 shiftType, Operands operands> INSTRUCTION_DECL(ADD_SUB_SHIFTED_REGISTER);
+        template<u8 opc, bool is64, u8 shiftType, Operands operands> INSTRUCTION_DECL(LOGICAL_SHIFTED_REGISTER);
 
     };
 
@@ -3,7 +3,7 @@
 #include "core.hpp"
 #include "address_space.hpp"
 
-#include <vector>
+#include <deque>
 
 namespace arm {
 
@@ -13,16 +13,22 @@ namespace arm {
         ~Cpu();
 
         void tick();
+        void run(const Scheduler &scheduler);
         void reset();
 
+        [[nodiscard]] vtime_t getVirtualTime() const;
+        [[nodiscard]] bool isIdle() const;
+
         void addDeviceToAddressSpace(Device *device, addr_t baseAddress);
+        bool enableFastmem();
+        void attachScheduler(Scheduler *scheduler);
 
         u8 getCoreCount();
         Core& getCore(u8 id);
 
     private:
         u8 m_numCores;
-        std::vector<Core> m_cores;
+        std::deque<Core> m_cores;
 
         AddressSpace m_addressSpace;
     };
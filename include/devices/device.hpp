@@ -2,6 +2,8 @@
 
 #include <arm.hpp>
 
+#include <atomic>
+#include <functional>
 #include <type_traits>
 
 namespace arm {
@@ -16,11 +18,31 @@ namespace arm {
 
         size_t getSize() const { return this->m_size; }
 
+        // Devices backed by plain host memory can hand out a pointer so accesses skip the read / write dispatch
+        virtual u8* getHostPointer(offset_t offset, size_t size, bool write) { return nullptr; }
+
+        // Called once a write through such a pointer has landed, anything tracking the new contents has to happen here.
+        // Only needed while some device tracks writes, which spares the fast paths the device lookup otherwise
+        virtual void commitWrite(offset_t, size_t) { }
+        [[nodiscard]] static bool isWriteTrackingActive() { return s_writeTrackingDevices.load(std::memory_order_relaxed) != 0; }
+
+        // Maps the same backing memory a second time at a fixed host address, used to build the fastmem arena
+        virtual bool mirrorAt(u8 *address) { return false; }
+
+        // Devices code can be fetched from report the first write to a page that translated blocks were built from
+        using CodeWriteHandler = std::function<void(offset_t page)>;
+        virtual void markCode(offset_t offset) { }
+        void setCodeWriteHandler(CodeWriteHandler handler) { this->m_codeWriteHandler = std::move(handler); }
+
         template<typename T>
         static T* as(Device *device) requires std::is_base_of_v<Device, T> {
             return static_cast<T*>(device);
         }
 
+    protected:
+        CodeWriteHandler m_codeWriteHandler;
+        static inline std::atomic<u32> s_writeTrackingDevices = 0;
+
     private:
         const size_t m_size;
     };
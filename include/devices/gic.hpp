@@ -0,0 +1,118 @@
+#pragma once
+
+#include "devices/device.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace arm { class Core; }
+
+namespace arm::dev {
+
+    constexpr u32 GICNumInterrupts = 96;
+    constexpr u32 GICNumPrivateInterrupts = 32;
+    constexpr u32 GICNumSoftwareInterrupts = 16;
+    constexpr u8  GICMaxCores = 8;
+    constexpr u32 GICSpuriousInterrupt = 1023;
+    constexpr u8  GICIdlePriority = 0xFF;
+
+    // Distributor register banks holding a byte (priorities, targets) or two bits (configuration) per interrupt
+    constexpr offset_t GICByteBankSize = GICNumInterrupts;
+    constexpr offset_t GICConfigBankSize = GICNumInterrupts / 4;
+
+    // GICv2 style distributor, every core gets its own CPU interface frame
+    class GIC : public Device {
+    public:
+        enum DistributorRegister : offset_t {
+            GICD_CTLR       = 0x000,
+            GICD_TYPER      = 0x004,
+            GICD_IIDR       = 0x008,
+            GICD_ISENABLER  = 0x100,
+            GICD_ICENABLER  = 0x180,
+            GICD_ISPENDR    = 0x200,
+            GICD_ICPENDR    = 0x280,
+            GICD_ISACTIVER  = 0x300,
+            GICD_ICACTIVER  = 0x380,
+            GICD_IPRIORITYR = 0x400,
+            GICD_ITARGETSR  = 0x800,
+            GICD_ICFGR      = 0xC00,
+            GICD_SGIR       = 0xF00
+        };
+
+        enum CpuInterfaceRegister : offset_t {
+            GICC_CTLR   = 0x00,
+            GICC_PMR    = 0x04,
+            GICC_BPR    = 0x08,
+            GICC_IAR    = 0x0C,
+            GICC_EOIR   = 0x10,
+            GICC_RPR    = 0x14,
+            GICC_HPPIR  = 0x18
+        };
+
+        class CpuInterface : public Device {
+        public:
+            CpuInterface(GIC &gic, u8 coreId);
+
+            virtual u64 read(offset_t offset, size_t size);
+            virtual void write(offset_t offset, size_t size, u64 value);
+
+        private:
+            GIC &m_gic;
+            u8 m_coreId;
+        };
+
+        explicit GIC();
+        virtual ~GIC();
+
+        virtual u64 read(offset_t offset, size_t size);
+        virtual void write(offset_t offset, size_t size, u64 value);
+
+        u8 connectCore(Core *core);
+        CpuInterface* getCpuInterface(u8 coreId);
+
+        void setLevel(u8 coreId, u32 id, bool level);
+
+    private:
+        struct Interrupt {
+            bool enabled = false;
+            bool pending = false;
+            bool active = false;
+            bool level = false;
+            bool edgeTriggered = false;
+            u8 priority = 0;
+            u8 targets = 0;
+        };
+
+        struct CpuState {
+            explicit CpuState(Core *core) : core(core) { }
+
+            Core *core;
+            bool enabled = false;
+            u8 priorityMask = 0;
+            u8 binaryPoint = 0;
+            std::vector<u32> activeInterrupts;
+        };
+
+        Interrupt& getInterrupt(u8 coreId, u32 id);
+        [[nodiscard]] u8 getRunningPriority(u8 coreId);
+        [[nodiscard]] std::optional<u32> getHighestPendingInterrupt(u8 coreId);
+
+        u64 readCpuInterface(u8 coreId, offset_t offset);
+        void writeCpuInterface(u8 coreId, offset_t offset, u64 value);
+        void sendSoftwareInterrupt(u8 sourceCore, u32 value);
+        void update();
+
+        std::mutex m_mutex;
+        bool m_enabled = false;
+
+        std::array<std::array<Interrupt, GICNumPrivateInterrupts>, GICMaxCores> m_privateInterrupts;
+        std::array<Interrupt, GICNumInterrupts - GICNumPrivateInterrupts> m_sharedInterrupts;
+
+        std::vector<CpuState> m_cpus;
+        std::vector<std::unique_ptr<CpuInterface>> m_cpuInterfaces;
+    };
+
+}
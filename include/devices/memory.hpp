@@ -2,8 +2,14 @@
 
 #include "devices/device.hpp"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace arm::dev {
 
+    constexpr size_t MemoryPageSize = 4_kiB;
+
     class Memory : public Device {
     public:
         explicit Memory(size_t size);
@@ -11,12 +17,39 @@ namespace arm::dev {
 
         virtual u64 read(offset_t offset, size_t size);
         virtual void write(offset_t offset, size_t size, u64 value);
+        virtual u8* getHostPointer(offset_t offset, size_t size, bool write);
+        virtual void commitWrite(offset_t offset, size_t size);
+        virtual bool mirrorAt(u8 *address);
+        virtual void markCode(offset_t offset);
 
         void load(const std::string &path);
         void load(const std::initializer_list<inst_t> &instructions);
         void load(const u8 *data, const size_t size);
+
+        /*
+         * Dirty page tracking, off by default. pageSize has to be a power of two. Collecting returns the offsets of all pages
+         * written since the last collection and clears them, pages written concurrently are reported by this or the next one.
+         * Enabling and disabling isn't synchronized with the write path and should only be done while no core is running.
+         */
+        void enableDirtyTracking(size_t pageSize);
+        void disableDirtyTracking();
+        [[nodiscard]] std::vector<offset_t> collectAndClearDirty();
     private:
+        void notifyWrite(offset_t offset, size_t size);
+        void invalidateCode(size_t page);
+        void markDirty(offset_t offset, size_t size);
+        void updateMirrorProtection(size_t page);
+
         u8 *m_memory = nullptr;
+        int m_fd = -1;
+        u8 *m_mirror = nullptr;
+
+        // One bit per page, set while translated blocks exist for it. Writes only have to look at their page's bit
+        std::unique_ptr<std::atomic<u64>[]> m_codePages;
+
+        // Same layout at the tracking granularity, null while tracking is disabled
+        std::unique_ptr<std::atomic<u64>[]> m_dirtyPages;
+        u32 m_dirtyPageShift = 0;
     };
 
 }
\ No newline at end of file
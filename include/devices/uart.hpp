@@ -1,17 +1,67 @@
 #pragma once
 
 #include "devices/device.hpp"
+#include "scheduler.hpp"
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
 
 namespace arm::dev {
 
+    constexpr size_t UARTTxFlushThreshold = 4_kiB;
+    constexpr size_t UARTRxFifoSize = 64;
+    constexpr vtime_t UARTPollPeriod = 100'000;
+
     class UART : public Device {
     public:
+        enum Register : offset_t {
+            DR = 0x000,
+            FR = 0x018
+        };
+
+        enum Flag : u32 {
+            FR_RXFE = 1 << 4,
+            FR_TXFF = 1 << 5,
+            FR_RXFF = 1 << 6,
+            FR_TXFE = 1 << 7
+        };
+
         explicit UART();
         virtual ~UART();
 
         virtual u64 read(offset_t offset, size_t size);
         virtual void write(offset_t offset, size_t size, u64 value);
+
+        void setOutput(int fd);
+        void setInput(int fd);
+        std::string openPseudoTerminal();
+
+        void attachScheduler(Scheduler *scheduler);
+
+        void poll();
+        void flush();
+
+        // Sleeps for up to timeout, returning early once host input arrived and got buffered
+        void waitForInput(std::chrono::milliseconds timeout);
+
     private:
+        void receive();
+        void schedulePoll();
+
+        int m_outputFd;
+        int m_inputFd = -1;
+        int m_pseudoTerminalFd = -1;
+
+        std::vector<u8> m_txFifo;
+
+        std::array<u8, UARTRxFifoSize> m_rxFifo;
+        size_t m_rxHead = 0;
+        size_t m_rxCount = 0;
+
+        Scheduler *m_scheduler = nullptr;
+        bool m_pollScheduled = false;
     };
 
-}
\ No newline at end of file
+}
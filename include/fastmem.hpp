@@ -0,0 +1,35 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include "devices/device.hpp"
+
+namespace arm {
+
+    // Guest physical addresses below this are mirrored in the arena, anything above always takes the device dispatch
+    constexpr u64 FastmemArenaSize = 4_GiB;
+
+    /*
+     * A host virtual range laid out like the guest physical address space. Devices backed by host memory are mapped into
+     * it at their base address, everything else stays inaccessible. Accesses are plain loads and stores into the arena,
+     * one that hits an inaccessible page faults and is reported back as a miss so the caller can dispatch it as usual.
+     */
+    class Fastmem {
+    public:
+        Fastmem();
+        ~Fastmem();
+
+        Fastmem(const Fastmem&) = delete;
+        Fastmem& operator=(const Fastmem&) = delete;
+
+        [[nodiscard]] static bool isSupported();
+        [[nodiscard]] bool map(Device *device, addr_t baseAddress);
+
+        [[nodiscard]] bool read(addr_t address, size_t size, u64 &value);
+        [[nodiscard]] bool write(addr_t address, size_t size, u64 value);
+
+    private:
+        u8 *m_arena = nullptr;
+    };
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include "scheduler.hpp"
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <optional>
+
+namespace arm {
+
+    // Nominal counter frequency, in virtual time mode one counter tick is one retired instruction
+    constexpr u64 GenericTimerFrequency = 100'000'000;
+
+    constexpr auto MaxRealTimeSleep = std::chrono::milliseconds(10);
+
+    // Private peripheral interrupts the comparators are wired to
+    constexpr u32 PhysicalTimerInterrupt = 30;
+    constexpr u32 VirtualTimerInterrupt = 27;
+
+    class GenericTimer {
+    public:
+        enum class Channel : u8 {
+            Physical,
+            Virtual
+        };
+
+        enum Control : u64 {
+            CTL_ENABLE  = 1 << 0,
+            CTL_IMASK   = 1 << 1,
+            CTL_ISTATUS = 1 << 2
+        };
+
+        using InterruptHandler = std::function<void(Channel channel, bool level)>;
+
+        GenericTimer();
+
+        void attachScheduler(Scheduler *scheduler);
+        void setInterruptHandler(InterruptHandler handler);
+        void setRealTime(bool realTime);
+
+        [[nodiscard]] u64 getCounter(vtime_t now) const;
+
+        [[nodiscard]] u64 getControl(Channel channel, vtime_t now) const;
+        void setControl(Channel channel, u64 value, vtime_t now);
+        [[nodiscard]] u64 getCompareValue(Channel channel) const;
+        void setCompareValue(Channel channel, u64 value, vtime_t now);
+        [[nodiscard]] u64 getTimerValue(Channel channel, vtime_t now) const;
+        void setTimerValue(Channel channel, u64 value, vtime_t now);
+
+        [[nodiscard]] u64 getKernelControl() const;
+        void setKernelControl(u64 value);
+
+    private:
+        struct Comparator {
+            u64 control = 0;
+            u64 compareValue = 0;
+            bool asserted = false;
+            std::optional<EventId> expiryEvent;
+        };
+
+        void update(Channel channel, vtime_t now);
+
+        std::array<Comparator, 2> m_comparators;
+        u64 m_kernelControl = 0;
+
+        bool m_realTime = false;
+        std::chrono::steady_clock::time_point m_epoch;
+
+        Scheduler *m_scheduler = nullptr;
+        InterruptHandler m_interruptHandler;
+    };
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include <bit>
+#include <vector>
+
+namespace arm::ir {
+
+    // Register numbers as the IR sees them, X0 - X30 keep their encoding. The zero register never shows up, it's lowered to constants
+    constexpr u8 StackPointer = 32;
+    constexpr u8 Flags = 33;    // Only in RegisterWrite
+
+    constexpr u8 FlagN = 0b1000;
+    constexpr u8 FlagZ = 0b0100;
+    constexpr u8 FlagC = 0b0010;
+    constexpr u8 FlagV = 0b0001;
+
+    constexpr size_t MaxInstructions = 512;
+
+    enum class Opcode : u8 {
+        Nop,
+        Const,              // imm
+
+        // Pure, see evaluate()
+        Add,                // a + b
+        Sub,                // a - b
+        And,                // a & b
+        Or,                 // a | b
+        Xor,                // a ^ b
+        Shl,                // a << imm
+        Lsr,                // a >> imm
+        Asr,                // a >> imm, arithmetic
+        Ror,                // a rotated right by imm
+        AddFlags,           // NZCV of a + b
+        SubFlags,           // NZCV of a - b
+        LogicFlags,         // NZ of a, CV cleared
+
+        // Guest state and side effects, kept in order
+        GetRegister,        // reg
+        SetRegister,        // reg = a
+        GetFlags,
+        SetFlags,           // NZCV = a
+        Load,               // width bytes from address a
+        Store,              // width bytes of b to address a
+        Call,               // Runs guest instruction imm through its handler
+        WriteBack,          // Performs Block::writes [a, a + b), see packForInterpreter()
+
+        // Block exits, always last
+        Exit,               // PC = imm
+        ExitConditional,    // PC = condition reg holds for flags a ? imm : the next block
+        ExitZero,           // PC = a == 0 ? imm : the next block, ExitNotZero the other way around
+        ExitNotZero
+    };
+
+    /*
+     * Every instruction defines one value, numbered by its position in the block. Operands refer to earlier ones, so values
+     * are only ever assigned once. width is 32 or 64 for arithmetic and the access size in bytes for memory operations,
+     * guest is the index of the guest instruction the IR instruction was lowered from.
+     */
+    struct Instruction {
+        Opcode opcode;
+        u8 width;
+        u8 reg;
+        u8 guest;
+        u16 a, b;
+        u64 imm;
+    };
+
+    struct RegisterWrite {
+        u8 reg;
+        u16 value;
+    };
+
+    /*
+     * Once packed for the interpreter, values are numbered constants first, then the registers read on entry, then the
+     * instructions. Constants are filled in once, inputs every time the block is entered.
+     */
+    struct Block {
+        addr_t address;
+        u8 guestInstructions;
+        std::vector<Instruction> instructions;
+
+        std::vector<u64> constants;
+        std::vector<u8> inputs;
+        std::vector<RegisterWrite> writes;
+    };
+
+    [[nodiscard]] constexpr bool isPure(Opcode opcode) {
+        return opcode >= Opcode::Add && opcode <= Opcode::LogicFlags;
+    }
+
+    [[nodiscard]] constexpr bool isExit(Opcode opcode) {
+        return opcode >= Opcode::Exit;
+    }
+
+    // Guest state has to be exact at these as they can fault or run arbitrary handlers
+    [[nodiscard]] constexpr bool isSynchronizing(Opcode opcode) {
+        return opcode == Opcode::Load || opcode == Opcode::Store || opcode == Opcode::Call || isExit(opcode);
+    }
+
+    [[nodiscard]] constexpr u8 addWithCarryFlags(u64 x, u64 y, bool carry, bool is64) {
+        if (!is64) {
+            u64 unsignedSum = u64(u32(x)) + u64(u32(y)) + carry;
+            s64 signedSum = s64(s32(x)) + s64(s32(y)) + carry;
+            u32 result = u32(unsignedSum);
+
+            return (result >> 31 ? FlagN : 0) | (result == 0 ? FlagZ : 0) | (u64(result) != unsignedSum ? FlagC : 0) | (s64(s32(result)) != signedSum ? FlagV : 0);
+        } else {
+            u64 result = x + y + carry;
+
+            return (result >> 63 ? FlagN : 0) | (result == 0 ? FlagZ : 0) | (result < x || (carry && result == x) ? FlagC : 0) | ((~(x ^ y) & (x ^ result)) >> 63 ? FlagV : 0);
+        }
+    }
+
+    [[nodiscard]] constexpr bool conditionHolds(u8 cond, u8 nzcv) {
+        const bool n = nzcv & FlagN, z = nzcv & FlagZ, c = nzcv & FlagC, v = nzcv & FlagV;
+
+        bool holds = false;
+        switch (cond >> 1) {
+            case 0b000: holds = z;              break; // EQ or NE
+            case 0b001: holds = c;              break; // CS or CC
+            case 0b010: holds = n;              break; // MI or PL
+            case 0b011: holds = v;              break; // VS or VC
+            case 0b100: holds = c && !z;        break; // HI or LS
+            case 0b101: holds = n == v;         break; // GE or LT
+            case 0b110: holds = n == v && !z;   break; // GT or LE
+            default:    holds = true;           break; // AL
+        }
+
+        return (cond & 0b0001) && cond != 0b1111 ? !holds : holds;
+    }
+
+    // Used by the interpreter and by constant propagation alike, so folding can never disagree with executing
+    [[nodiscard]] constexpr u64 evaluate(const Instruction &instruction, u64 a, u64 b) {
+        const bool is64 = instruction.width == 64;
+        const u64 mask = is64 ? ~0ULL : 0xFFFF'FFFFULL;
+        const u8 amount = instruction.imm;
+
+        switch (instruction.opcode) {
+            case Opcode::Add:        return (a + b) & mask;
+            case Opcode::Sub:        return (a - b) & mask;
+            case Opcode::And:        return (a & b) & mask;
+            case Opcode::Or:         return (a | b) & mask;
+            case Opcode::Xor:        return (a ^ b) & mask;
+            case Opcode::Shl:        return (a << amount) & mask;
+            case Opcode::Lsr:        return (a & mask) >> amount;
+            case Opcode::Asr:        return is64 ? u64(s64(a) >> amount) : u32(s32(a) >> amount);
+            case Opcode::Ror:        return is64 ? std::rotr(a, amount) : std::rotr(u32(a), amount);
+            case Opcode::AddFlags:   return addWithCarryFlags(a, b, false, is64);
+            case Opcode::SubFlags:   return addWithCarryFlags(a, ~b, true, is64);
+            case Opcode::LogicFlags: return (a >> (is64 ? 63 : 31) & 1 ? FlagN : 0) | ((a & mask) == 0 ? FlagZ : 0);
+            default:                 return 0;
+        }
+    }
+
+    /* Passes, run in this order by optimize() */
+    void forwardRegisters(Block &block);
+    void propagateConstants(Block &block);
+    void eliminateDeadFlags(Block &block);
+    void eliminateDeadRegisterStores(Block &block);
+    void eliminateDeadCode(Block &block);
+    void packForInterpreter(Block &block);
+
+    void optimize(Block &block);
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include "board.hpp"
+
+#include <vector>
+
+namespace arm {
+
+    constexpr u8 LockstepWindowBefore = 4;
+    constexpr u8 LockstepWindowAfter = 12;
+
+    class Lockstep {
+    public:
+        Lockstep(Board &reference, Board &accelerated, u64 compareInterval = 0);
+        ~Lockstep();
+
+        bool step();
+        bool run(u64 maxInstructions);
+
+        [[nodiscard]] bool hasDiverged() const;
+
+    private:
+        [[nodiscard]] bool compare(u8 coreId);
+        void reportDivergence(u8 coreId);
+
+        Board &m_reference;
+        Board &m_accelerated;
+        u64 m_compareInterval;
+
+        std::vector<std::vector<MemoryWrite>> m_referenceWrites;
+        std::vector<std::vector<MemoryWrite>> m_acceleratedWrites;
+        std::vector<u64> m_lastCompare;
+        std::vector<addr_t> m_lastAgreedPC;
+
+        bool m_diverged = false;
+    };
+
+}
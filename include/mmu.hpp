@@ -0,0 +1,184 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include "address_space.hpp"
+
+#include <array>
+#include <bit>
+#include <functional>
+#include <optional>
+
+namespace arm {
+
+    constexpr u32 TLBSets = 64;
+    constexpr u32 TLBWays = 4;
+    constexpr u8  PhysicalAddressBits = 48;
+    constexpr u64 MinimumPageSize = 4_kiB;
+
+    enum class AccessType : u8 {
+        Read,
+        Write,
+        Execute
+    };
+
+    // Thrown out of an instruction handler when translation fails, the core turns it into an abort exception
+    struct TranslationFault {
+        addr_t address;
+        AccessType access;
+        u8 faultStatus;
+
+        // Stage 2 faults are taken to EL2 which additionally needs to know the IPA and whether a stage 1 walk caused it
+        bool stage2 = false;
+        bool stage1Walk = false;
+        addr_t intermediateAddress = 0;
+    };
+
+    struct TranslationStatistics {
+        u64 lookups = 0;
+        u64 walks = 0;
+        u64 stage2Walks = 0;
+        u64 descriptorReads = 0;
+    };
+
+    class Mmu {
+    public:
+        enum FaultStatus : u8 {
+            AddressSizeFault = 0b000000,
+            TranslationFaultLevel0 = 0b000100,
+            AccessFlagFaultLevel0 = 0b001000,
+            PermissionFaultLevel0 = 0b001100
+        };
+
+        // Called for every invalidation so caches derived from translations can follow, an empty VMID or ASID means all of them
+        using InvalidationHandler = std::function<void(std::optional<u16> vmid, std::optional<u16> asid, std::optional<addr_t> address)>;
+
+        explicit Mmu(AddressSpace *addressSpace);
+
+        void configure(u64 sctlr, u64 tcr, u64 ttbr0, u64 ttbr1, u64 hcr, u64 vtcr, u64 vttbr, bool hypervisor);
+        void setInvalidationHandler(InvalidationHandler handler) { this->m_invalidationHandler = std::move(handler); }
+
+        [[nodiscard]] bool isEnabled() const { return this->m_enabled; }
+        [[nodiscard]] u16 getAsid() const { return this->m_asid; }
+        [[nodiscard]] u16 getVmid() const { return this->m_vmid; }
+
+        [[nodiscard]] addr_t translate(addr_t address, AccessType access, bool privileged) {
+            if (!this->m_enabled)
+                return address;
+
+            this->m_statistics.lookups++;
+
+            // Entries hold the combined stage 1 and stage 2 result so a hit never touches the translation tables
+            if (const Entry *entry = this->lookup(address); entry != nullptr) {
+                const u8 required = getRequiredPermission(access, privileged);
+                if (!(entry->permissions & required))
+                    throw TranslationFault{ address, access, u8(PermissionFaultLevel0 + entry->level) };
+                if (!(entry->stage2Permissions & required))
+                    throw TranslationFault{ address, access, u8(PermissionFaultLevel0 + entry->stage2Level), true, false,
+                                            entry->intermediateAddress | (address & ((u64(1) << entry->shift) - 1)) };
+
+                return entry->outputAddress | (address & ((u64(1) << entry->shift) - 1));
+            }
+
+            return this->walk(address, access, privileged);
+        }
+
+        // Global mappings (nG clear) match every ASID
+        [[nodiscard]] bool isGlobal(addr_t address) const {
+            const Entry *entry = this->lookup(address);
+            return this->m_enabled && entry != nullptr && entry->global;
+        }
+
+        void invalidateAll();
+        // The VMID is the one the maintenance operation was issued under, which for broadcasts isn't necessarily the current one
+        void invalidateAsid(u16 vmid, u16 asid);
+        void invalidateAddress(u16 vmid, addr_t address, std::optional<u16> asid = std::nullopt);
+
+        [[nodiscard]] const TranslationStatistics& getStatistics() const { return this->m_statistics; }
+
+    private:
+        enum Permission : u8 {
+            ReadEL0     = 1 << 0,
+            WriteEL0    = 1 << 1,
+            ExecuteEL0  = 1 << 2,
+            ReadEL1     = 1 << 3,
+            WriteEL1    = 1 << 4,
+            ExecuteEL1  = 1 << 5,
+
+            AllPermissions = ReadEL0 | WriteEL0 | ExecuteEL0 | ReadEL1 | WriteEL1 | ExecuteEL1
+        };
+
+        struct Entry {
+            bool valid = false;
+            u8 shift;
+            u8 level;
+            u8 stage2Level;
+            u8 permissions;
+            u8 stage2Permissions;
+            bool global;
+            u16 asid;
+            u16 vmid;
+            u64 tag;
+            addr_t intermediateAddress;
+            addr_t outputAddress;
+        };
+
+        // A single stage's view of the mapping containing an address
+        struct Mapping {
+            u8 shift;
+            u8 level;
+            u8 permissions;
+            bool global;
+            addr_t outputAddress;
+        };
+
+        static constexpr u8 getRequiredPermission(AccessType access, bool privileged) {
+            switch (access) {
+                case AccessType::Read:  return privileged ? ReadEL1 : ReadEL0;
+                case AccessType::Write: return privileged ? WriteEL1 : WriteEL0;
+                default:                return privileged ? ExecuteEL1 : ExecuteEL0;
+            }
+        }
+
+        [[nodiscard]] const Entry* lookup(addr_t address) const {
+            // Only probe the mapping sizes that are actually cached
+            for (u64 shifts = this->m_cachedShifts; shifts != 0; shifts &= shifts - 1) {
+                const u8 shift = std::countr_zero(shifts);
+                const u64 tag = address >> shift;
+
+                for (const auto &entry : this->m_entries[tag % TLBSets]) {
+                    if (entry.valid && entry.tag == tag && entry.shift == shift && entry.vmid == this->m_vmid && (entry.global || entry.asid == this->m_asid))
+                        return &entry;
+                }
+            }
+
+            return nullptr;
+        }
+
+        addr_t walk(addr_t address, AccessType access, bool privileged);
+        Mapping walkStage1(addr_t address, AccessType access);
+        Mapping walkStage2(addr_t address, addr_t inputAddress, AccessType access, bool stage1Walk);
+        void notifyInvalidation(std::optional<u16> vmid, std::optional<u16> asid, std::optional<addr_t> address) const;
+
+        AddressSpace *m_addressSpace;
+        InvalidationHandler m_invalidationHandler;
+
+        // Translation applies at all for the current exception level, EL2 itself runs untranslated
+        bool m_enabled = false;
+        bool m_stage1Enabled = false;
+        bool m_stage2Enabled = false;
+        u64 m_tcr = 0;
+        u64 m_ttbr[2] = { 0, 0 };
+        u64 m_vtcr = 0;
+        u64 m_vttbr = 0;
+        u16 m_asid = 0;
+        u16 m_asidMask = 0xFF;
+        u16 m_vmid = 0;
+
+        std::array<std::array<Entry, TLBWays>, TLBSets> m_entries;
+        std::array<u8, TLBSets> m_nextVictim = { };
+        u64 m_cachedShifts = 0;
+        TranslationStatistics m_statistics;
+    };
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace arm {
+
+    constexpr size_t MaxShadowStackDepth = 256;
+
+    class Profiler {
+    public:
+        explicit Profiler(u64 sampleInterval = 10'000);
+        ~Profiler();
+
+        void loadSymbols(const std::string &path);
+
+        void startTimer(std::chrono::microseconds period);
+        void stopTimer();
+
+        void writeReport(const std::string &path) const;
+        void writeFoldedStacks(const std::string &path) const;
+
+        void call(addr_t callSite) {
+            if (this->m_shadowStack.size() < MaxShadowStackDepth)
+                this->m_shadowStack.push_back(callSite);
+        }
+
+        void retire(addr_t pc) {
+            // Returns are detected by landing on the instruction after a recorded call site
+            while (!this->m_shadowStack.empty() && this->m_shadowStack.back() + InstructionWidth == pc)
+                this->m_shadowStack.pop_back();
+
+            if (this->m_timerRunning) {
+                if (this->m_timerExpired.load(std::memory_order_relaxed)) {
+                    this->m_timerExpired.store(false, std::memory_order_relaxed);
+                    this->sample(pc);
+                }
+            } else if (--this->m_countdown == 0) {
+                this->m_countdown = this->m_sampleInterval;
+                this->sample(pc);
+            }
+        }
+
+    private:
+        struct Symbol {
+            addr_t address;
+            u64 size;
+            std::string name;
+        };
+
+        void sample(addr_t pc);
+        [[nodiscard]] std::string symbolize(addr_t address) const;
+
+        u64 m_sampleInterval;
+        u64 m_countdown;
+        u64 m_totalSamples = 0;
+
+        std::vector<addr_t> m_shadowStack;
+        std::map<addr_t, u64> m_histogram;
+        std::map<std::vector<addr_t>, u64> m_stacks;
+        std::vector<Symbol> m_symbols;
+
+        bool m_timerRunning = false;
+        std::atomic<bool> m_timerExpired = false;
+        std::atomic<bool> m_timerStop = false;
+        std::thread m_timerThread;
+    };
+
+}
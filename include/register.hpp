@@ -101,6 +101,21 @@ namespace arm::core {
     };
 
 
+    // 128 bit Advanced SIMD register, aligned so it can be moved to and from host vector registers directly
+    struct alignas(16) VectorRegister {
+        VectorRegister() { this->D[0] = this->D[1] = 0; }
+
+        union {
+            u8  B[16];
+            u16 H[8];
+            u32 S[4];
+            u64 D[2];
+            float F32[4];
+            double F64[2];
+        };
+    };
+
+
     class GPRegister {
     public:
         constexpr core::RegisterDouble& operator[](u8 R) {
@@ -108,8 +123,15 @@ namespace arm::core {
                 return GPR[R];
             else if (R >= 32 && R <= 35)
                 return SP[R - 32];
-            else
-                return ZR;
+
+            // Writes to the zero register are discarded by clearing it again on the next access
+            static_cast<core::RegisterDouble&>(ZR).X = 0;
+            return ZR;
+        }
+
+        // For callers that already know R names one of X0 - X30 and can skip the checks above
+        constexpr core::RegisterDouble& direct(u8 R) {
+            return GPR[R];
         }
     private:
         core::RegisterDouble GPR[31];
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace arm {
+
+    // Virtual time is measured in retired instructions
+    using vtime_t = u64;
+    using EventId = u64;
+
+    constexpr vtime_t SchedulerQuantum = 10'000;
+
+    class Scheduler {
+    public:
+        using Callback = std::function<void()>;
+
+        EventId schedule(vtime_t time, Callback callback);
+        EventId scheduleIn(vtime_t delay, Callback callback);
+        void cancel(EventId id);
+
+        void beginQuantum(vtime_t length);
+        void advance(vtime_t time);
+
+        [[nodiscard]] vtime_t getTime() const;
+        [[nodiscard]] vtime_t getNextEventTime();
+
+        // Cores run up to this point, events scheduled during the quantum pull it in
+        [[nodiscard]] vtime_t getDeadline() const { return this->m_deadline; }
+
+    private:
+        struct Event {
+            vtime_t time;
+            EventId id;
+
+            bool operator>(const Event &other) const {
+                return time != other.time ? time > other.time : id > other.id;
+            }
+        };
+
+        void discardCancelledEvents();
+
+        vtime_t m_time = 0;
+        vtime_t m_deadline = 0;
+        EventId m_nextId = 0;
+
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+        std::unordered_map<EventId, Callback> m_callbacks;
+    };
+
+}
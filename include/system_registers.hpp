@@ -0,0 +1,60 @@
+#pragma once
+
+#include <arm.hpp>
+
+namespace arm {
+
+    // op0:op1:CRn:CRm:op2 exactly as found in bits 5 to 20 of MRS / MSR
+    constexpr u16 encodeSystemRegister(u8 op0, u8 op1, u8 CRn, u8 CRm, u8 op2) {
+        return ((op0 & 0b11) << 14) | ((op1 & 0b111) << 11) | ((CRn & 0b1111) << 7) | ((CRm & 0b1111) << 3) | (op2 & 0b111);
+    }
+
+    enum class SystemRegister : u16 {
+        MIDR_EL1        = encodeSystemRegister(3, 0,  0, 0, 0),
+        MPIDR_EL1       = encodeSystemRegister(3, 0,  0, 0, 5),
+        SCTLR_EL1       = encodeSystemRegister(3, 0,  1, 0, 0),
+        TTBR0_EL1       = encodeSystemRegister(3, 0,  2, 0, 0),
+        TTBR1_EL1       = encodeSystemRegister(3, 0,  2, 0, 1),
+        TCR_EL1         = encodeSystemRegister(3, 0,  2, 0, 2),
+        SPSR_EL1        = encodeSystemRegister(3, 0,  4, 0, 0),
+        ELR_EL1         = encodeSystemRegister(3, 0,  4, 0, 1),
+        SP_EL0          = encodeSystemRegister(3, 0,  4, 1, 0),
+        CurrentEL       = encodeSystemRegister(3, 0,  4, 2, 2),
+        ESR_EL1         = encodeSystemRegister(3, 0,  5, 2, 0),
+        FAR_EL1         = encodeSystemRegister(3, 0,  6, 0, 0),
+        MAIR_EL1        = encodeSystemRegister(3, 0, 10, 2, 0),
+        VBAR_EL1        = encodeSystemRegister(3, 0, 12, 0, 0),
+        TPIDR_EL1       = encodeSystemRegister(3, 0, 13, 0, 4),
+        CNTKCTL_EL1     = encodeSystemRegister(3, 0, 14, 1, 0),
+
+        SCTLR_EL2       = encodeSystemRegister(3, 4,  1, 0, 0),
+        HCR_EL2         = encodeSystemRegister(3, 4,  1, 1, 0),
+        VTTBR_EL2       = encodeSystemRegister(3, 4,  2, 1, 0),
+        VTCR_EL2        = encodeSystemRegister(3, 4,  2, 1, 2),
+        SPSR_EL2        = encodeSystemRegister(3, 4,  4, 0, 0),
+        ELR_EL2         = encodeSystemRegister(3, 4,  4, 0, 1),
+        SP_EL1          = encodeSystemRegister(3, 4,  4, 1, 0),
+        ESR_EL2         = encodeSystemRegister(3, 4,  5, 2, 0),
+        FAR_EL2         = encodeSystemRegister(3, 4,  6, 0, 0),
+        HPFAR_EL2       = encodeSystemRegister(3, 4,  6, 0, 4),
+        VBAR_EL2        = encodeSystemRegister(3, 4, 12, 0, 0),
+
+        DCZID_EL0       = encodeSystemRegister(3, 3,  0, 0, 7),
+        NZCV            = encodeSystemRegister(3, 3,  4, 2, 0),
+        DAIF            = encodeSystemRegister(3, 3,  4, 2, 1),
+        FPCR            = encodeSystemRegister(3, 3,  4, 4, 0),
+        FPSR            = encodeSystemRegister(3, 3,  4, 4, 1),
+        TPIDR_EL0       = encodeSystemRegister(3, 3, 13, 0, 2),
+        TPIDRRO_EL0     = encodeSystemRegister(3, 3, 13, 0, 3),
+        CNTFRQ_EL0      = encodeSystemRegister(3, 3, 14, 0, 0),
+        CNTPCT_EL0      = encodeSystemRegister(3, 3, 14, 0, 1),
+        CNTVCT_EL0      = encodeSystemRegister(3, 3, 14, 0, 2),
+        CNTP_TVAL_EL0   = encodeSystemRegister(3, 3, 14, 2, 0),
+        CNTP_CTL_EL0    = encodeSystemRegister(3, 3, 14, 2, 1),
+        CNTP_CVAL_EL0   = encodeSystemRegister(3, 3, 14, 2, 2),
+        CNTV_TVAL_EL0   = encodeSystemRegister(3, 3, 14, 3, 0),
+        CNTV_CTL_EL0    = encodeSystemRegister(3, 3, 14, 3, 1),
+        CNTV_CVAL_EL0   = encodeSystemRegister(3, 3, 14, 3, 2)
+    };
+
+}
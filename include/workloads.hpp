@@ -0,0 +1,28 @@
+#pragma once
+
+#include <arm.hpp>
+
+#include "core.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arm {
+
+    struct Workload {
+        const char *name;
+        std::vector<std::pair<u8, u64>> expectedRegisters;
+    };
+
+    struct WorkloadResult {
+        const char *name;
+        u64 retiredInstructions;
+        double seconds;
+        bool passed;
+    };
+
+    [[nodiscard]] const std::vector<Workload>& getWorkloads();
+    std::vector<WorkloadResult> runWorkloads(const std::string &directory, ExecutionEngine engine, bool lockstep, bool fastmem);
+
+}
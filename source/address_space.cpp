@@ -9,9 +9,35 @@ namespace arm {
                         baseAddress, baseAddress + newDevice->getSize(), regionBase, regionBase + device->getSize());
 
         this->m_memoryRegions.insert({ baseAddress, newDevice });
+
+        newDevice->setCodeWriteHandler([this, baseAddress](offset_t page) {
+            if (this->m_codeWriteHandler)
+                this->m_codeWriteHandler(baseAddress + page);
+        });
+
+        if (this->m_fastmem != nullptr)
+            (void)this->m_fastmem->map(newDevice, baseAddress);
+    }
+
+    bool AddressSpace::enableFastmem() {
+        if (!Fastmem::isSupported())
+            return false;
+
+        if (this->m_fastmem == nullptr) {
+            this->m_fastmem = std::make_unique<Fastmem>();
+
+            for (auto &[baseAddress, device] : this->m_memoryRegions)
+                (void)this->m_fastmem->map(device, baseAddress);
+        }
+
+        return true;
     }
 
     u64 AddressSpace::read(addr_t address, size_t size) {
+        // Faults on pages that aren't mirrored, MMIO and unmapped addresses, fall through to the device lookup
+        if (u64 value; this->m_fastmem != nullptr && this->m_fastmem->read(address, size, value))
+            return value;
+
         for (auto &[baseAddress, device] : this->m_memoryRegions)
             if (address + size >= baseAddress && address <= baseAddress + device->getSize()) {
                 return device->read(address - baseAddress, size);
@@ -21,6 +47,9 @@ namespace arm {
     }
 
     void AddressSpace::write(addr_t address, size_t size, u64 value) {
+        if (this->m_fastmem != nullptr && this->m_fastmem->write(address, size, value))
+            return;
+
         for (auto &[baseAddress, device] : this->m_memoryRegions)
             if (address + size >= baseAddress && address <= baseAddress + device->getSize()) {
                 device->write(address - baseAddress, size, value);
@@ -30,4 +59,35 @@ namespace arm {
         Logger::fatal("Tried to write to an invalid address at %016llx!", address);
     }
 
+    u8* AddressSpace::getHostPointer(addr_t address, size_t size, bool write) {
+        for (auto &[baseAddress, device] : this->m_memoryRegions)
+            if (address >= baseAddress && address + size <= baseAddress + device->getSize())
+                return device->getHostPointer(address - baseAddress, size, write);
+
+        return nullptr;
+    }
+
+    void AddressSpace::commitWrite(addr_t address, size_t size) {
+        if (!Device::isWriteTrackingActive()) [[likely]]
+            return;
+
+        for (auto &[baseAddress, device] : this->m_memoryRegions)
+            if (address >= baseAddress && address + size <= baseAddress + device->getSize()) {
+                device->commitWrite(address - baseAddress, size);
+                return;
+            }
+    }
+
+    void AddressSpace::markCode(addr_t address) {
+        for (auto &[baseAddress, device] : this->m_memoryRegions)
+            if (address >= baseAddress && address < baseAddress + device->getSize()) {
+                device->markCode(address - baseAddress);
+                return;
+            }
+    }
+
+    void AddressSpace::setCodeWriteHandler(CodeWriteHandler handler) {
+        this->m_codeWriteHandler = std::move(handler);
+    }
+
 }
\ No newline at end of file
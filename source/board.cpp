@@ -2,6 +2,9 @@
 
 #include "devices/memory.hpp"
 #include "devices/uart.hpp"
+#include "devices/gic.hpp"
+
+#include <limits>
 
 namespace arm {
 
@@ -12,15 +15,32 @@ namespace arm {
         FLASH = new dev::Memory(100_MiB);
 
         UART1 = new dev::UART();
+        GIC   = new dev::GIC();
+
+        // Everything lives below 48 bits so it stays reachable once the MMU is on
+        CPU.addDeviceToAddressSpace(BROM,  0x0000'0000);
+        CPU.addDeviceToAddressSpace(IRAM,  0x1000'0000);
+        CPU.addDeviceToAddressSpace(DRAM,  0x2000'0000);
+        CPU.addDeviceToAddressSpace(FLASH, 0x3000'0000);
+        CPU.addDeviceToAddressSpace(UART1, 0x8000'0000);
+        CPU.addDeviceToAddressSpace(GIC,   0x8001'0000);
+
+        auto gic = Device::as<dev::GIC>(GIC);
+        for (u8 coreId = 0; coreId < CPU.getCoreCount(); coreId++) {
+            auto &core = CPU.getCore(coreId);
+
+            gic->connectCore(&core);
+            core.getTimer().setInterruptHandler([gic, coreId](GenericTimer::Channel channel, bool level) {
+                gic->setLevel(coreId, channel == GenericTimer::Channel::Physical ? PhysicalTimerInterrupt : VirtualTimerInterrupt, level);
+            });
+        }
+        CPU.addDeviceToAddressSpace(gic->getCpuInterface(0), 0x8002'0000);
 
-        CPU.addDeviceToAddressSpace(BROM,  0x0000'0000'0000'0000);
-        CPU.addDeviceToAddressSpace(IRAM,  0x1000'0000'0000'0000);
-        CPU.addDeviceToAddressSpace(DRAM,  0x2000'0000'0000'0000);
-        CPU.addDeviceToAddressSpace(FLASH, 0x3000'0000'0000'0000);
-        CPU.addDeviceToAddressSpace(UART1, 0x8000'0000'0000'0000);
+        this->CPU.attachScheduler(&this->m_scheduler);
+        Device::as<dev::UART>(UART1)->attachScheduler(&this->m_scheduler);
 
         //Device::as<dev::Memory>(BROM)->load("test.elf");
-        Device::as<dev::Memory>(BROM)->load((const u8*)"\x00\x00\x80\xd2\x00\x00\xa0\xf2\x00\x00\xc0\xf2\x00\x00\xf0\xf2\x21\x08\x80\xd2\x01\x00\x00\xf9", 24);
+        Device::as<dev::Memory>(BROM)->load((const u8*)"\x00\x00\x80\xd2\x00\x00\xa0\xf2\x00\x00\xc0\xf2\x00\x00\xb0\xf2\x21\x08\x80\xd2\x01\x00\x00\xf9", 24);
 
         this->CPU.reset();
     }
@@ -28,6 +48,9 @@ namespace arm {
     Board::~Board() {
         this->CPU.reset();
 
+        delete GIC;
+        delete UART1;
+
         delete FLASH;
         delete DRAM;
         delete IRAM;
@@ -40,12 +63,28 @@ namespace arm {
 
     void Board::tick() {
         if (this->m_powered) {
-            this->CPU.tick();
+            if (this->CPU.isIdle()) {
+                // Nothing left to execute, skip straight to the next event. Without one only another host thread can wake the cores up,
+                // the wait still buffers host input for the UART as it comes in
+                const vtime_t nextEvent = this->m_scheduler.getNextEventTime();
+                if (nextEvent == std::numeric_limits<vtime_t>::max()) {
+                    Device::as<dev::UART>(UART1)->waitForInput(IdleSleepPeriod);
+                    return;
+                }
 
-            for (u8 coreId = 0; coreId < this->CPU.getCoreCount(); coreId++) {
-                auto& core = this->CPU.getCore(coreId);
+                this->m_scheduler.beginQuantum(nextEvent - this->m_scheduler.getTime());
+            } else {
+                // Run every core up to the next device event, then let the devices catch up
+                this->m_scheduler.beginQuantum(SchedulerQuantum);
             }
+
+            this->CPU.run(this->m_scheduler);
+            this->m_scheduler.advance(std::min(this->m_scheduler.getDeadline(), this->CPU.getVirtualTime()));
         }
     }
 
+    Scheduler& Board::getScheduler() {
+        return this->m_scheduler;
+    }
+
 }
\ No newline at end of file
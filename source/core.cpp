@@ -1,5 +1,8 @@
 #include "core.hpp"
+#include "profiler.hpp"
+
 #include <bit>
+#include <cstring>
 #include <thread>
 #include <chrono>
 
@@ -7,13 +10,27 @@ using namespace std::chrono_literals;
 
 namespace arm {
 
-    Core::Core(AddressSpace *addressSpace) : m_addressSpace(addressSpace) {
+    Core::Core(AddressSpace *addressSpace) : m_addressSpace(addressSpace), m_mmu(addressSpace) {
         this->m_halted = true;
+
+        // Blocks may still be executing when the TLB gets invalidated, so they're dropped at the next block boundary instead
+        this->m_mmu.setInvalidationHandler([this](std::optional<u16> vmid, std::optional<u16> asid, std::optional<addr_t> address) {
+            this->queueBlockInvalidation({ .vmid = vmid, .asid = asid, .address = address });
+        });
+        this->m_blockCache = &this->m_blockCaches[UntranslatedContext];
+    }
+
+    Core::~Core() {
+        this->releaseFloatingPoint();
     }
 
-    constexpr auto Core::getInstructionPatternLUT() const {
+    constexpr auto Core::getInstructionPatternLUT() {
         constexpr std::array lut {
             INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1111'1111, 0b1101'0101'0000'0011'0010'0000'0001'1111, NOP),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1111'1111, 0b1101'0101'0000'0011'0010'0000'0111'1111, WFI),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1111'1111, 0b1101'0101'0000'0011'0010'0000'0101'1111, WFE),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1111'1111, 0b1101'0101'0000'0011'0010'0000'1001'1111, SEV),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1111'1111, 0b1101'0101'0000'0011'0010'0000'1011'1111, SEVL),
             INSTRUCTION(0b0111'1111'1000'0000'0000'0000'0000'0000, 0b0011'0010'0000'0000'0000'0000'0000'0000, ORR_IMMEDIATE), // MOV Alias
             INSTRUCTION(0b0111'1111'0010'0000'0000'0000'0000'0000, 0b0010'1010'0000'0000'0000'0000'0000'0000, ORR_SHIFTED_REGISTER), // MOV Alias
             INSTRUCTION(0b1111'1100'0000'0000'0000'0000'0000'0000, 0b0001'0100'0000'0000'0000'0000'0000'0000, B),
@@ -29,34 +46,132 @@ namespace arm {
             INSTRUCTION(0b0111'1111'1110'0000'0000'1100'0001'0000, 0b0011'1010'0100'0000'0000'1000'0000'0000, CCMN_IMMEDIATE),
             INSTRUCTION(0b0111'1111'1110'0000'0000'1100'0001'0000, 0b0011'1010'0100'0000'0000'0000'0000'0000, CCMN_REGISTER),
             INSTRUCTION(0b1111'1111'1110'0000'0000'0000'0001'1111, 0b1101'0100'0000'0000'0000'0000'0000'0001, SVC),
+            INSTRUCTION(0b1111'1111'1110'0000'0000'0000'0001'1111, 0b1101'0100'0000'0000'0000'0000'0000'0010, HVC),
+            INSTRUCTION(0b1111'1111'1110'0000'0000'0000'0001'1111, 0b1101'0100'0100'0000'0000'0000'0000'0000, HLT),
             INSTRUCTION(0b1001'1111'0000'0000'0000'0000'0000'0000, 0b1001'0000'0000'0000'0000'0000'0000'0000, ADRP),
             INSTRUCTION(0b0111'1111'1000'0000'0000'0000'0000'0000, 0b0001'0010'0000'0000'0000'0000'0000'0000, AND_IMMEDIATE),
             INSTRUCTION(0b0111'1111'0010'0000'0000'0000'0000'0000, 0b0000'1010'0000'0000'0000'0000'0000'0000, AND_SHIFTED_REGISTER),
             INSTRUCTION(0b0111'1111'1000'0000'0000'0000'0000'0000, 0b0111'0010'0000'0000'0000'0000'0000'0000, ANDS_IMMEDIATE),
             INSTRUCTION(0b0111'1111'0010'0000'0000'0000'0000'0000, 0b0110'1010'0000'0000'0000'0000'0000'0000, ANDS_SHIFTED_REGISTER),
-            INSTRUCTION(0b1011'1100'1110'0000'0000'0000'0000'0000, 0b1011'1000'0000'0000'0000'0000'0000'0000, STR_IMMEDIATE),
-            INSTRUCTION(0b1011'1111'1110'0000'0000'1100'0000'0000, 0b1011'1000'0010'0000'0000'1000'0000'0000, STR_REGISTER),
-            INSTRUCTION(0b1011'1100'1110'0000'0000'0000'0000'0000, 0b1011'1000'0100'0000'0000'0000'0000'0000, LDR_IMMEDIATE),
-            INSTRUCTION(0b1011'1111'1110'0000'0000'1100'0000'0000, 0b1011'1000'0110'0000'0000'1000'0000'0000, LDR_REGISTER),
-            INSTRUCTION(0b0111'1110'0000'0000'0000'0000'0000'0000, 0b0011'0100'0000'0000'0000'0000'0000'0000, CBZ),
-            INSTRUCTION(0b0001'1111'1000'0000'0000'0000'0000'0000, 0b0001'0010'1000'0000'0000'0000'0000'0000, MOVNZK)
+            INSTRUCTION(0b0011'1111'1110'0000'0000'0000'0000'0000, 0b0011'1000'0000'0000'0000'0000'0000'0000, STR_IMMEDIATE), // STRB, STRH, STUR
+            INSTRUCTION(0b0011'1111'1100'0000'0000'0000'0000'0000, 0b0011'1001'0000'0000'0000'0000'0000'0000, STR_IMMEDIATE), // Unsigned offset
+            INSTRUCTION(0b0011'1111'1110'0000'0000'1100'0000'0000, 0b0011'1000'0010'0000'0000'1000'0000'0000, STR_REGISTER),
+            INSTRUCTION(0b0011'1111'1110'0000'0000'0000'0000'0000, 0b0011'1000'0100'0000'0000'0000'0000'0000, LDR_IMMEDIATE), // LDRB, LDRH, LDUR
+            INSTRUCTION(0b0011'1111'1100'0000'0000'0000'0000'0000, 0b0011'1001'0100'0000'0000'0000'0000'0000, LDR_IMMEDIATE), // Unsigned offset
+            INSTRUCTION(0b0011'1111'1110'0000'0000'1100'0000'0000, 0b0011'1000'0110'0000'0000'1000'0000'0000, LDR_REGISTER),
+            INSTRUCTION(0b0111'1111'0000'0000'0000'0000'0000'0000, 0b0011'0100'0000'0000'0000'0000'0000'0000, CBZ),
+            INSTRUCTION(0b0111'1111'0000'0000'0000'0000'0000'0000, 0b0011'0101'0000'0000'0000'0000'0000'0000, CBNZ),
+            INSTRUCTION(0b0001'1111'1000'0000'0000'0000'0000'0000, 0b0001'0010'1000'0000'0000'0000'0000'0000, MOVNZK),
+            INSTRUCTION(0b1111'1111'1111'0000'0000'0000'0000'0000, 0b1101'0101'0011'0000'0000'0000'0000'0000, MRS),
+            INSTRUCTION(0b1111'1111'1111'0000'0000'0000'0000'0000, 0b1101'0101'0001'0000'0000'0000'0000'0000, MSR_REGISTER),
+            INSTRUCTION(0b1111'1111'1111'1000'1111'0000'0001'1111, 0b1101'0101'0000'0000'0100'0000'0001'1111, MSR_IMMEDIATE),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1110'0000, 0b1101'0101'0000'1011'0111'0100'0010'0000, DC_ZVA),
+            INSTRUCTION(0b1111'1111'1111'1000'0000'0000'0000'0000, 0b1101'0101'0000'1000'0000'0000'0000'0000, SYS),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'1111'1111'1111, 0b1101'0110'1001'1111'0000'0011'1110'0000, ERET),
+            INSTRUCTION(0b0011'1111'0000'0000'0000'0000'0000'0000, 0b0011'1101'0000'0000'0000'0000'0000'0000, SIMD_LOAD_STORE_IMMEDIATE),
+            INSTRUCTION(0b0011'1111'0000'0000'0000'0000'0000'0000, 0b0011'1100'0000'0000'0000'0000'0000'0000, SIMD_LOAD_STORE),
+            INSTRUCTION(0b0011'1110'0000'0000'0000'0000'0000'0000, 0b0010'1100'0000'0000'0000'0000'0000'0000, SIMD_LOAD_STORE_PAIR),
+            INSTRUCTION(0b1011'1111'0010'0000'0000'0000'0000'0000, 0b0000'1100'0000'0000'0000'0000'0000'0000, SIMD_LOAD_STORE_MULTIPLE),
+            INSTRUCTION(0b1011'1111'0110'0000'1111'0000'0000'0000, 0b0000'1101'0100'0000'1100'0000'0000'0000, SIMD_LOAD_REPLICATE),
+            INSTRUCTION(0b1001'1111'0010'0000'1100'0100'0000'0000, 0b0000'1110'0010'0000'1100'0100'0000'0000, SIMD_FLOAT_THREE_SAME),
+            INSTRUCTION(0b1001'1111'0010'0000'0000'0100'0000'0000, 0b0000'1110'0010'0000'0000'0100'0000'0000, SIMD_THREE_SAME),
+            INSTRUCTION(0b1001'1111'0010'0000'0000'1100'0000'0000, 0b0000'1110'0010'0000'0000'0000'0000'0000, SIMD_THREE_DIFFERENT),
+            INSTRUCTION(0b1001'1111'0011'1110'0000'1100'0000'0000, 0b0000'1110'0010'0000'0000'1000'0000'0000, SIMD_TWO_REGISTER_MISC),
+            INSTRUCTION(0b1001'1111'0011'1110'0000'1100'0000'0000, 0b0000'1110'0011'0000'0000'1000'0000'0000, SIMD_ACROSS_LANES),
+            INSTRUCTION(0b1001'1111'1110'0000'1000'0100'0000'0000, 0b0000'1110'0000'0000'0000'0100'0000'0000, SIMD_COPY),
+            INSTRUCTION(0b1011'1111'0010'0000'1000'1100'0000'0000, 0b0000'1110'0000'0000'0000'1000'0000'0000, SIMD_PERMUTE),
+            INSTRUCTION(0b1011'1111'1110'0000'1000'0100'0000'0000, 0b0010'1110'0000'0000'0000'0000'0000'0000, SIMD_EXTRACT),
+            INSTRUCTION(0b1011'1111'1110'0000'1000'1100'0000'0000, 0b0000'1110'0000'0000'0000'0000'0000'0000, SIMD_TABLE_LOOKUP),
+            INSTRUCTION(0b1001'1111'1111'1000'0000'1100'0000'0000, 0b0000'1111'0000'0000'0000'0100'0000'0000, SIMD_MODIFIED_IMMEDIATE), // Has to come before the shifts, immh == 0
+            INSTRUCTION(0b1001'1111'1000'0000'0000'0100'0000'0000, 0b0000'1111'0000'0000'0000'0100'0000'0000, SIMD_SHIFT_IMMEDIATE),
+            INSTRUCTION(0b1001'1111'0000'0000'0000'0100'0000'0000, 0b0000'1111'0000'0000'0000'0000'0000'0000, SIMD_BY_ELEMENT),
+            INSTRUCTION(0b0111'1111'0010'0000'1111'1100'0000'0000, 0b0001'1110'0010'0000'0000'0000'0000'0000, FP_CONVERT_INTEGER),
+            INSTRUCTION(0b1111'1111'0010'0000'0111'1100'0000'0000, 0b0001'1110'0010'0000'0100'0000'0000'0000, FP_ONE_SOURCE),
+            INSTRUCTION(0b1111'1111'0010'0000'1111'1100'0000'0111, 0b0001'1110'0010'0000'0010'0000'0000'0000, FP_COMPARE),
+            INSTRUCTION(0b1111'1111'0010'0000'0001'1111'1110'0000, 0b0001'1110'0010'0000'0001'0000'0000'0000, FP_IMMEDIATE),
+            INSTRUCTION(0b1111'1111'0010'0000'0000'1100'0000'0000, 0b0001'1110'0010'0000'0000'0100'0000'0000, FP_CONDITIONAL_COMPARE),
+            INSTRUCTION(0b1111'1111'0010'0000'0000'1100'0000'0000, 0b0001'1110'0010'0000'0000'1000'0000'0000, FP_TWO_SOURCE),
+            INSTRUCTION(0b1111'1111'0010'0000'0000'1100'0000'0000, 0b0001'1110'0010'0000'0000'1100'0000'0000, FP_CONDITIONAL_SELECT),
+            INSTRUCTION(0b1111'1111'0000'0000'0000'0000'0000'0000, 0b0001'1111'0000'0000'0000'0000'0000'0000, FP_THREE_SOURCE),
+            INSTRUCTION(0b1111'1111'1111'1111'1100'1100'0000'0000, 0b0100'1110'0010'1000'0100'1000'0000'0000, AES),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'1100'0000'0000, 0b0101'1110'0000'0000'0000'0000'0000'0000, SHA_THREE_REGISTER),
+            INSTRUCTION(0b1111'1111'1111'1111'1100'1100'0000'0000, 0b0101'1110'0010'1000'0000'1000'0000'0000, SHA_TWO_REGISTER),
+            INSTRUCTION(0b0111'1111'1110'0000'1110'0000'0000'0000, 0b0001'1010'1100'0000'0100'0000'0000'0000, CRC32),
+            INSTRUCTION(0b0111'1111'1110'0000'1000'0000'0000'0000, 0b0001'1011'0000'0000'0000'0000'0000'0000, MADD),
+            INSTRUCTION(0b0111'1111'1110'0000'1000'0000'0000'0000, 0b0001'1011'0000'0000'1000'0000'0000'0000, MSUB),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'0000'0000'0000, 0b1001'1011'0010'0000'0000'0000'0000'0000, SMADDL),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'0000'0000'0000, 0b1001'1011'0010'0000'1000'0000'0000'0000, SMSUBL),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'0000'0000'0000, 0b1001'1011'1010'0000'0000'0000'0000'0000, UMADDL),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'0000'0000'0000, 0b1001'1011'1010'0000'1000'0000'0000'0000, UMSUBL),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'0000'0000'0000, 0b1001'1011'0100'0000'0000'0000'0000'0000, SMULH),
+            INSTRUCTION(0b1111'1111'1110'0000'1000'0000'0000'0000, 0b1001'1011'1100'0000'0000'0000'0000'0000, UMULH),
+            INSTRUCTION(0b0111'1111'1110'0000'1111'1100'0000'0000, 0b0001'1010'1100'0000'0000'1100'0000'0000, SDIV),
+            INSTRUCTION(0b0111'1111'1110'0000'1111'1100'0000'0000, 0b0001'1010'1100'0000'0000'1000'0000'0000, UDIV),
+            INSTRUCTION(0b0111'1111'1111'1111'1111'1100'0000'0000, 0b0101'1010'1100'0000'0000'0000'0000'0000, RBIT),
+            INSTRUCTION(0b0111'1111'1111'1111'1111'1100'0000'0000, 0b0101'1010'1100'0000'0000'0100'0000'0000, REV16),
+            INSTRUCTION(0b0111'1111'1111'1111'1111'1000'0000'0000, 0b0101'1010'1100'0000'0000'1000'0000'0000, REV), // REV32
+            INSTRUCTION(0b0111'1111'1111'1111'1111'1100'0000'0000, 0b0101'1010'1100'0000'0001'0000'0000'0000, CLZ),
+            INSTRUCTION(0b0111'1111'1111'1111'1111'1100'0000'0000, 0b0101'1010'1100'0000'0001'0100'0000'0000, CLS),
+            INSTRUCTION(0b0011'1111'1110'0000'0000'1000'0000'0000, 0b0001'1010'1000'0000'0000'0000'0000'0000, CSEL), // CSINC, CSINV, CSNEG
+            INSTRUCTION(0b0111'1111'1000'0000'0000'0000'0000'0000, 0b0001'0011'0000'0000'0000'0000'0000'0000, SBFM), // ASR, SXTB, SXTH, SXTW, SBFIZ, SBFX Alias
+            INSTRUCTION(0b0111'1111'1000'0000'0000'0000'0000'0000, 0b0011'0011'0000'0000'0000'0000'0000'0000, BFM), // BFI, BFXIL Alias
+            INSTRUCTION(0b0111'1111'1000'0000'0000'0000'0000'0000, 0b0101'0011'0000'0000'0000'0000'0000'0000, UBFM), // LSL, LSR, UXTB, UXTH, UBFIZ, UBFX Alias
+            INSTRUCTION(0b0011'1110'0100'0000'0000'0000'0000'0000, 0b0010'1000'0000'0000'0000'0000'0000'0000, STP),
+            INSTRUCTION(0b0011'1110'0100'0000'0000'0000'0000'0000, 0b0010'1000'0100'0000'0000'0000'0000'0000, LDP), // LDPSW
+            INSTRUCTION(0b0011'1111'1010'0000'0000'0000'0000'0000, 0b0011'1000'1000'0000'0000'0000'0000'0000, LDRS_IMMEDIATE), // LDRSB, LDRSH, LDRSW, LDURSB, LDURSH, LDURSW
+            INSTRUCTION(0b0011'1111'1000'0000'0000'0000'0000'0000, 0b0011'1001'1000'0000'0000'0000'0000'0000, LDRS_IMMEDIATE), // Unsigned offset
+            INSTRUCTION(0b0011'1111'1010'0000'0000'1100'0000'0000, 0b0011'1000'1010'0000'0000'1000'0000'0000, LDRS_REGISTER),
+            INSTRUCTION(0b0011'1011'0000'0000'0000'0000'0000'0000, 0b0001'1000'0000'0000'0000'0000'0000'0000, LDR_LITERAL),
+            INSTRUCTION(0b0011'1111'1000'0000'0000'0000'0000'0000, 0b0000'1000'0000'0000'0000'0000'0000'0000, LOAD_STORE_EXCLUSIVE), // LDXR, STXR, LDAXR, STLXR, LDXP, STXP
+            INSTRUCTION(0b0011'1111'1010'0000'0000'0000'0000'0000, 0b0000'1000'1000'0000'0000'0000'0000'0000, LOAD_ACQUIRE_STORE_RELEASE), // LDAR, STLR, LDLAR, STLLR
+            INSTRUCTION(0b0011'1111'1010'0000'0111'1100'0000'0000, 0b0000'1000'1010'0000'0111'1100'0000'0000, CAS),
+            INSTRUCTION(0b0011'1111'0010'0000'0000'1100'0000'0000, 0b0011'1000'0010'0000'0000'0000'0000'0000, ATOMIC_MEMORY), // LDADD, LDCLR, LDEOR, LDSET, LD{S,U}{MAX,MIN}, SWP
+            INSTRUCTION(0b1111'1111'1111'1111'1111'0000'1111'1111, 0b1101'0101'0000'0011'0011'0000'0101'1111, CLREX),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'0000'1111'1111, 0b1101'0101'0000'0011'0011'0000'1011'1111, DMB),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'0000'1111'1111, 0b1101'0101'0000'0011'0011'0000'1001'1111, DSB),
+            INSTRUCTION(0b1111'1111'1111'1111'1111'0000'1111'1111, 0b1101'0101'0000'0011'0011'0000'1101'1111, ISB)
             //INSTRUCTION(0b0111'1111'1110'0000'0000'1100'0001'0000, 0b0111'1010'0100'0000'0000'1000'0000'0000, CCMP_IMMEDIATE),
         };
 
         return lut;
     }
 
-    inst_t Core::prefetch(const addr_t &pc) const {
-        return inst_t(this->m_addressSpace->read(pc, InstructionWidth));
+    std::span<const InstructionPattern> Core::getInstructionPatterns() {
+        static constexpr auto lut = getInstructionPatternLUT();
+
+        return lut;
+    }
+
+    inst_t Core::prefetch(const addr_t &pc) {
+        return inst_t(this->m_addressSpace->read(this->m_mmu.translate(pc, AccessType::Execute, PSTATE.EL != 0), InstructionWidth));
+    }
+
+    std::optional<u16> Core::findInstructionPattern(inst_t instruction) {
+        constexpr auto lut = getInstructionPatternLUT();
+
+        for (u16 index = 0; index < lut.size(); index++) {
+            if ((instruction & lut[index].mask) == lut[index].pattern)
+                return index;
+        }
+
+        return std::nullopt;
+    }
+
+    const char* Core::getInstructionName(inst_t instruction) {
+        if (auto index = findInstructionPattern(instruction); index.has_value())
+            return getInstructionPatterns()[*index].name;
+        else
+            return "<invalid>";
     }
 
     InstructionHandler Core::decode(const inst_t &instruction) {
-        for (const InstructionPattern& entry : getInstructionPatternLUT()) {
-            if ((instruction & entry.mask) == entry.pattern) {
-                this->m_currInstruction = entry;
-                //Logger::debug("[%08llx] %s (0x%lX)", PC.W, entry.name, instruction);
-                return entry.type;
-            }
+        if (auto index = findInstructionPattern(instruction); index.has_value()) {
+            const InstructionPattern &entry = getInstructionPatterns()[*index];
+
+            this->m_currInstruction = entry;
+            this->m_currInstructionIndex = *index;
+            //Logger::debug("[%08llx] %s (0x%lX)", PC.W, entry.name, instruction);
+            return entry.type;
         }
 
         /*dumpRegisters();
@@ -82,30 +197,438 @@ namespace arm {
         (this->*handler)(instruction, Rd, Rn, Rm, sf, imm3, imm6, imm12, shift, size);
     }
 
+    u64 Core::readMemory(addr_t address, size_t size) {
+        if (this->m_collectStatistics)
+            this->m_instructionStatistics[this->m_currInstructionIndex].memoryBytes += size;
+
+        // Accesses straddling a page are split up so each byte gets translated on its own
+        if (this->m_mmu.isEnabled() && (address & (MinimumPageSize - 1)) + size > MinimumPageSize) {
+            u64 value = 0;
+            for (size_t i = 0; i < size; i++)
+                value |= this->m_addressSpace->read(this->m_mmu.translate(address + i, AccessType::Read, PSTATE.EL != 0), 1) << (i * 8);
+
+            return value;
+        }
+
+        return this->m_addressSpace->read(this->m_mmu.translate(address, AccessType::Read, PSTATE.EL != 0), size);
+    }
+
+    void Core::writeMemory(addr_t address, size_t size, u64 value) {
+        if (this->m_collectStatistics)
+            this->m_instructionStatistics[this->m_currInstructionIndex].memoryBytes += size;
+
+        if (this->m_memoryWriteLog != nullptr)
+            this->m_memoryWriteLog->push_back({ address, size, value });
+
+        if (this->m_mmu.isEnabled() && (address & (MinimumPageSize - 1)) + size > MinimumPageSize) {
+            // Translate everything first so a fault on the second page doesn't leave a partial write behind
+            std::array<addr_t, sizeof(u64)> physical;
+            for (size_t i = 0; i < size; i++)
+                physical[i] = this->m_mmu.translate(address + i, AccessType::Write, PSTATE.EL != 0);
+            for (size_t i = 0; i < size; i++)
+                this->m_addressSpace->write(physical[i], 1, value >> (i * 8));
+
+            return;
+        }
+
+        this->m_addressSpace->write(this->m_mmu.translate(address, AccessType::Write, PSTATE.EL != 0), size, value);
+    }
+
+    // Pairs and vectors within a single page of RAM are copied in one go instead of dispatching every element to the device
+    void Core::readMemoryBlock(addr_t address, size_t size, void *buffer) {
+        auto bytes = static_cast<u8*>(buffer);
+
+        if (!this->m_mmu.isEnabled() || (address & (MinimumPageSize - 1)) + size <= MinimumPageSize) {
+            const addr_t physical = this->m_mmu.translate(address, AccessType::Read, PSTATE.EL != 0);
+            if (const u8 *host = this->m_addressSpace->getHostPointer(physical, size, false); host != nullptr) {
+                if (this->m_collectStatistics)
+                    this->m_instructionStatistics[this->m_currInstructionIndex].memoryBytes += size;
+
+                std::memcpy(bytes, host, size);
+                return;
+            }
+        }
+
+        for (size_t offset = 0; offset < size; offset += sizeof(u64)) {
+            const size_t chunkSize = std::min(size - offset, sizeof(u64));
+            const u64 value = this->readMemory(address + offset, chunkSize);
+            std::memcpy(bytes + offset, &value, chunkSize);
+        }
+    }
+
+    void Core::writeMemoryBlock(addr_t address, size_t size, const void *buffer) {
+        auto bytes = static_cast<const u8*>(buffer);
+
+        if (!this->m_mmu.isEnabled() || (address & (MinimumPageSize - 1)) + size <= MinimumPageSize) {
+            const addr_t physical = this->m_mmu.translate(address, AccessType::Write, PSTATE.EL != 0);
+            if (u8 *host = this->m_addressSpace->getHostPointer(physical, size, true); host != nullptr) {
+                if (this->m_collectStatistics)
+                    this->m_instructionStatistics[this->m_currInstructionIndex].memoryBytes += size;
+
+                if (this->m_memoryWriteLog != nullptr) {
+                    for (size_t offset = 0; offset < size; offset += sizeof(u64)) {
+                        const size_t chunkSize = std::min(size - offset, sizeof(u64));
+                        u64 value = 0;
+                        std::memcpy(&value, bytes + offset, chunkSize);
+                        this->m_memoryWriteLog->push_back({ address + offset, chunkSize, value });
+                    }
+                }
+
+                std::memcpy(host, bytes, size);
+                this->m_addressSpace->commitWrite(physical, size);
+                return;
+            }
+        } else {
+            // Fault on the second page before anything has been written
+            (void)this->m_mmu.translate((address | (MinimumPageSize - 1)) + 1, AccessType::Write, PSTATE.EL != 0);
+        }
+
+        for (size_t offset = 0; offset < size; offset += sizeof(u64)) {
+            const size_t chunkSize = std::min(size - offset, sizeof(u64));
+            u64 value = 0;
+            std::memcpy(&value, bytes + offset, chunkSize);
+            this->writeMemory(address + offset, chunkSize, value);
+        }
+    }
+
+    void Core::setInterruptPending(bool pending) {
+        this->m_interruptPending.store(pending, std::memory_order_release);
+    }
+
+    void Core::signalEvent() {
+        this->m_eventRegister.store(true, std::memory_order_release);
+    }
+
+    void Core::setBroadcastHandler(BroadcastHandler handler) {
+        this->m_broadcastHandler = std::move(handler);
+    }
+
+    void Core::broadcast(const std::function<void(Core&)> &operation) {
+        if (this->m_broadcastHandler)
+            this->m_broadcastHandler(operation);
+        else
+            operation(*this);
+    }
+
+    void Core::takeException(ExceptionType type, u8 targetEL) {
+        const u8 sourceEL = PSTATE.EL;
+
+        u64 vectorBase;
+        if (sourceEL < targetEL)
+            vectorBase = 0x400;
+        else if (PSTATE.SP)
+            vectorBase = 0x200;
+        else
+            vectorBase = 0x000;
+
+        SPSR[targetEL].X = this->getProcessState();
+        ELR[targetEL].X = PC.X;
+
+        PSTATE.EL = targetEL;
+        PSTATE.SP = 1;
+        PSTATE.D = PSTATE.A = PSTATE.I = PSTATE.F = 1;
+
+        PC = VBAR[targetEL].X + vectorBase + u16(type);
+        this->m_exclusiveValid = false;
+
+        // EL2 runs outside of the EL1&0 translation regime
+        if ((sourceEL == 2) != (targetEL == 2))
+            this->updateTranslationRegime();
+        else if (sourceEL != targetEL)
+            this->updateBlockContext();
+    }
+
+    void Core::takeAbort(const TranslationFault &fault) {
+        // Stage 2 faults go to the hypervisor, which always means coming from a lower exception level
+        const u8 targetEL = fault.stage2 ? 2 : std::max<u8>(PSTATE.EL, 1);
+        const bool fromLowerEL = PSTATE.EL < targetEL;
+
+        u32 exceptionClass;
+        u32 syndrome = fault.faultStatus;
+        if (fault.access == AccessType::Execute) {
+            exceptionClass = fromLowerEL ? 0x20 : 0x21;
+        } else {
+            exceptionClass = fromLowerEL ? 0x24 : 0x25;
+            if (fault.access == AccessType::Write && !fault.stage1Walk)
+                syndrome |= 1 << 6;
+
+            // Data aborts happen after PC already moved past the faulting instruction
+            PC -= InstructionWidth;
+        }
+
+        if (fault.stage1Walk)
+            syndrome |= 1 << 7;
+
+        this->takeException(ExceptionType::Synchronous, targetEL);
+
+        ESR[targetEL].X = exceptionClass << 26 | 1 << 25 | syndrome;
+        FAR[targetEL].X = fault.address;
+        if (fault.stage2)
+            HPFAR[2].X = (fault.intermediateAddress >> 12) << 4;
+    }
+
+    u64 Core::getProcessState() const {
+        return u64(PSTATE.N) << 31 | u64(PSTATE.Z) << 30 | u64(PSTATE.C) << 29 | u64(PSTATE.V) << 28 |
+               u64(PSTATE.D) << 9 | u64(PSTATE.A) << 8 | u64(PSTATE.I) << 7 | u64(PSTATE.F) << 6 |
+               u64(PSTATE.EL) << 2 | u64(PSTATE.SP);
+    }
+
+    void Core::setProcessState(u64 value) {
+        PSTATE.N = extract<BIT(31)>(value);
+        PSTATE.Z = extract<BIT(30)>(value);
+        PSTATE.C = extract<BIT(29)>(value);
+        PSTATE.V = extract<BIT(28)>(value);
+        PSTATE.D = extract<BIT(9)>(value);
+        PSTATE.A = extract<BIT(8)>(value);
+        PSTATE.I = extract<BIT(7)>(value);
+        PSTATE.F = extract<BIT(6)>(value);
+        PSTATE.EL = extract<BITS(2:3)>(value);
+        PSTATE.SP = extract<BIT(0)>(value);
+    }
+
+    u64 Core::readSystemRegister(u16 encoding) {
+        using enum SystemRegister;
+        using Channel = GenericTimer::Channel;
+
+        const vtime_t now = this->getVirtualTime();
+
+        switch (SystemRegister(encoding)) {
+            case MIDR_EL1:      return MIDR[1].X;
+            case MPIDR_EL1:     return MPIDR[1].X;
+            case SCTLR_EL1:     return SCTLR[1].X;
+            case TTBR0_EL1:     return TTBR0[1].X;
+            case TTBR1_EL1:     return TTBR1[1].X;
+            case TCR_EL1:       return TCR[1].X;
+            case SCTLR_EL2:     return SCTLR[2].X;
+            case HCR_EL2:       return HCR[2].X;
+            case VTTBR_EL2:     return VTTBR[2].X;
+            case VTCR_EL2:      return VTCR[2].X;
+            case SPSR_EL2:      return SPSR[2].X;
+            case ELR_EL2:       return ELR[2].X;
+            case SP_EL1:        return GPR[33].X;
+            case ESR_EL2:       return ESR[2].X;
+            case FAR_EL2:       return FAR[2].X;
+            case HPFAR_EL2:     return HPFAR[2].X;
+            case VBAR_EL2:      return VBAR[2].X;
+            case SPSR_EL1:      return SPSR[1].X;
+            case ELR_EL1:       return ELR[1].X;
+            case SP_EL0:        return GPR[32].X;
+            case CurrentEL:     return u64(PSTATE.EL) << 2;
+            case ESR_EL1:       return ESR[1].X;
+            case FAR_EL1:       return FAR[1].X;
+            case MAIR_EL1:      return MAIR[1].X;
+            case VBAR_EL1:      return VBAR[1].X;
+            case TPIDR_EL1:     return TPIDR[1].X;
+            case TPIDR_EL0:     return TPIDR[0].X;
+            case TPIDRRO_EL0:   return TPIDRRO[0].X;
+            case DCZID_EL0:     return DCZID[0].X;
+            case NZCV:          return u64(PSTATE.N) << 31 | u64(PSTATE.Z) << 30 | u64(PSTATE.C) << 29 | u64(PSTATE.V) << 28;
+            case DAIF:          return u64(PSTATE.D) << 9 | u64(PSTATE.A) << 8 | u64(PSTATE.I) << 7 | u64(PSTATE.F) << 6;
+            case FPCR:          return this->FPCR.X;
+            case FPSR:          this->collectFloatingPointExceptions(); return this->FPSR.X;
+
+            case CNTFRQ_EL0:    return GenericTimerFrequency;
+            case CNTKCTL_EL1:   return this->m_timer.getKernelControl();
+            case CNTPCT_EL0:
+            case CNTVCT_EL0:    return this->m_timer.getCounter(now);
+            case CNTP_TVAL_EL0: return this->m_timer.getTimerValue(Channel::Physical, now);
+            case CNTP_CTL_EL0:  return this->m_timer.getControl(Channel::Physical, now);
+            case CNTP_CVAL_EL0: return this->m_timer.getCompareValue(Channel::Physical);
+            case CNTV_TVAL_EL0: return this->m_timer.getTimerValue(Channel::Virtual, now);
+            case CNTV_CTL_EL0:  return this->m_timer.getControl(Channel::Virtual, now);
+            case CNTV_CVAL_EL0: return this->m_timer.getCompareValue(Channel::Virtual);
+            default:
+                Logger::warn("Read from unimplemented system register %04x at 0x%016llx", encoding, PC.X - InstructionWidth);
+                return 0x00;
+        }
+    }
+
+    void Core::writeSystemRegister(u16 encoding, u64 value) {
+        using enum SystemRegister;
+        using Channel = GenericTimer::Channel;
+
+        const vtime_t now = this->getVirtualTime();
+
+        switch (SystemRegister(encoding)) {
+            case SCTLR_EL1:     SCTLR[1].X = value;     this->updateTranslationRegime(); break;
+            case TTBR0_EL1:     TTBR0[1].X = value;     this->updateTranslationRegime(); break;
+            case TTBR1_EL1:     TTBR1[1].X = value;     this->updateTranslationRegime(); break;
+            case TCR_EL1:       TCR[1].X = value;       this->updateTranslationRegime(); break;
+            case SCTLR_EL2:
+                if (extract<BIT(0)>(value))
+                    Logger::fatal("EL2 stage 1 translation is not supported!");
+                SCTLR[2].X = value;
+                break;
+            case HCR_EL2:       HCR[2].X = value;       this->updateTranslationRegime(); break;
+            case VTTBR_EL2:     VTTBR[2].X = value;     this->updateTranslationRegime(); break;
+            case VTCR_EL2:      VTCR[2].X = value;      this->updateTranslationRegime(); break;
+            case SPSR_EL2:      SPSR[2].X = value;      break;
+            case ELR_EL2:       ELR[2].X = value;       break;
+            case SP_EL1:        GPR[33].X = value;      break;
+            case ESR_EL2:       ESR[2].X = value;       break;
+            case FAR_EL2:       FAR[2].X = value;       break;
+            case HPFAR_EL2:     HPFAR[2].X = value;     break;
+            case VBAR_EL2:      VBAR[2].X = value;      break;
+            case SPSR_EL1:      SPSR[1].X = value;      break;
+            case ELR_EL1:       ELR[1].X = value;       break;
+            case SP_EL0:        GPR[32].X = value;      break;
+            case ESR_EL1:       ESR[1].X = value;       break;
+            case FAR_EL1:       FAR[1].X = value;       break;
+            case MAIR_EL1:      MAIR[1].X = value;      break;
+            case VBAR_EL1:      VBAR[1].X = value;      break;
+            case TPIDR_EL1:     TPIDR[1].X = value;     break;
+            case TPIDR_EL0:     TPIDR[0].X = value;     break;
+            case TPIDRRO_EL0:   TPIDRRO[0].X = value;   break;
+            case FPCR:          this->FPCR.X = value;   break;
+            case FPSR:          this->collectFloatingPointExceptions(); this->FPSR.X = value; break;
+            case NZCV:
+                PSTATE.N = extract<BIT(31)>(value);
+                PSTATE.Z = extract<BIT(30)>(value);
+                PSTATE.C = extract<BIT(29)>(value);
+                PSTATE.V = extract<BIT(28)>(value);
+                break;
+            case DAIF:
+                PSTATE.D = extract<BIT(9)>(value);
+                PSTATE.A = extract<BIT(8)>(value);
+                PSTATE.I = extract<BIT(7)>(value);
+                PSTATE.F = extract<BIT(6)>(value);
+                break;
+
+            case CNTKCTL_EL1:   this->m_timer.setKernelControl(value);                       break;
+            case CNTP_TVAL_EL0: this->m_timer.setTimerValue(Channel::Physical, value, now);  break;
+            case CNTP_CTL_EL0:  this->m_timer.setControl(Channel::Physical, value, now);     break;
+            case CNTP_CVAL_EL0: this->m_timer.setCompareValue(Channel::Physical, value, now); break;
+            case CNTV_TVAL_EL0: this->m_timer.setTimerValue(Channel::Virtual, value, now);   break;
+            case CNTV_CTL_EL0:  this->m_timer.setControl(Channel::Virtual, value, now);      break;
+            case CNTV_CVAL_EL0: this->m_timer.setCompareValue(Channel::Virtual, value, now); break;
+            default:
+                Logger::warn("Write to unimplemented system register %04x at 0x%016llx", encoding, PC.X - InstructionWidth);
+                break;
+        }
+    }
+
     void Core::reset() {
         PC = 0x0000;
+        this->m_waiting = this->m_waitingForEvent = false;
+
+        // Start out in the highest implemented exception level using its own stack pointer with all exceptions masked
+        PSTATE = {};
+        PSTATE.EL = this->m_virtualization ? 2 : 1;
+        PSTATE.SP = 1;
+        PSTATE.D = PSTATE.A = PSTATE.I = PSTATE.F = 1;
+
+        SCTLR[1].X = SCTLR[2].X = 0;
+        HCR[2].X = 0;
+        DCZID[0].X = std::countr_zero(ZeroBlockSize / sizeof(u32));
+        this->updateTranslationRegime();
+
         this->m_halted = false;
         this->m_broken = true;
         this->m_currInstruction = { 0 };
+        this->m_exclusiveValid = false;
+    }
+
+    void Core::enableVirtualization(bool enabled) {
+        this->m_virtualization = enabled;
     }
 
     void Core::halt() {
         this->m_halted = true;
     }
 
+    bool Core::isHalted() const {
+        return this->m_halted;
+    }
+
+    bool Core::isIdle() const {
+        if (this->m_halted)
+            return true;
+        if (!this->m_waiting)
+            return false;
+
+        // WFI wakes up on any pending interrupt, even a masked one. WFE additionally on events
+        return !this->m_interruptPending.load(std::memory_order_acquire) && !(this->m_waitingForEvent && this->m_eventRegister.load(std::memory_order_acquire));
+    }
+
+    vtime_t Core::getVirtualTime() const {
+        return this->m_retiredInstructions + this->m_idleTime;
+    }
+
+    void Core::run(const Scheduler &scheduler) {
+        this->m_deadline = scheduler.getDeadline();
+        while (this->getVirtualTime() < scheduler.getDeadline()) {
+            // Halted and sleeping cores let time pass, cores stopped in the debugger hold it back
+            if (this->isIdle()) {
+                this->m_idleTime += scheduler.getDeadline() - this->getVirtualTime();
+                break;
+            }
+
+            if (this->m_broken && !this->m_breakpoints[TemporarySteppingBreakpointId].has_value())
+                break;
+
+            this->step();
+        }
+
+        this->m_deadline = std::numeric_limits<vtime_t>::max();
+        this->restoreHostFloatingPoint();
+    }
+
+    // Guest FP settings stay active between steps of the same run and only get dropped once control goes back to the caller
     void Core::tick() {
+        this->step();
+        this->restoreHostFloatingPoint();
+    }
+
+    void Core::step() {
         if (this->m_halted || (this->m_broken && !this->m_breakpoints[TemporarySteppingBreakpointId].has_value())) {
             return;
         }
 
-        const inst_t instruction = this->prefetch(PC);
-        const InstructionHandler handler = this->decode(instruction);
+        if (this->m_waiting) {
+            if (this->isIdle())
+                return;
 
-        if (handler == nullptr)
-            return;
+            if (this->m_waitingForEvent)
+                this->m_eventRegister = false;
+            this->m_waiting = this->m_waitingForEvent = false;
+        }
+
+        // Interrupts are only ever looked at between blocks. HCR_EL2.IMO routes them to EL2, where EL0 and EL1 can't mask them
+        if (this->m_interruptPending.load(std::memory_order_acquire)) {
+            const bool routedToEL2 = extract<BIT(4)>(HCR[2].X);
+
+            if (routedToEL2 && (PSTATE.EL < 2 || !PSTATE.I))
+                this->takeException(ExceptionType::IRQ, 2);
+            else if (!routedToEL2 && PSTATE.EL < 2 && !PSTATE.I)
+                this->takeException(ExceptionType::IRQ, 1);
+        }
+
+        try {
+            if (this->m_translationInvalidationsPending.load(std::memory_order_acquire))
+                this->applyTranslationInvalidations();
+
+            if (this->m_engine == ExecutionEngine::BlockCache && !this->m_debugMode) {
+                // Invalidations requested while a block was running are applied once it's done
+                if (this->m_blockInvalidationsPending.load(std::memory_order_acquire))
+                    this->applyBlockInvalidations();
 
-        PC += InstructionWidth;
-        this->execute(handler, instruction);
+                this->executeBlock(this->getTranslationBlock(PC.X));
+                return;
+            }
+
+            const inst_t instruction = this->prefetch(PC);
+            const InstructionHandler handler = this->decode(instruction);
+
+            if (handler == nullptr)
+                return;
+
+            PC += InstructionWidth;
+            this->execute(handler, instruction);
+            this->retire();
+        } catch (const TranslationFault &fault) {
+            this->takeAbort(fault);
+            return;
+        }
 
         if (this->m_debugMode) {
             for (const auto &breakpoint : this->m_breakpoints) {
@@ -119,6 +642,241 @@ namespace arm {
         }
     }
 
+    void Core::retire() {
+        this->m_retiredInstructions++;
+
+        if (this->m_collectStatistics)
+            this->m_instructionStatistics[this->m_currInstructionIndex].executions++;
+
+        if (this->m_profiler != nullptr)
+            this->m_profiler->retire(PC.X);
+    }
+
+    bool Core::isBlockTerminator(InstructionHandler handler) {
+        return handler == &Core::B || handler == &Core::B_COND || handler == &Core::BL || handler == &Core::CBZ || handler == &Core::CBNZ ||
+               handler == &Core::SVC || handler == &Core::HVC || handler == &Core::HLT || handler == &Core::ERET ||
+               handler == &Core::WFI || handler == &Core::WFE ||
+               handler == &Core::MSR_REGISTER || handler == &Core::MSR_IMMEDIATE || // May unmask a pending interrupt or change the translation regime
+               handler == &Core::SYS;
+    }
+
+    const TranslationBlock& Core::getTranslationBlock(addr_t address) {
+        if (auto it = this->m_blockCache->find(address); it != this->m_blockCache->end())
+            return it->second;
+
+        TranslationBlock block;
+        const addr_t physicalPage = this->m_mmu.translate(address, AccessType::Execute, PSTATE.EL != 0) & ~(MinimumPageSize - 1);
+        block.global = this->m_mmu.isGlobal(address);
+
+        // Blocks never cross a page so a single translation covers all of their instructions
+        for (addr_t pc = address; block.instructions.size() < MaxBlockInstructions && (pc == address || pc % MinimumPageSize != 0); pc += InstructionWidth) {
+            const inst_t instruction = this->prefetch(pc);
+            const auto index = findInstructionPattern(instruction);
+
+            // Invalid instructions are left to the interpreter so they halt the core once actually reached
+            if (!index.has_value())
+                break;
+
+            const InstructionHandler handler = getInstructionPatterns()[*index].type;
+            block.instructions.push_back({ handler, instruction, *index });
+
+            if (isBlockTerminator(handler))
+                break;
+        }
+
+        block.memoryLoop = analyzeMemoryLoop(address, block);
+
+        // Analysis above looks for the generic handlers, execution gets the ones specialized for each encoding
+        for (auto &decoded : block.instructions)
+            decoded.handler = specializeHandler(decoded.handler, decoded.instruction);
+
+        if (!block.instructions.empty())
+            block.ir = this->lowerBlock(address, block);
+
+        // Writes to the page from now on get reported back through invalidateCode
+        auto &codeBlocks = this->m_codeBlocks[physicalPage];
+        if (std::ranges::find(codeBlocks, std::pair { this->m_blockContext, address }) == codeBlocks.end())
+            codeBlocks.emplace_back(this->m_blockContext, address);
+        this->m_addressSpace->markCode(physicalPage);
+
+        return this->m_blockCache->emplace(address, std::move(block)).first->second;
+    }
+
+    void Core::executeBlock(const TranslationBlock &block) {
+        // Only happens when the very first instruction doesn't decode, which halts the core just like in the interpreter
+        if (block.instructions.empty()) {
+            this->halt();
+            return;
+        }
+
+        // Copy and fill loops do all but their last iteration in bulk, which then runs normally and leaves the exact end state
+        if (block.memoryLoop.has_value())
+            this->runMemoryLoop(*block.memoryLoop, block.instructions.size());
+
+        // The profiler and statistics want to see every instruction retire on its own, which only the handlers do. Lockstep
+        // doesn't need that, so its accelerated core runs the IR and gets checked against the reference interpreter too
+        if (block.ir.has_value() && this->m_profiler == nullptr && !this->m_collectStatistics) {
+            this->executeIrBlock(block);
+            return;
+        }
+
+        for (const auto &decoded : block.instructions) {
+            this->m_currInstructionIndex = decoded.patternIndex;
+
+            PC += InstructionWidth;
+            this->execute(decoded.handler, decoded.instruction);
+            this->retire();
+
+            if (this->m_halted)
+                break;
+        }
+    }
+
+    void Core::setExecutionEngine(ExecutionEngine engine) {
+        this->m_engine = engine;
+        this->flushBlockCache();
+    }
+
+    ExecutionEngine Core::getExecutionEngine() const {
+        return this->m_engine;
+    }
+
+    void Core::flushBlockCache() {
+        // The maps themselves stay around, m_blockCache points into one of them
+        for (auto &[context, blockCache] : this->m_blockCaches)
+            blockCache.clear();
+
+        {
+            std::scoped_lock lock(this->m_pendingBlockInvalidationsMutex);
+            this->m_pendingBlockInvalidations.clear();
+            this->m_blockInvalidationsPending.store(false, std::memory_order_relaxed);
+        }
+
+        this->m_codeBlocks.clear();
+    }
+
+    void Core::queueTranslationInvalidation(const TranslationInvalidation &invalidation) {
+        std::scoped_lock lock(this->m_pendingTranslationInvalidationsMutex);
+        this->m_pendingTranslationInvalidations.push_back(invalidation);
+        this->m_translationInvalidationsPending.store(true, std::memory_order_release);
+    }
+
+    void Core::applyTranslationInvalidation(const TranslationInvalidation &invalidation) {
+        if (invalidation.address.has_value())
+            this->m_mmu.invalidateAddress(invalidation.vmid, *invalidation.address, invalidation.asid);
+        else if (invalidation.asid.has_value())
+            this->m_mmu.invalidateAsid(invalidation.vmid, *invalidation.asid);
+        else
+            this->m_mmu.invalidateAll();
+    }
+
+    void Core::applyTranslationInvalidations() {
+        std::vector<TranslationInvalidation> invalidations;
+        {
+            std::scoped_lock lock(this->m_pendingTranslationInvalidationsMutex);
+            invalidations.swap(this->m_pendingTranslationInvalidations);
+            this->m_translationInvalidationsPending.store(false, std::memory_order_relaxed);
+        }
+
+        for (const auto &invalidation : invalidations)
+            this->applyTranslationInvalidation(invalidation);
+    }
+
+    void Core::queueBlockInvalidation(const BlockInvalidation &invalidation) {
+        std::scoped_lock lock(this->m_pendingBlockInvalidationsMutex);
+        this->m_pendingBlockInvalidations.push_back(invalidation);
+        this->m_blockInvalidationsPending.store(true, std::memory_order_release);
+    }
+
+    void Core::applyBlockInvalidations() {
+        // Invalidations queued from now on get applied at the next block boundary
+        std::vector<BlockInvalidation> invalidations;
+        {
+            std::scoped_lock lock(this->m_pendingBlockInvalidationsMutex);
+            invalidations.swap(this->m_pendingBlockInvalidations);
+            this->m_blockInvalidationsPending.store(false, std::memory_order_relaxed);
+        }
+
+        for (const auto &invalidation : invalidations) {
+            if (invalidation.physicalPage.has_value()) {
+                if (auto it = this->m_codeBlocks.find(*invalidation.physicalPage); it != this->m_codeBlocks.end()) {
+                    for (const auto &[context, address] : it->second) {
+                        if (auto cache = this->m_blockCaches.find(context); cache != this->m_blockCaches.end())
+                            cache->second.erase(address);
+                    }
+
+                    this->m_codeBlocks.erase(it);
+                }
+
+                continue;
+            }
+
+            if (!invalidation.asid.has_value() && !invalidation.address.has_value()) {
+                for (auto &[context, blockCache] : this->m_blockCaches)
+                    blockCache.clear();
+
+                continue;
+            }
+
+            // TLB invalidations only cover the VMID they were issued under, by address they also hit global blocks cached under any ASID
+            for (auto &[context, blockCache] : this->m_blockCaches) {
+                if (invalidation.vmid.has_value() && (context == UntranslatedContext || u8(context >> 16) != *invalidation.vmid))
+                    continue;
+
+                const bool asidMatches = !invalidation.asid.has_value() || u16(context) == *invalidation.asid;
+                if (!asidMatches && !invalidation.address.has_value())
+                    continue;
+
+                const addr_t page = invalidation.address.value_or(0) & ~(MinimumPageSize - 1);
+                std::erase_if(blockCache, [&](const auto &entry) {
+                    if (!asidMatches && !entry.second.global)
+                        return false;
+
+                    return !invalidation.address.has_value() || (entry.first & ~(MinimumPageSize - 1)) == page;
+                });
+            }
+        }
+    }
+
+    void Core::invalidateTranslations(u16 vmid, std::optional<u16> asid) {
+        this->queueTranslationInvalidation({ .vmid = vmid, .asid = asid });
+    }
+
+    void Core::invalidateTranslation(u16 vmid, addr_t address, std::optional<u16> asid) {
+        this->queueTranslationInvalidation({ .vmid = vmid, .asid = asid, .address = address });
+    }
+
+    void Core::invalidateBlocks(std::optional<addr_t> address) {
+        this->queueBlockInvalidation({ .address = address });
+    }
+
+    // Called for writes from any core, the blocks might be running right now so they're dropped at the next block boundary
+    void Core::invalidateCode(addr_t physicalPage) {
+        this->queueBlockInvalidation({ .physicalPage = physicalPage });
+    }
+
+    void Core::updateTranslationRegime() {
+        this->m_mmu.configure(SCTLR[1].X, TCR[1].X, TTBR0[1].X, TTBR1[1].X, HCR[2].X, VTCR[2].X, VTTBR[2].X, PSTATE.EL == 2);
+        this->updateBlockContext();
+    }
+
+    // Cache hits skip the execute permission check, so EL0 can't share blocks with EL1 which may run code EL0 isn't allowed to
+    void Core::updateBlockContext() {
+        if (this->m_mmu.isEnabled())
+            this->m_blockContext = u32(PSTATE.EL == 0) << 24 | u32(this->m_mmu.getVmid()) << 16 | this->m_mmu.getAsid();
+        else
+            this->m_blockContext = UntranslatedContext;
+
+        this->m_blockCache = &this->m_blockCaches[this->m_blockContext];
+    }
+
+    void Core::attachScheduler(Scheduler *scheduler) {
+        this->m_timer.attachScheduler(scheduler);
+    }
+
+    GenericTimer& Core::getTimer() {
+        return this->m_timer;
+    }
 
     void Core::dumpRegisters() {
         Logger::info("== Register Dump ==");
@@ -129,6 +887,72 @@ namespace arm {
             Logger::info(" W%02u: 0x%016llx", i, GPR[i].W);
     }
 
+    void Core::attachProfiler(Profiler *profiler) {
+        this->m_profiler = profiler;
+    }
+
+    u64 Core::getRetiredInstructionCount() const {
+        return this->m_retiredInstructions;
+    }
+
+    void Core::enableInstructionStatistics(bool enabled) {
+        this->m_collectStatistics = enabled;
+
+        if (enabled)
+            this->m_instructionStatistics.resize(getInstructionPatternLUT().size());
+    }
+
+    void Core::dumpInstructionStatistics(const std::string &path, bool json) const {
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr)
+            Logger::fatal("File " + path + " cannot be written!");
+
+        constexpr auto lut = getInstructionPatternLUT();
+
+        std::vector<u16> order;
+        u64 totalExecutions = 0;
+        for (u16 index = 0; index < this->m_instructionStatistics.size(); index++) {
+            order.push_back(index);
+            totalExecutions += this->m_instructionStatistics[index].executions;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [this](u16 a, u16 b) {
+            return this->m_instructionStatistics[a].executions > this->m_instructionStatistics[b].executions;
+        });
+
+        const auto &translation = this->m_mmu.getStatistics();
+
+        if (json) {
+            fprintf(file, "{\n  \"totalExecutions\": %llu,\n  \"instructions\": [", static_cast<unsigned long long>(totalExecutions));
+            for (u16 i = 0; i < order.size(); i++) {
+                const auto &statistics = this->m_instructionStatistics[order[i]];
+                fprintf(file, "%s\n    { \"name\": \"%s\", \"executions\": %llu, \"memoryBytes\": %llu }", i == 0 ? "" : ",",
+                        lut[order[i]].name, static_cast<unsigned long long>(statistics.executions), static_cast<unsigned long long>(statistics.memoryBytes));
+            }
+            fprintf(file, "\n  ],\n  \"translation\": { \"lookups\": %llu, \"walks\": %llu, \"stage2Walks\": %llu, \"descriptorReads\": %llu }\n}\n",
+                    static_cast<unsigned long long>(translation.lookups), static_cast<unsigned long long>(translation.walks),
+                    static_cast<unsigned long long>(translation.stage2Walks), static_cast<unsigned long long>(translation.descriptorReads));
+        } else {
+            fprintf(file, "%-28s %16s %8s %16s\n", "Instruction", "Executions", "Share", "Memory Bytes");
+            for (const auto &index : order) {
+                const auto &statistics = this->m_instructionStatistics[index];
+                if (statistics.executions == 0)
+                    continue;
+
+                fprintf(file, "%-28s %16llu %7.2f%% %16llu\n", lut[index].name, static_cast<unsigned long long>(statistics.executions),
+                        statistics.executions * 100.0 / totalExecutions, static_cast<unsigned long long>(statistics.memoryBytes));
+            }
+
+            fprintf(file, "\n%-28s %16llu\n%-28s %16llu\n%-28s %16llu\n%-28s %16llu\n",
+                    "TLB Lookups", static_cast<unsigned long long>(translation.lookups),
+                    "Translation Walks", static_cast<unsigned long long>(translation.walks),
+                    "Stage 2 Walks", static_cast<unsigned long long>(translation.stage2Walks),
+                    "Descriptor Reads", static_cast<unsigned long long>(translation.descriptorReads));
+        }
+
+        fclose(file);
+    }
+
     void Core::enterDebugMode() {
         this->m_debugMode = true;
     }
@@ -168,18 +992,72 @@ namespace arm {
         this->m_breakpoints[TemporarySteppingBreakpointId] = PC.X + InstructionWidth;
     }
 
-    void Core::setNZCVFlags(u32 oldValue, u32 newValue) {
-        PSTATE.N = (newValue >> 31) == 1;
-        PSTATE.Z = newValue == 0;
-        PSTATE.C = (oldValue >> 31) == 0 && (newValue >> 31) == 1;
-        PSTATE.V = (oldValue >> 31) == 1 && (newValue >> 31) == 0;
+    u64 Core::addWithCarry(u64 x, u64 y, bool carry, bool sf, bool setFlags) {
+        if (sf == 0) {
+            u64 unsignedSum = u64(u32(x)) + u64(u32(y)) + carry;
+            s64 signedSum = s64(s32(x)) + s64(s32(y)) + carry;
+            u32 result = u32(unsignedSum);
+
+            if (setFlags) {
+                PSTATE.N = result >> 31;
+                PSTATE.Z = result == 0;
+                PSTATE.C = u64(result) != unsignedSum;
+                PSTATE.V = s64(s32(result)) != signedSum;
+            }
+
+            return result;
+        } else {
+            u64 result = x + y + carry;
+
+            if (setFlags) {
+                PSTATE.N = result >> 63;
+                PSTATE.Z = result == 0;
+                PSTATE.C = result < x || (carry && result == x);
+                PSTATE.V = ((~(x ^ y) & (x ^ result)) >> 63) != 0;
+            }
+
+            return result;
+        }
+    }
+
+    void Core::setNZFlags(u64 result, bool sf) {
+        PSTATE.N = sf ? (result >> 63) : ((result >> 31) & 1);
+        PSTATE.Z = (sf ? result : u32(result)) == 0;
+        PSTATE.C = 0;
+        PSTATE.V = 0;
+    }
+
+    u64 Core::shiftRegister(u64 value, u8 shiftType, u8 amount, bool sf) {
+        if (sf == 0) {
+            u32 value32 = value;
+            switch (shiftType) {
+                case 0b00: return u32(value32 << amount);
+                case 0b01: return u32(value32 >> amount);
+                case 0b10: return u32(s32(value32) >> amount);
+                default:   return std::rotr(value32, amount);
+            }
+        } else {
+            switch (shiftType) {
+                case 0b00: return value << amount;
+                case 0b01: return value >> amount;
+                case 0b10: return u64(s64(value) >> amount);
+                default:   return std::rotr(value, amount);
+            }
+        }
     }
 
-    void Core::setNZCVFlags(u64 oldValue, u64 newValue) {
-        PSTATE.N = (newValue >> 63) == 1;
-        PSTATE.Z = newValue == 0;
-        PSTATE.C = (oldValue >> 63) == 0 && (newValue >> 63) == 1;
-        PSTATE.V = (oldValue >> 63) == 1 && (newValue >> 63) == 0;
+    u64 Core::extendRegister(u64 value, u8 option, u8 amount) {
+        switch (option) {
+            case 0b000: value = u8(value);  break; // UXTB
+            case 0b001: value = u16(value); break; // UXTH
+            case 0b010: value = u32(value); break; // UXTW
+            case 0b100: value = s64(s8(value));  break; // SXTB
+            case 0b101: value = s64(s16(value)); break; // SXTH
+            case 0b110: value = s64(s32(value)); break; // SXTW
+            default: break;                             // UXTX / SXTX
+        }
+
+        return value << amount;
     }
 
     bool Core::doesConditionHold(u8 cond) const {
@@ -238,79 +1116,76 @@ namespace arm {
         return mask;
     }
 
-
+    u64 Core::multiplyHigh(u64 operand1, u64 operand2, bool isSigned) {
+        if (isSigned)
+            return u64((__int128(s64(operand1)) * s64(operand2)) >> 64);
+        else
+            return u64((static_cast<unsigned __int128>(operand1) * operand2) >> 64);
+    }
+
+    u64 Core::reverseBits(u64 value) {
+        value = __builtin_bswap64(value);
+        value = ((value >> 4) & 0x0F0F'0F0F'0F0F'0F0FULL) | ((value & 0x0F0F'0F0F'0F0F'0F0FULL) << 4);
+        value = ((value >> 2) & 0x3333'3333'3333'3333ULL) | ((value & 0x3333'3333'3333'3333ULL) << 2);
+        value = ((value >> 1) & 0x5555'5555'5555'5555ULL) | ((value & 0x5555'5555'5555'5555ULL) << 1);
+
+        return value;
+    }
+
+
     INSTRUCTION_DEF(NOP) {
 
     }
 
+    INSTRUCTION_DEF(HLT) {
+        this->halt();
+    }
+
     INSTRUCTION_DEF(ORR_IMMEDIATE) {
+        u64 imm = decodeImmediateWMask(extract<BIT(22)>(inst), extract<BITS(10:15)>(inst), extract<BITS(16:21)>(inst));
+
         if (sf == 0)
-            GPSP(Rd).X = GPZR(Rn).X | imm6;
+            GPSP(Rd).X = u32(GPZR(Rn).W | imm);
         else
-            GPSP(Rd).W = GPZR(Rn).W | imm6;
+            GPSP(Rd).X = GPZR(Rn).X | imm;
     }
 
     INSTRUCTION_DEF(ORR_SHIFTED_REGISTER) {
-        if (sf == 0) {
-            u32 operand2;
-            switch (shift) {
-                case 0b00: operand2 = GPZR(Rm).X << imm6; break;
-                case 0b01: operand2 = GPZR(Rm).X >> imm6; break;
-                case 0b10: operand2 = s32(GPZR(Rm).X) >> imm6; break;
-                case 0b11: operand2 = std::rotr(GPZR(Rm).X, imm6); break;
+        u64 operand2 = Core::shiftRegister(GPZR(Rm).X, shift, imm6, sf);
 
-            }
+        if (sf == 0)
+            GPZR(Rd).X = u32(GPZR(Rn).W | operand2);
+        else
             GPZR(Rd).X = GPZR(Rn).X | operand2;
-        } else {
-            u64 operand2;
-            switch (shift) {
-                case 0b00: operand2 = GPZR(Rm).W << imm6; break;
-                case 0b01: operand2 = GPZR(Rm).W >> imm6; break;
-                case 0b10: operand2 = s64(GPZR(Rm).W) >> imm6; break;
-                case 0b11: operand2 = std::rotr(GPZR(Rm).W, imm6); break;
-
-            }
-            GPZR(Rd).W = GPZR(Rn).W | operand2;
-        }
     }
 
     INSTRUCTION_DEF(MOVNZK) {
-        /*u16 imm16 = extract<BITS(5:20)>(inst);
-        u8 hw = extract<BITS(21:22)>(inst);
-
-        if (sf == 0)
-            GPZR(Rd).X = u32(imm16) << (hw << 4);
-        else
-            GPZR(Rd).W = u64(imm16) << (hw << 4);*/
-
         u16 imm16 = extract<BITS(5:20)>(inst);
         u8 hw = extract<BITS(21:22)>(inst);
         u8 opc = extract<BITS(29:30)>(inst);
 
+        u64 value = u64(imm16) << (hw * 16);
+        u64 mask = 0xFFFFULL << (hw * 16);
+
         switch (opc) {
             case 0b00:  // MOVN
-                if (sf == 0)
-                    GPZR(Rd).W = ~u32(imm16);
-                else
-                    GPZR(Rd).X = ~u64(imm16);
+                value = ~value;
                 break;
             case 0b10: // MOVZ
-                if (sf == 0)
-                    GPZR(Rd).W = u32(imm16) << (hw * 16);
-                else
-                    GPZR(Rd).X = u64(imm16) << (hw * 16);
                 break;
             case 0b11:  // MOVK
-                if (sf == 0)
-                    GPZR(Rd).W |= u32(imm16) << (hw * 16);
-                else
-                    GPZR(Rd).X |= u64(imm16) << (hw * 16);
+                value = (GPZR(Rd).X & ~mask) | value;
                 break;
         }
+
+        if (sf == 0)
+            GPZR(Rd).X = u32(value);
+        else
+            GPZR(Rd).X = value;
     }
 
     INSTRUCTION_DEF(B) {
-        s32 offset = extract<BITS(0:25)>(inst) * InstructionWidth;
+        s64 offset = extendSign(extract<BITS(0:25)>(inst), 26, 64) * InstructionWidth;
 
         PC += offset - InstructionWidth;
     }
@@ -326,120 +1201,54 @@ namespace arm {
     INSTRUCTION_DEF(BL) {
         s32 offset = extendSign(extract<BITS(0:25)>(inst), 26, 32) * InstructionWidth;
 
-        GPR[30] = PC + InstructionWidth;
+        GPR[30].X = PC.X;
+
+        if (this->m_profiler != nullptr)
+            this->m_profiler->call(PC.X - InstructionWidth);
+
         PC += offset - InstructionWidth;
     }
 
     INSTRUCTION_DEF(ADD_IMMEDIATE) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = imm12; break;
-            case 0b01: operand2 = imm12 << 12; break;
-        }
+        u64 operand2 = shift == 0b01 ? u64(imm12) << 12 : imm12;
 
-        if (sf == 0) {
-            u32 result = GPSP(Rn).W + operand2;
-            GPSP(Rd).W = result;
-        } else {
-            u64 result = GPSP(Rn).X + operand2;
-            GPSP(Rd).X = result;
-        }
+        GPSP(Rd).X = Core::addWithCarry(GPSP(Rn).X, operand2, false, sf, false);
     }
 
     INSTRUCTION_DEF(ADD_SHIFTED_REGISTER) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = GPZR(Rm); break;
-            case 0b01: operand2 = GPZR(Rm) << 12; break;
-        }
+        u64 operand2 = Core::shiftRegister(GPZR(Rm).X, shift, imm6, sf);
 
-        if (sf == 0) {
-            GPZR(Rd).W = GPZR(Rn).W + operand2;
-        } else {
-            GPZR(Rd).X = GPZR(Rn).X + operand2;
-        }
+        GPZR(Rd).X = Core::addWithCarry(GPZR(Rn).X, operand2, false, sf, false);
     }
 
     INSTRUCTION_DEF(ADDS_IMMEDIATE) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = imm12; break;
-            case 0b01: operand2 = imm12 << 12; break;
-        }
+        u64 operand2 = shift == 0b01 ? u64(imm12) << 12 : imm12;
 
-        if (sf == 0) {
-            u32 result = GPSP(Rn).W + operand2;
-            Core::setNZCVFlags(GPZR(Rd).W, result);
-            GPZR(Rd).W = result;
-        } else {
-            u64 result = GPSP(Rn).X + operand2;
-            Core::setNZCVFlags(GPZR(Rd).X, result);
-            GPZR(Rd).X = result;
-        }
+        GPZR(Rd).X = Core::addWithCarry(GPSP(Rn).X, operand2, false, sf, true);
     }
 
     INSTRUCTION_DEF(SUB_IMMEDIATE) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = imm12; break;
-            case 0b01: operand2 = imm12 << 12; break;
-        }
+        u64 operand2 = shift == 0b01 ? u64(imm12) << 12 : imm12;
 
-        if (sf == 0) {
-            GPSP(Rd).W = GPSP(Rn).W - operand2;
-        } else {
-            GPSP(Rd).X = GPSP(Rn).X - operand2;
-        }
+        GPSP(Rd).X = Core::addWithCarry(GPSP(Rn).X, ~operand2, true, sf, false);
     }
 
     INSTRUCTION_DEF(SUB_SHIFTED_REGISTER) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = GPZR(Rm); break;
-            case 0b01: operand2 = GPZR(Rm) << 12; break;
-        }
+        u64 operand2 = Core::shiftRegister(GPZR(Rm).X, shift, imm6, sf);
 
-        if (sf == 0) {
-            GPZR(Rd).W = GPZR(Rn).W - operand2;
-        } else {
-            GPZR(Rd).X = GPZR(Rn).X - operand2;
-        }
+        GPZR(Rd).X = Core::addWithCarry(GPZR(Rn).X, ~operand2, true, sf, false);
     }
 
     INSTRUCTION_DEF(SUBS_IMMEDIATE) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = imm12; break;
-            case 0b01: operand2 = imm12 << 12; break;
-        }
+        u64 operand2 = shift == 0b01 ? u64(imm12) << 12 : imm12;
 
-        if (sf == 0) {
-            u32 result = GPSP(Rn).W - operand2;
-            Core::setNZCVFlags(GPZR(Rd).W, result);
-            GPZR(Rd).W = result;
-        } else {
-            u64 result = GPSP(Rn).X - operand2;
-            Core::setNZCVFlags(GPZR(Rd).X, result);
-            GPZR(Rd).X = result;
-        }
+        GPZR(Rd).X = Core::addWithCarry(GPSP(Rn).X, ~operand2, true, sf, true);
     }
 
     INSTRUCTION_DEF(SUBS_SHIFTED_REGISTER) {
-        u32 operand2 = 0;
-        switch (shift) {
-            case 0b00: operand2 = GPZR(Rm); break;
-            case 0b01: operand2 = GPZR(Rm) << 12; break;
-        }
+        u64 operand2 = Core::shiftRegister(GPZR(Rm).X, shift, imm6, sf);
 
-        if (sf == 0) {
-            u32 result = GPZR(Rn).W - operand2;
-            Core::setNZCVFlags(GPZR(Rd).W, result);
-            GPZR(Rd).W = result;
-        } else {
-            u64 result = GPZR(Rn).X - operand2;
-            Core::setNZCVFlags(GPZR(Rd).X, result);
-            GPZR(Rd).X = result;
-        }
+        GPZR(Rd).X = Core::addWithCarry(GPZR(Rn).X, ~operand2, true, sf, true);
     }
 
     INSTRUCTION_DEF(SUBS_EXTENDED_REGISTER) {
@@ -452,13 +1261,7 @@ namespace arm {
         u8 nzcv = extract<BITS(0:3)>(inst);
 
         if (Core::doesConditionHold(cond)) {
-            if (sf == 0) {
-                u32 result = GPZR(Rn).W + imm5;
-                Core::setNZCVFlags(GPZR(Rn).W, result);
-            } else {
-                u64 result = GPZR(Rn).X + imm5;
-                Core::setNZCVFlags(GPZR(Rn).X, result);
-            }
+            (void)Core::addWithCarry(GPZR(Rn).X, imm5, false, sf, true);
         } else {
             PSTATE.N = extract<BIT(3)>(nzcv);
             PSTATE.Z = extract<BIT(2)>(nzcv);
@@ -472,13 +1275,7 @@ namespace arm {
         u8 nzcv = extract<BITS(0:3)>(inst);
 
         if (Core::doesConditionHold(cond)) {
-            if (sf == 0) {
-                u32 result = GPZR(Rn).W + GPZR(Rm).W;
-                Core::setNZCVFlags(GPZR(Rn).W, result);
-            } else {
-                u64 result = GPZR(Rn).X + GPZR(Rm).X;
-                Core::setNZCVFlags(GPZR(Rn).X, result);
-            }
+            (void)Core::addWithCarry(GPZR(Rn).X, GPZR(Rm).X, false, sf, true);
         } else {
             PSTATE.N = extract<BIT(3)>(nzcv);
             PSTATE.Z = extract<BIT(2)>(nzcv);
@@ -492,88 +1289,240 @@ namespace arm {
         Logger::info("Supervisor Called! (SVC %u)", imm16);
     }
 
+    INSTRUCTION_DEF(HVC) {
+        const u16 imm16 = extract<BITS(5:20)>(inst);
+
+        this->takeException(ExceptionType::Synchronous, 2);
+        ESR[2].X = u64(0x16) << 26 | 1 << 25 | imm16;
+    }
+
     INSTRUCTION_DEF(ADRP) {
         s64 imm = extendSign(((extract<BITS(5:23)>(inst) << 2) | extract<BITS(29:30)>(inst)) << 12, 33, 64);
 
-        GPZR(Rd) = (PC & 0xFFF) + imm;
+        GPZR(Rd).X = ((PC.X - InstructionWidth) & ~0xFFFULL) + imm;
     }
 
     INSTRUCTION_DEF(AND_IMMEDIATE) {
-        if (sf == 0) {
-            u32 imm = extendSign(decodeImmediateWMask(0, extract<BITS(10:15)>(inst), extract<BITS(16:21)>(inst)), 12, 32);
-            GPSP(Rd).W = GPZR(Rd).W & imm;
-        } else {
-            u64 imm = decodeImmediateWMask(extract<BIT(22)>(inst), extract<BITS(10:15)>(inst), extract<BITS(16:21)>(inst));
-            GPSP(Rd).X = GPZR(Rd).X & imm;
-        }
+        u64 imm = decodeImmediateWMask(extract<BIT(22)>(inst), extract<BITS(10:15)>(inst), extract<BITS(16:21)>(inst));
+
+        if (sf == 0)
+            GPSP(Rd).X = u32(GPZR(Rn).W & imm);
+        else
+            GPSP(Rd).X = GPZR(Rn).X & imm;
     }
 
     INSTRUCTION_DEF(AND_SHIFTED_REGISTER) {
+        u64 operand2 = Core::shiftRegister(GPZR(Rm).X, shift, imm6, sf);
+
+        if (sf == 0)
+            GPZR(Rd).X = u32(GPZR(Rn).W & operand2);
+        else
+            GPZR(Rd).X = GPZR(Rn).X & operand2;
+    }
+
+    INSTRUCTION_DEF(ANDS_IMMEDIATE) {
+        u64 imm = decodeImmediateWMask(extract<BIT(22)>(inst), extract<BITS(10:15)>(inst), extract<BITS(16:21)>(inst));
+        u64 result = sf ? GPZR(Rn).X & imm : u32(GPZR(Rn).W & imm);
+
+        Core::setNZFlags(result, sf);
+        GPZR(Rd).X = result;
+    }
+
+    INSTRUCTION_DEF(ANDS_SHIFTED_REGISTER) {
+        u64 operand2 = Core::shiftRegister(GPZR(Rm).X, shift, imm6, sf);
+        u64 result = sf ? GPZR(Rn).X & operand2 : u32(GPZR(Rn).W & operand2);
+
+        Core::setNZFlags(result, sf);
+        GPZR(Rd).X = result;
+    }
+
+    INSTRUCTION_DEF(MADD) {
+        u8 Ra = extract<BITS(10:14)>(inst);
+        u64 result = GPZR(Ra).X + GPZR(Rn).X * GPZR(Rm).X;
+
+        GPZR(Rd).X = sf ? result : u32(result);
+    }
+
+    INSTRUCTION_DEF(MSUB) {
+        u8 Ra = extract<BITS(10:14)>(inst);
+        u64 result = GPZR(Ra).X - GPZR(Rn).X * GPZR(Rm).X;
+
+        GPZR(Rd).X = sf ? result : u32(result);
+    }
+
+    INSTRUCTION_DEF(SMADDL) {
+        u8 Ra = extract<BITS(10:14)>(inst);
+
+        GPZR(Rd).X = GPZR(Ra).X + u64(s64(s32(GPZR(Rn).W)) * s32(GPZR(Rm).W));
+    }
+
+    INSTRUCTION_DEF(SMSUBL) {
+        u8 Ra = extract<BITS(10:14)>(inst);
+
+        GPZR(Rd).X = GPZR(Ra).X - u64(s64(s32(GPZR(Rn).W)) * s32(GPZR(Rm).W));
+    }
+
+    INSTRUCTION_DEF(UMADDL) {
+        u8 Ra = extract<BITS(10:14)>(inst);
+
+        GPZR(Rd).X = GPZR(Ra).X + u64(GPZR(Rn).W) * GPZR(Rm).W;
+    }
+
+    INSTRUCTION_DEF(UMSUBL) {
+        u8 Ra = extract<BITS(10:14)>(inst);
+
+        GPZR(Rd).X = GPZR(Ra).X - u64(GPZR(Rn).W) * GPZR(Rm).W;
+    }
+
+    INSTRUCTION_DEF(SMULH) {
+        GPZR(Rd).X = Core::multiplyHigh(GPZR(Rn).X, GPZR(Rm).X, true);
+    }
+
+    INSTRUCTION_DEF(UMULH) {
+        GPZR(Rd).X = Core::multiplyHigh(GPZR(Rn).X, GPZR(Rm).X, false);
+    }
+
+    INSTRUCTION_DEF(SDIV) {
+        // Division by zero yields zero and the most negative value divided by -1 wraps around
         if (sf == 0) {
-            u32 operand2;
-            switch (shift) {
-                case 0b00: operand2 = GPZR(Rm).W << imm6; break;
-                case 0b01: operand2 = GPZR(Rm).W >> imm6; break;
-                case 0b10: operand2 = s32(GPZR(Rm).W) >> imm6; break;
-                case 0b11: operand2 = std::rotr(GPZR(Rm).W, imm6); break;
+            s32 dividend = GPZR(Rn).W, divisor = GPZR(Rm).W;
 
-            }
-            GPZR(Rd).W = GPZR(Rn).W & operand2;
+            if (divisor == 0)
+                GPZR(Rd).X = 0;
+            else if (divisor == -1)
+                GPZR(Rd).X = u32(0U - u32(dividend));
+            else
+                GPZR(Rd).X = u32(dividend / divisor);
         } else {
-            u64 operand2;
-            switch (shift) {
-                case 0b00: operand2 = GPZR(Rm).X << imm6; break;
-                case 0b01: operand2 = GPZR(Rm).X >> imm6; break;
-                case 0b10: operand2 = s64(GPZR(Rm).X) >> imm6; break;
-                case 0b11: operand2 = std::rotr(GPZR(Rm).X, imm6); break;
+            s64 dividend = GPZR(Rn).X, divisor = GPZR(Rm).X;
 
-            }
-            GPZR(Rd).X = GPZR(Rn).X & operand2;
+            if (divisor == 0)
+                GPZR(Rd).X = 0;
+            else if (divisor == -1)
+                GPZR(Rd).X = 0ULL - u64(dividend);
+            else
+                GPZR(Rd).X = u64(dividend / divisor);
         }
     }
 
-    INSTRUCTION_DEF(ANDS_IMMEDIATE) {
+    INSTRUCTION_DEF(UDIV) {
         if (sf == 0) {
-            u32 imm = (extract<BITS(10:15)>(inst) << 6) | extract<BITS(16:21)>(inst);
-            u32 result = GPZR(Rn).W & imm;
-            Core::setNZCVFlags(GPZR(Rd).W, result);
-            GPZR(Rd).W = result;
+            u32 divisor = GPZR(Rm).W;
+            GPZR(Rd).X = divisor == 0 ? 0 : GPZR(Rn).W / divisor;
         } else {
-            u64 imm = (extract<BIT(22)>(inst) << 12) | (extract<BITS(10:15)>(inst) << 6) | extract<BITS(16:21)>(inst);
-            u64 result = GPZR(Rn).X & imm;
-            Core::setNZCVFlags(GPZR(Rd).X, result);
-            GPZR(Rd).X = result;
+            u64 divisor = GPZR(Rm).X;
+            GPZR(Rd).X = divisor == 0 ? 0 : GPZR(Rn).X / divisor;
         }
     }
 
-    INSTRUCTION_DEF(ANDS_SHIFTED_REGISTER) {
-        if (sf == 0) {
-            u32 operand2;
-            switch (shift) {
-                case 0b00: operand2 = GPZR(Rm).W << imm6; break;
-                case 0b01: operand2 = GPZR(Rm).W >> imm6; break;
-                case 0b10: operand2 = s32(GPZR(Rm).W) >> imm6; break;
-                case 0b11: operand2 = std::rotr(GPZR(Rm).W, imm6); break;
+    INSTRUCTION_DEF(RBIT) {
+        u64 result = Core::reverseBits(GPZR(Rn).X);
 
-            }
-            u32 result = GPZR(Rn).W & operand2;
-            Core::setNZCVFlags(GPZR(Rd).W, result);
-            GPZR(Rd).W = result;
-        } else {
-            u64 operand2;
-            switch (shift) {
-                case 0b00: operand2 = GPZR(Rm).X << imm6; break;
-                case 0b01: operand2 = GPZR(Rm).X >> imm6; break;
-                case 0b10: operand2 = s64(GPZR(Rm).X) >> imm6; break;
-                case 0b11: operand2 = std::rotr(GPZR(Rm).X, imm6); break;
+        GPZR(Rd).X = sf ? result : result >> 32;
+    }
 
-            }
-            u64 result = GPZR(Rn).X & operand2;
-            Core::setNZCVFlags(GPZR(Rd).X, result);
-            GPZR(Rd).X = result;
+    INSTRUCTION_DEF(REV16) {
+        u64 value = GPZR(Rn).X;
+        u64 result = ((value >> 8) & 0x00FF'00FF'00FF'00FFULL) | ((value & 0x00FF'00FF'00FF'00FFULL) << 8);
+
+        GPZR(Rd).X = sf ? result : u32(result);
+    }
+
+    INSTRUCTION_DEF(REV) {
+        bool reverseWords = sf && !extract<BIT(10)>(inst);
+
+        if (sf == 0)
+            GPZR(Rd).X = __builtin_bswap32(GPZR(Rn).W);
+        else if (reverseWords) // REV32
+            GPZR(Rd).X = std::rotr(__builtin_bswap64(GPZR(Rn).X), 32);
+        else
+            GPZR(Rd).X = __builtin_bswap64(GPZR(Rn).X);
+    }
+
+    INSTRUCTION_DEF(CLZ) {
+        GPZR(Rd).X = sf ? std::countl_zero(GPZR(Rn).X) : std::countl_zero(GPZR(Rn).W);
+    }
+
+    INSTRUCTION_DEF(CLS) {
+        // Bits equal to the sign bit become zeros, the sign bit itself isn't counted
+        if (sf == 0) {
+            u32 value = GPZR(Rn).W;
+            GPZR(Rd).X = std::countl_zero(u32(value ^ u32(s32(value) >> 1))) - 1;
+        } else {
+            u64 value = GPZR(Rn).X;
+            GPZR(Rd).X = std::countl_zero(u64(value ^ u64(s64(value) >> 1))) - 1;
         }
     }
 
+    INSTRUCTION_DEF(CSEL) {
+        u8 cond = extract<BITS(12:15)>(inst);
+        u64 invert = 0ULL - extract<BIT(30)>(inst);
+        u64 increment = extract<BIT(10)>(inst);
+
+        // CSINC adds one, CSINV inverts and CSNEG does both
+        u64 operand2 = (GPZR(Rm).X ^ invert) + increment;
+        u64 result = doesConditionHold(cond) ? GPZR(Rn).X : operand2;
+
+        GPZR(Rd).X = sf ? result : u32(result);
+    }
+
+    INSTRUCTION_DEF(SBFM) {
+        u8 N = extract<BIT(22)>(inst);
+        u8 immr = extract<BITS(16:21)>(inst);
+        u8 imms = extract<BITS(10:15)>(inst);
+        if (N != sf || (sf == 0 && ((immr | imms) & 0x20)))
+            return this->unimplementedInstruction(inst);
+
+        u8 width = sf ? 64 : 32;
+        u64 widthMask = ~0ULL >> (64 - width);
+        u64 wmask = decodeImmediateWMask(N, imms, immr) & widthMask;
+        u64 tmask = ~0ULL >> (63 - ((imms - immr) & (width - 1)));
+
+        u64 source = GPZR(Rn).X & widthMask;
+        u64 rotated = sf ? std::rotr(source, immr) : std::rotr(u32(source), immr);
+        u64 top = 0ULL - ((source >> imms) & 1);
+
+        GPZR(Rd).X = ((top & ~tmask) | (rotated & wmask & tmask)) & widthMask;
+    }
+
+    INSTRUCTION_DEF(BFM) {
+        u8 N = extract<BIT(22)>(inst);
+        u8 immr = extract<BITS(16:21)>(inst);
+        u8 imms = extract<BITS(10:15)>(inst);
+        if (N != sf || (sf == 0 && ((immr | imms) & 0x20)))
+            return this->unimplementedInstruction(inst);
+
+        u8 width = sf ? 64 : 32;
+        u64 widthMask = ~0ULL >> (64 - width);
+        u64 wmask = decodeImmediateWMask(N, imms, immr) & widthMask;
+        u64 tmask = ~0ULL >> (63 - ((imms - immr) & (width - 1)));
+
+        u64 source = GPZR(Rn).X & widthMask;
+        u64 destination = GPZR(Rd).X & widthMask;
+        u64 rotated = sf ? std::rotr(source, immr) : std::rotr(u32(source), immr);
+        u64 bottom = (destination & ~wmask) | (rotated & wmask);
+
+        GPZR(Rd).X = ((destination & ~tmask) | (bottom & tmask)) & widthMask;
+    }
+
+    INSTRUCTION_DEF(UBFM) {
+        u8 N = extract<BIT(22)>(inst);
+        u8 immr = extract<BITS(16:21)>(inst);
+        u8 imms = extract<BITS(10:15)>(inst);
+        if (N != sf || (sf == 0 && ((immr | imms) & 0x20)))
+            return this->unimplementedInstruction(inst);
+
+        u8 width = sf ? 64 : 32;
+        u64 widthMask = ~0ULL >> (64 - width);
+        u64 wmask = decodeImmediateWMask(N, imms, immr) & widthMask;
+        u64 tmask = ~0ULL >> (63 - ((imms - immr) & (width - 1)));
+
+        u64 source = GPZR(Rn).X & widthMask;
+        u64 rotated = sf ? std::rotr(source, immr) : std::rotr(u32(source), immr);
+
+        GPZR(Rd).X = rotated & wmask & tmask;
+    }
+
     INSTRUCTION_DEF(STR_IMMEDIATE) {
         u8 Rt = Rd;
         u16 imm9 = extract<BITS(12:20)>(inst);
@@ -581,68 +1530,37 @@ namespace arm {
 
         if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b01) { // Post-index
             s64 offset = extendSign(imm9, 9, 64);
-            this->m_addressSpace->write(GPSP(Rn).X, 1U << scale, GPZR(Rt).X);
 
-            if (scale == 0b10)
-                GPSP(Rn).W += offset;
-            else
-                GPSP(Rn).X += offset;
-        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b11) { // Pre-index {
+            this->writeMemory(GPSP(Rn).X, 1U << scale, GPZR(Rt).X);
+            GPSP(Rn).X += offset;
+        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b11) { // Pre-index
             s64 offset = extendSign(imm9, 9, 64);
 
-            if (scale == 0b10)
-                GPSP(Rn).W += offset;
-            else
-                GPSP(Rn).X += offset;
+            this->writeMemory(GPSP(Rn).X + offset, 1U << scale, GPZR(Rt).X);
+            GPSP(Rn).X += offset;
+        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b00) { // Unscaled offset
+            s64 offset = extendSign(imm9, 9, 64);
 
-            this->m_addressSpace->write(GPSP(Rn).X, 1U << scale, GPZR(Rt).X);
+            this->writeMemory(GPSP(Rn).X + offset, 1U << scale, GPZR(Rt).X);
         } else if (extract<BITS(24:25)>(inst) == 0b01) { // Unsigned offset
-            s64 offset = extendSign(extract<BITS(10:21)>(inst), 12, 64) << scale;
+            u64 offset = u64(imm12) << scale;
 
-            if (scale == 0b10)
-                this->m_addressSpace->write(GPSP(Rn).X + offset, 1U << scale, GPZR(Rt).W);
-            else
-                this->m_addressSpace->write(GPSP(Rn).X + offset, 1U << scale, GPZR(Rt).X);
+            this->writeMemory(GPSP(Rn).X + offset, 1U << scale, GPZR(Rt).X);
+        } else {
+            this->unimplementedInstruction(inst);
         }
-
     }
 
-    //TODO: Fix perhaps?
     INSTRUCTION_DEF(STR_REGISTER) {
         u8 Rt = Rd;
         u8 scale = extract<BITS(31:30)>(inst);
         u8 option = extract<BITS(13:15)>(inst);
         u8 S = extract<BIT(12)>(inst);
 
-        switch (option) {
-            case 0b010: { // UXTW
-                u32 offset = GPZR(Rm).W;
-                this->m_addressSpace->write(GPSP(Rn).W + offset, 1U << scale, GPZR(Rt).W);
-            } break;
-            case 0b011: { // LSL
-                u8 shiftAmount = 0;
-                if (S == 0)
-                    shiftAmount = 0;
-                else if (scale == 0b10)
-                    shiftAmount = 2;
-                else if (scale == 0b11)
-                    shiftAmount = 3;
-
-                s32 offset = GPZR(Rm).X << shiftAmount;
-                this->m_addressSpace->write(GPSP(Rn).W + offset, 1U << scale, GPZR(Rt).W);
-
-            } break;
-            case 0b110: { // SXTW
-                s32 offset = GPZR(Rm).X;
-                this->m_addressSpace->write(GPSP(Rn).W + offset, 1U << scale, GPZR(Rt).W);
-            } break;
-            case 0b111: { // SXTX
-                s64 offset = extendSign(GPZR(Rm).W, 32, 64);
-                this->m_addressSpace->write(GPSP(Rn).W + offset, 1U << scale, GPZR(Rt).W);
-            }
-        }
-
+        u64 offset = Core::extendRegister(GPZR(Rm).X, option, S ? scale : 0);
+        this->writeMemory(GPSP(Rn).X + offset, 1U << scale, GPZR(Rt).X);
     }
+
     INSTRUCTION_DEF(LDR_IMMEDIATE) {
         u8 Rt = Rd;
         u16 imm9 = extract<BITS(12:20)>(inst);
@@ -650,71 +1568,361 @@ namespace arm {
 
         if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b01) { // Post-index
             s64 offset = extendSign(imm9, 9, 64);
-            GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).X, 1U << scale);
 
-            if (scale == 0b10)
-                GPSP(Rn).W += offset;
-            else
-                GPSP(Rn).X += offset;
-        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b11) { // Pre-index {
+            u64 value = this->readMemory(GPSP(Rn).X, 1U << scale);
+            GPSP(Rn).X += offset;
+            GPZR(Rt).X = value;
+        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b11) { // Pre-index
             s64 offset = extendSign(imm9, 9, 64);
 
-            if (scale == 0b10)
-                GPSP(Rn).W += offset;
-            else
-                GPSP(Rn).X += offset;
+            u64 value = this->readMemory(GPSP(Rn).X + offset, 1U << scale);
+            GPSP(Rn).X += offset;
+            GPZR(Rt).X = value;
+        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b00) { // Unscaled offset
+            s64 offset = extendSign(imm9, 9, 64);
 
-            GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).X, 1U << scale);
+            GPZR(Rt).X = this->readMemory(GPSP(Rn).X + offset, 1U << scale);
         } else if (extract<BITS(24:25)>(inst) == 0b01) { // Unsigned offset
-            s64 offset = extendSign(extract<BITS(10:21)>(inst), 12, 64) << scale;
+            u64 offset = u64(imm12) << scale;
 
-            GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).X + offset, 1U << scale);
+            GPZR(Rt).X = this->readMemory(GPSP(Rn).X + offset, 1U << scale);
+        } else {
+            this->unimplementedInstruction(inst);
         }
     }
 
-    //TODO: Fix perhaps?
     INSTRUCTION_DEF(LDR_REGISTER) {
         u8 Rt = Rd;
         u8 scale = extract<BITS(31:30)>(inst);
         u8 option = extract<BITS(13:15)>(inst);
         u8 S = extract<BIT(12)>(inst);
 
-        switch (option) {
-            case 0b010: { // UXTW
-                u32 offset = GPZR(Rm).X;
-                GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).W + offset, 1U << scale);
-            } break;
-            case 0b011: { // LSL
-                u8 shiftAmount = 0;
-                if (S == 0)
-                    shiftAmount = 0;
-                else if (scale == 0b10)
-                    shiftAmount = 2;
-                else if (scale == 0b11)
-                    shiftAmount = 3;
-
-                s32 offset = GPZR(Rm).X << shiftAmount;
-                GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).W + offset, 1U << scale);
-
-            } break;
-            case 0b110: { // SXTW
-                s32 offset = GPZR(Rm).X;
-                GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).W + offset, 1U << scale);
-            } break;
-            case 0b111: { // SXTX
-                s64 offset = extendSign(GPZR(Rm).W, 32, 64);
-                GPZR(Rt) = this->m_addressSpace->read(GPSP(Rn).W + offset, 1U << scale);
-            }
+        u64 offset = Core::extendRegister(GPZR(Rm).X, option, S ? scale : 0);
+        GPZR(Rt).X = this->readMemory(GPSP(Rn).X + offset, 1U << scale);
+    }
+
+    INSTRUCTION_DEF(LDRS_IMMEDIATE) {
+        u8 Rt = Rd;
+        u16 imm9 = extract<BITS(12:20)>(inst);
+        u8 scale = extract<BITS(31:30)>(inst);
+        bool toWord = extract<BIT(22)>(inst);
+        u8 targetWidth = toWord ? 32 : 64;
+
+        if (scale == 0b11) // PRFM, PRFUM
+            return;
+        if (scale == 0b10 && toWord)
+            return this->unimplementedInstruction(inst);
+
+        if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b01) { // Post-index
+            s64 offset = extendSign(imm9, 9, 64);
+
+            u64 value = this->readMemory(GPSP(Rn).X, 1U << scale);
+            GPSP(Rn).X += offset;
+            GPZR(Rt).X = extendSign(value, 8 << scale, targetWidth);
+        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b11) { // Pre-index
+            s64 offset = extendSign(imm9, 9, 64);
+
+            u64 value = this->readMemory(GPSP(Rn).X + offset, 1U << scale);
+            GPSP(Rn).X += offset;
+            GPZR(Rt).X = extendSign(value, 8 << scale, targetWidth);
+        } else if (extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b00) { // Unscaled offset
+            s64 offset = extendSign(imm9, 9, 64);
+
+            GPZR(Rt).X = extendSign(this->readMemory(GPSP(Rn).X + offset, 1U << scale), 8 << scale, targetWidth);
+        } else if (extract<BITS(24:25)>(inst) == 0b01) { // Unsigned offset
+            u64 offset = u64(imm12) << scale;
+
+            GPZR(Rt).X = extendSign(this->readMemory(GPSP(Rn).X + offset, 1U << scale), 8 << scale, targetWidth);
+        } else {
+            this->unimplementedInstruction(inst);
+        }
+    }
+
+    INSTRUCTION_DEF(LDRS_REGISTER) {
+        u8 Rt = Rd;
+        u8 scale = extract<BITS(31:30)>(inst);
+        u8 option = extract<BITS(13:15)>(inst);
+        u8 S = extract<BIT(12)>(inst);
+        bool toWord = extract<BIT(22)>(inst);
+
+        if (scale == 0b11) // PRFM
+            return;
+        if (scale == 0b10 && toWord)
+            return this->unimplementedInstruction(inst);
+
+        u64 offset = Core::extendRegister(GPZR(Rm).X, option, S ? scale : 0);
+        GPZR(Rt).X = extendSign(this->readMemory(GPSP(Rn).X + offset, 1U << scale), 8 << scale, toWord ? 32 : 64);
+    }
+
+    INSTRUCTION_DEF(LDR_LITERAL) {
+        u8 Rt = Rd;
+        u8 opc = extract<BITS(30:31)>(inst);
+        s64 offset = extendSign(extract<BITS(5:23)>(inst), 19, 64) * InstructionWidth;
+        addr_t address = PC.X - InstructionWidth + offset;
+
+        if (extract<BIT(26)>(inst)) { // SIMD&FP registers
+            if (opc == 0b11)
+                return this->unimplementedInstruction(inst);
+
+            V[Rt] = this->readMemoryVector(address, 2 + opc);
+            return;
+        }
+
+        switch (opc) {
+            case 0b00: GPZR(Rt).X = this->readMemory(address, sizeof(u32)); break;
+            case 0b01: GPZR(Rt).X = this->readMemory(address, sizeof(u64)); break;
+            case 0b10: GPZR(Rt).X = extendSign(this->readMemory(address, sizeof(u32)), 32, 64); break; // LDRSW
+            default: break; // PRFM
+        }
+    }
+
+    INSTRUCTION_DEF(STP) {
+        u8 Rt = Rd;
+        u8 Rt2 = extract<BITS(10:14)>(inst);
+        u8 opc = extract<BITS(30:31)>(inst);
+        u8 mode = extract<BITS(23:24)>(inst);
+
+        if (opc & 0b01) // STGP
+            return this->unimplementedInstruction(inst);
+
+        u8 scale = 2 + (opc >> 1);
+        s64 offset = extendSign(extract<BITS(15:21)>(inst), 7, 64) << scale;
+
+        // No-allocate and signed offset are handled the same, post-index applies the offset afterwards
+        addr_t address = GPSP(Rn).X;
+        if (mode != 0b01)
+            address += offset;
+
+        // Both registers are written with a single access
+        u64 first = GPZR(Rt).X, second = GPZR(Rt2).X;
+        std::array<u8, 2 * sizeof(u64)> buffer;
+        std::memcpy(buffer.data(), &first, 1U << scale);
+        std::memcpy(buffer.data() + (1U << scale), &second, 1U << scale);
+        this->writeMemoryBlock(address, 2U << scale, buffer.data());
+
+        if (mode == 0b01)
+            GPSP(Rn).X = address + offset;
+        else if (mode == 0b11)
+            GPSP(Rn).X = address;
+    }
+
+    INSTRUCTION_DEF(LDP) {
+        u8 Rt = Rd;
+        u8 Rt2 = extract<BITS(10:14)>(inst);
+        u8 opc = extract<BITS(30:31)>(inst);
+        u8 mode = extract<BITS(23:24)>(inst);
+
+        if (opc == 0b11)
+            return this->unimplementedInstruction(inst);
+
+        u8 scale = opc == 0b10 ? 3 : 2;
+        s64 offset = extendSign(extract<BITS(15:21)>(inst), 7, 64) << scale;
+
+        addr_t address = GPSP(Rn).X;
+        if (mode != 0b01)
+            address += offset;
+
+        std::array<u8, 2 * sizeof(u64)> buffer;
+        this->readMemoryBlock(address, 2U << scale, buffer.data());
+
+        u64 first = 0, second = 0;
+        std::memcpy(&first, buffer.data(), 1U << scale);
+        std::memcpy(&second, buffer.data() + (1U << scale), 1U << scale);
+
+        if (opc == 0b01) { // LDPSW
+            first = extendSign(first, 32, 64);
+            second = extendSign(second, 32, 64);
         }
+
+        if (mode == 0b01)
+            GPSP(Rn).X = address + offset;
+        else if (mode == 0b11)
+            GPSP(Rn).X = address;
+
+        GPZR(Rt).X = first;
+        GPZR(Rt2).X = second;
     }
 
     INSTRUCTION_DEF(CBZ) {
         u8 Rt = extract<BITS(0:4)>(inst);
-        u32 imm19 = extract<BITS(5:23)>(inst);
-        u64 offset = extendSign(imm19 << 2, 21, 64) - InstructionWidth;
+        s64 offset = extendSign(extract<BITS(5:23)>(inst), 19, 64) * InstructionWidth;
+        u64 value = sf ? GPZR(Rt).X : GPZR(Rt).W;
+
+        if (value == 0)
+            PC += offset - InstructionWidth;
+    }
+
+    INSTRUCTION_DEF(CBNZ) {
+        u8 Rt = extract<BITS(0:4)>(inst);
+        s64 offset = extendSign(extract<BITS(5:23)>(inst), 19, 64) * InstructionWidth;
+        u64 value = sf ? GPZR(Rt).X : GPZR(Rt).W;
+
+        if (value != 0)
+            PC += offset - InstructionWidth;
+    }
+
+    INSTRUCTION_DEF(MRS) {
+        u8 Rt = extract<BITS(0:4)>(inst);
+
+        GPZR(Rt).X = this->readSystemRegister(extract<BITS(5:20)>(inst));
+    }
+
+    INSTRUCTION_DEF(MSR_REGISTER) {
+        u8 Rt = extract<BITS(0:4)>(inst);
+
+        this->writeSystemRegister(extract<BITS(5:20)>(inst), GPZR(Rt).X);
+    }
+
+    INSTRUCTION_DEF(MSR_IMMEDIATE) {
+        const u8 op1 = extract<BITS(16:18)>(inst);
+        const u8 CRm = extract<BITS(8:11)>(inst);
+        const u8 op2 = extract<BITS(5:7)>(inst);
+
+        if (op1 == 0b011 && op2 == 0b110) {         // DAIFSet
+            PSTATE.D |= extract<BIT(3)>(CRm);
+            PSTATE.A |= extract<BIT(2)>(CRm);
+            PSTATE.I |= extract<BIT(1)>(CRm);
+            PSTATE.F |= extract<BIT(0)>(CRm);
+        } else if (op1 == 0b011 && op2 == 0b111) {  // DAIFClr
+            PSTATE.D &= !extract<BIT(3)>(CRm);
+            PSTATE.A &= !extract<BIT(2)>(CRm);
+            PSTATE.I &= !extract<BIT(1)>(CRm);
+            PSTATE.F &= !extract<BIT(0)>(CRm);
+        } else if (op1 == 0b000 && op2 == 0b101) {  // SPSel
+            PSTATE.SP = extract<BIT(0)>(CRm);
+        } else {
+            Logger::warn("Unimplemented MSR (immediate) op1 %u op2 %u at 0x%016llx", op1, op2, PC.X - InstructionWidth);
+        }
+    }
+
+    INSTRUCTION_DEF(ERET) {
+        const u8 el = PSTATE.EL;
+
+        PC = ELR[el].X;
+        this->setProcessState(SPSR[el].X);
+        this->m_exclusiveValid = false;
+
+        if ((el == 2) != (PSTATE.EL == 2))
+            this->updateTranslationRegime();
+        else if (el != PSTATE.EL)
+            this->updateBlockContext();
+    }
+
+    INSTRUCTION_DEF(WFI) {
+        this->m_waiting = true;
+    }
+
+    INSTRUCTION_DEF(WFE) {
+        // A set event register is consumed without going to sleep
+        if (this->m_eventRegister.exchange(false, std::memory_order_acq_rel))
+            return;
+
+        this->m_waiting = true;
+        this->m_waitingForEvent = true;
+    }
+
+    INSTRUCTION_DEF(SEV) {
+        this->broadcast([](Core &core) { core.signalEvent(); });
+    }
+
+    INSTRUCTION_DEF(SEVL) {
+        this->signalEvent();
+    }
+
+    INSTRUCTION_DEF(CLREX) {
+        this->m_exclusiveValid = false;
+    }
+
+    // Cores on other host threads only see guest stores in order if the host orders them as well
+    INSTRUCTION_DEF(DMB) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    INSTRUCTION_DEF(DSB) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    INSTRUCTION_DEF(ISB) {
+
+    }
+
+    INSTRUCTION_DEF(SYS) {
+        const u8 op1 = extract<BITS(16:18)>(inst);
+        const u8 CRn = extract<BITS(12:15)>(inst);
+        const u8 CRm = extract<BITS(8:11)>(inst);
+        const u8 op2 = extract<BITS(5:7)>(inst);
+        const u8 Rt = extract<BITS(0:4)>(inst);
+
+        // Instruction cache maintenance drops translated blocks, IVAU those of one page in every context. IALLUIS and IVAU apply to every core
+        if (CRn == 0b0111 && op1 == 0b000 && op2 == 0b000 && (CRm == 0b0101 || CRm == 0b0001)) {
+            if (CRm == 0b0001)
+                this->broadcast([](Core &core) { core.invalidateBlocks(); });
+            else
+                this->invalidateBlocks();
+
+            return;
+        } else if (CRn == 0b0111 && op1 == 0b011 && CRm == 0b0101 && op2 == 0b001) {
+            const addr_t address = GPZR(Rt).X;
+            this->broadcast([address](Core &core) { core.invalidateBlocks(address); });
+
+            return;
+        }
+
+        // Data caches aren't modelled, only TLB maintenance has any effect
+        if (CRn != 0b1000 || (op1 != 0b000 && op1 != 0b100))
+            return;
+
+        // The inner shareable variants (CRm 3) apply to every core
+        const bool shareable = CRm == 0b0011;
+        if (!shareable && CRm != 0b0111)
+            return;
+
+        // VA[55:12] is held in bits 43:0, the upper half of the address space is sign extended from bit 55. The ASID lives in bits 63:48
+        const addr_t address = extendSign((GPZR(Rt).X & 0x0FFF'FFFF'FFFF) << 12, 56, 64);
+        const u16 asid = GPZR(Rt).X >> 48;
+
+        // Broadcasts carry the issuer's VMID along, the other cores may be running a different guest right now
+        TranslationInvalidation invalidation = { .vmid = this->m_mmu.getVmid() };
+        if (op1 == 0b100) {
+            // Entries hold combined stage 1 and 2 results, so IPAS2E1 has nothing to drop on its own and relies on the VMALLE1 that has to follow it
+            if (op2 != 0b100 && op2 != 0b110) // ALLE1, VMALLS12E1
+                return;
+        } else {
+            switch (op2) {
+                case 0b000: // VMALLE1
+                    break;
+                case 0b010: // ASIDE1
+                    invalidation.asid = asid;
+                    break;
+                case 0b001: // VAE1
+                case 0b101: // VALE1
+                    invalidation.asid = asid;
+                    invalidation.address = address;
+                    break;
+                case 0b011: // VAAE1
+                case 0b111: // VAALE1
+                    invalidation.address = address;
+                    break;
+                default:
+                    return;
+            }
+        }
+
+        // The issuing core's own TLB has to be up to date for its very next access, the others catch up at their next block boundary
+        this->applyTranslationInvalidation(invalidation);
+        if (shareable) {
+            this->broadcast([this, invalidation](Core &core) {
+                if (&core != this)
+                    core.queueTranslationInvalidation(invalidation);
+            });
+        }
+    }
+
+    INSTRUCTION_DEF(DC_ZVA) {
+        const u8 Rt = Rd;
+        constexpr std::array<u8, ZeroBlockSize> Zeroes = { };
 
-        if (GPZR(Rt) == 0)
-            PC += offset;
+        this->writeMemoryBlock(GPZR(Rt).X & ~u64(ZeroBlockSize - 1), ZeroBlockSize, Zeroes.data());
     }
 
 }
\ No newline at end of file
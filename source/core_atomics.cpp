@@ -0,0 +1,356 @@
+#include "core.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+// Exclusive pairs of X registers use a 16 byte compare and swap where the host has one, cmpxchg16b has to be checked for at runtime on x86
+#if defined(__SIZEOF_INT128__) && (defined(__x86_64__) || defined(__aarch64__))
+    #define HOST_PAIR_CAS
+
+    #if defined(__x86_64__)
+        #include <cpuid.h>
+        #define HOST_TARGET(features) __attribute__((target(features)))
+    #else
+        #define HOST_TARGET(features)
+    #endif
+#endif
+
+namespace arm {
+
+    namespace {
+
+        template<typename F>
+        u64 forAccessSize(u8 scale, F &&function) {
+            switch (scale) {
+                case 0:  return function(u8());
+                case 1:  return function(u16());
+                case 2:  return function(u32());
+                default: return function(u64());
+            }
+        }
+
+        constexpr std::memory_order getMemoryOrder(bool acquire, bool release) {
+            if (acquire && release)
+                return std::memory_order_acq_rel;
+            else if (acquire)
+                return std::memory_order_acquire;
+            else if (release)
+                return std::memory_order_release;
+            else
+                return std::memory_order_relaxed;
+        }
+
+        template<typename T>
+        std::atomic_ref<T> atomicAt(u8 *host) {
+            return std::atomic_ref<T>(*reinterpret_cast<T*>(host));
+        }
+
+#if defined(HOST_PAIR_CAS)
+        bool detectPairCompareAndSwap() {
+    #if defined(__x86_64__)
+            u32 leaf1[4] = { 0 };
+            __get_cpuid_count(1, 0, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+
+            return leaf1[2] & (1 << 13);
+    #else
+            return true;
+    #endif
+        }
+
+        // Queried once while the emulator starts up
+        const bool hostHasPairCompareAndSwap = detectPairCompareAndSwap();
+
+        // __atomic on 16 bytes ends up in libatomic, the __sync builtin is inlined into cmpxchg16b or an exclusive pair loop
+        HOST_TARGET("cx16")
+        std::array<u64, 2> compareAndSwapPair(u8 *host, const std::array<u64, 2> &expected, const std::array<u64, 2> &desired) {
+            unsigned __int128 expectedValue, desiredValue;
+            std::memcpy(&expectedValue, expected.data(), sizeof(expectedValue));
+            std::memcpy(&desiredValue, desired.data(), sizeof(desiredValue));
+
+            const unsigned __int128 previous = __sync_val_compare_and_swap(reinterpret_cast<unsigned __int128*>(host), expectedValue, desiredValue);
+
+            std::array<u64, 2> result;
+            std::memcpy(result.data(), &previous, sizeof(previous));
+            return result;
+        }
+#else
+        constexpr bool hostHasPairCompareAndSwap = false;
+
+        std::array<u64, 2> compareAndSwapPair(u8 *, const std::array<u64, 2> &, const std::array<u64, 2> &) {
+            return { };
+        }
+#endif
+
+        // Without a 16 byte compare and swap on the host, exclusive pairs of X registers are serialized on a few striped locks instead
+        std::array<std::mutex, 16> s_pairLocks;
+
+        std::mutex& getPairLock(addr_t address) {
+            return s_pairLocks[(address >> 4) % s_pairLocks.size()];
+        }
+
+    }
+
+    // Naturally aligned accesses to RAM are done directly on the backing memory with host atomics, everything else gets a plain read-modify-write
+    u8* Core::getAtomicHostPointer(addr_t address, size_t size, AccessType access) {
+        if ((address & (size - 1)) != 0)
+            return nullptr;
+
+        this->m_atomicPhysicalAddress = this->m_mmu.translate(address, access, PSTATE.EL != 0);
+        u8 *host = this->m_addressSpace->getHostPointer(this->m_atomicPhysicalAddress, size, access != AccessType::Read);
+        if (host != nullptr && this->m_collectStatistics)
+            this->m_instructionStatistics[this->m_currInstructionIndex].memoryBytes += size;
+
+        return host;
+    }
+
+    // Follows every store made through the last getAtomicHostPointer() pointer
+    void Core::commitAtomicWrite(addr_t address, size_t size, u64 value) {
+        this->m_addressSpace->commitWrite(this->m_atomicPhysicalAddress, size);
+
+        if (this->m_memoryWriteLog != nullptr)
+            this->m_memoryWriteLog->push_back({ address, size, value });
+    }
+
+    /*
+     * The exclusive monitor remembers the value LDXR returned. STXR succeeds if memory still holds it, which is a single
+     * compare and swap on the host. Uncontended exclusives therefore never synchronize with other cores beyond the
+     * cache line itself, at the cost of not noticing a store that writes back the same value.
+     */
+    INSTRUCTION_DEF(LOAD_STORE_EXCLUSIVE) {
+        const u8 Rt = Rd;
+        const u8 Rs = Rm;
+        const u8 Rt2 = extract<BITS(10:14)>(inst);
+        const bool load = extract<BIT(22)>(inst);
+        const bool pair = extract<BIT(21)>(inst);
+        const bool ordered = extract<BIT(15)>(inst);
+
+        if (pair && !extract<BIT(31)>(inst)) // CASP
+            return this->unimplementedInstruction(inst);
+
+        const u8 scale = pair ? 2 + extract<BIT(30)>(inst) : extract<BITS(30:31)>(inst);
+        const u8 accessScale = pair ? scale + 1 : scale;
+        const size_t accessSize = 1 << accessScale;
+        const addr_t address = GPSP(Rn).X;
+
+        if (load) {
+            std::array<u64, 2> value = { };
+            u8 *pairHost = nullptr;
+            if (accessScale == 4 && hostHasPairCompareAndSwap)
+                pairHost = this->getAtomicHostPointer(address, accessSize, AccessType::Read);
+
+            if (pairHost != nullptr) {
+                // Swapping zero for zero is the only single-copy atomic 16 byte load there is, it never changes memory
+                value = compareAndSwapPair(pairHost, { }, { });
+            } else if (accessScale == 4) {
+                std::scoped_lock lock(getPairLock(address));
+                this->readMemoryBlock(address, accessSize, value.data());
+            } else if (u8 *host = this->getAtomicHostPointer(address, accessSize, AccessType::Read); host != nullptr) {
+                value[0] = forAccessSize(accessScale, [&](auto type) -> u64 {
+                    return atomicAt<decltype(type)>(host).load(ordered ? std::memory_order_acquire : std::memory_order_relaxed);
+                });
+            } else {
+                value[0] = this->readMemory(address, accessSize);
+            }
+
+            this->m_exclusiveAddress = address;
+            this->m_exclusiveScale = accessScale;
+            this->m_exclusiveValue = value;
+            this->m_exclusiveValid = true;
+
+            if (!pair) {
+                GPZR(Rt).X = value[0];
+            } else if (scale == 3) {
+                GPZR(Rt).X = value[0];
+                GPZR(Rt2).X = value[1];
+            } else {
+                GPZR(Rt).X = u32(value[0]);
+                GPZR(Rt2).X = value[0] >> 32;
+            }
+        } else {
+            std::array<u64, 2> value = { };
+            if (!pair)
+                value[0] = GPZR(Rt).X;
+            else if (scale == 3)
+                value = { GPZR(Rt).X, GPZR(Rt2).X };
+            else
+                value[0] = u64(GPZR(Rt).W) | u64(GPZR(Rt2).W) << 32;
+
+            bool success = false;
+            if (this->m_exclusiveValid && this->m_exclusiveAddress == address && this->m_exclusiveScale == accessScale) {
+                u8 *pairHost = nullptr;
+                if (accessScale == 4 && hostHasPairCompareAndSwap)
+                    pairHost = this->getAtomicHostPointer(address, accessSize, AccessType::Write);
+
+                if (pairHost != nullptr) {
+                    success = compareAndSwapPair(pairHost, this->m_exclusiveValue, value) == this->m_exclusiveValue;
+
+                    // Logged in the same 8 byte halves writeMemoryBlock() uses
+                    for (size_t half = 0; success && half < value.size(); half++, this->m_atomicPhysicalAddress += sizeof(u64))
+                        this->commitAtomicWrite(address + half * sizeof(u64), sizeof(u64), value[half]);
+                } else if (accessScale == 4) {
+                    std::scoped_lock lock(getPairLock(address));
+
+                    std::array<u64, 2> current;
+                    this->readMemoryBlock(address, accessSize, current.data());
+                    if (current == this->m_exclusiveValue) {
+                        this->writeMemoryBlock(address, accessSize, value.data());
+                        success = true;
+                    }
+                } else if (u8 *host = this->getAtomicHostPointer(address, accessSize, AccessType::Write); host != nullptr) {
+                    success = forAccessSize(accessScale, [&](auto type) -> u64 {
+                        using T = decltype(type);
+
+                        T expected = T(this->m_exclusiveValue[0]);
+                        return atomicAt<T>(host).compare_exchange_strong(expected, T(value[0]), ordered ? std::memory_order_seq_cst : std::memory_order_relaxed);
+                    });
+
+                    if (success)
+                        this->commitAtomicWrite(address, accessSize, value[0]);
+                } else if (this->readMemory(address, accessSize) == this->m_exclusiveValue[0]) {
+                    this->writeMemory(address, accessSize, value[0]);
+                    success = true;
+                }
+            }
+
+            this->m_exclusiveValid = false;
+            GPZR(Rs).X = success ? 0 : 1;
+        }
+    }
+
+    INSTRUCTION_DEF(LOAD_ACQUIRE_STORE_RELEASE) {
+        const u8 Rt = Rd;
+        const u8 scale = extract<BITS(30:31)>(inst);
+        const bool load = extract<BIT(22)>(inst);
+        const size_t accessSize = 1 << scale;
+        const addr_t address = GPSP(Rn).X;
+
+        if (load) {
+            if (u8 *host = this->getAtomicHostPointer(address, accessSize, AccessType::Read); host != nullptr) {
+                GPZR(Rt).X = forAccessSize(scale, [&](auto type) -> u64 {
+                    return atomicAt<decltype(type)>(host).load(std::memory_order_acquire);
+                });
+            } else {
+                GPZR(Rt).X = this->readMemory(address, accessSize);
+            }
+        } else {
+            const u64 value = GPZR(Rt).X;
+
+            if (u8 *host = this->getAtomicHostPointer(address, accessSize, AccessType::Write); host != nullptr) {
+                forAccessSize(scale, [&](auto type) -> u64 {
+                    atomicAt<decltype(type)>(host).store(decltype(type)(value), std::memory_order_release);
+                    return 0;
+                });
+
+                this->commitAtomicWrite(address, accessSize, value & (~0ULL >> (64 - 8 * accessSize)));
+            } else {
+                this->writeMemory(address, accessSize, value);
+            }
+        }
+    }
+
+    INSTRUCTION_DEF(CAS) {
+        const u8 Rt = Rd;
+        const u8 Rs = Rm;
+        const u8 scale = extract<BITS(30:31)>(inst);
+        const bool acquire = extract<BIT(22)>(inst);
+        const bool release = extract<BIT(15)>(inst);
+        const size_t accessSize = 1 << scale;
+        const addr_t address = GPSP(Rn).X;
+        const u64 compare = GPZR(Rs).X;
+        const u64 value = GPZR(Rt).X;
+
+        GPZR(Rs).X = forAccessSize(scale, [&](auto type) -> u64 {
+            using T = decltype(type);
+
+            if (u8 *host = this->getAtomicHostPointer(address, accessSize, AccessType::Write); host != nullptr) {
+                // On failure the current memory value gets written back to expected, on success it already holds it
+                T expected = T(compare);
+                if (atomicAt<T>(host).compare_exchange_strong(expected, T(value), getMemoryOrder(acquire, release)))
+                    this->commitAtomicWrite(address, accessSize, T(value));
+
+                return expected;
+            }
+
+            const T current = this->readMemory(address, accessSize);
+            if (current == T(compare))
+                this->writeMemory(address, accessSize, value);
+
+            return current;
+        });
+    }
+
+    INSTRUCTION_DEF(ATOMIC_MEMORY) {
+        const u8 Rt = Rd;
+        const u8 Rs = Rm;
+        const u8 scale = extract<BITS(30:31)>(inst);
+        const bool acquire = extract<BIT(23)>(inst);
+        const bool release = extract<BIT(22)>(inst);
+        const bool o3 = extract<BIT(15)>(inst);
+        const u8 opc = extract<BITS(12:14)>(inst);
+        const size_t accessSize = 1 << scale;
+        const addr_t address = GPSP(Rn).X;
+        const std::memory_order order = getMemoryOrder(acquire, release);
+
+        if (o3 && opc == 0b100 && Rs == 31) // LDAPR
+            return this->LOAD_ACQUIRE_STORE_RELEASE(inst | 1 << 22, Rd, Rn, Rm, sf, imm3, imm6, imm12, shift, size);
+        else if (o3 && opc != 0b000)
+            return this->unimplementedInstruction(inst);
+
+        const u64 operand = GPZR(Rs).X;
+
+        // Returns the old memory value, LDADD and friends with Rt = ZR are the STADD aliases
+        GPZR(Rt).X = forAccessSize(scale, [&](auto type) -> u64 {
+            using T = decltype(type);
+            using S = std::make_signed_t<T>;
+
+            const T value = T(operand);
+            const auto operation = [&](T current) -> T {
+                if (o3)
+                    return value;                                               // SWP
+
+                switch (opc) {
+                    case 0b000: return current + value;                         // LDADD
+                    case 0b001: return current & ~value;                        // LDCLR
+                    case 0b010: return current ^ value;                         // LDEOR
+                    case 0b011: return current | value;                         // LDSET
+                    case 0b100: return T(std::max(S(current), S(value)));       // LDSMAX
+                    case 0b101: return T(std::min(S(current), S(value)));       // LDSMIN
+                    case 0b110: return std::max(current, value);                // LDUMAX
+                    default:    return std::min(current, value);                // LDUMIN
+                }
+            };
+
+            u8 *host = this->getAtomicHostPointer(address, accessSize, AccessType::Write);
+            if (host == nullptr) {
+                const T current = this->readMemory(address, accessSize);
+                this->writeMemory(address, accessSize, operation(current));
+
+                return current;
+            }
+
+            auto memory = atomicAt<T>(host);
+            T current;
+            if (o3)
+                current = memory.exchange(value, order);
+            else if (opc == 0b000)
+                current = memory.fetch_add(value, order);
+            else if (opc == 0b001)
+                current = memory.fetch_and(T(~value), order);
+            else if (opc == 0b010)
+                current = memory.fetch_xor(value, order);
+            else if (opc == 0b011)
+                current = memory.fetch_or(value, order);
+            else {
+                current = memory.load(std::memory_order_relaxed);
+                while (!memory.compare_exchange_weak(current, operation(current), order))
+                    ;
+            }
+
+            this->commitAtomicWrite(address, accessSize, operation(current));
+            return current;
+        });
+    }
+
+}
@@ -0,0 +1,452 @@
+#include "core.hpp"
+
+#include <array>
+#include <bit>
+
+// Host crypto instructions are compiled in on x86 regardless of the build flags and only used if the CPU has them
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define HOST_X86
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define HOST_TARGET(features)
+    #else
+        #include <cpuid.h>
+        #define HOST_TARGET(features) __attribute__((target(features)))
+    #endif
+#endif
+
+namespace arm {
+
+    namespace {
+
+        using core::VectorRegister;
+
+        struct HostFeatures {
+            bool aes = false;
+            bool sha = false;
+            bool crc32c = false;
+        };
+
+        HostFeatures detectHostFeatures() {
+            HostFeatures features;
+
+#if defined(HOST_X86)
+            u32 leaf1[4] = { 0 }, leaf7[4] = { 0 };
+    #if defined(_MSC_VER)
+            __cpuidex(reinterpret_cast<int*>(leaf1), 1, 0);
+            __cpuidex(reinterpret_cast<int*>(leaf7), 7, 0);
+    #else
+            __get_cpuid_count(1, 0, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+            __get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+    #endif
+
+            const bool ssse3  = leaf1[2] & (1 << 9);
+            const bool sse41  = leaf1[2] & (1 << 19);
+            const bool sse42  = leaf1[2] & (1 << 20);
+
+            features.aes    = leaf1[2] & (1 << 25);
+            features.sha    = (leaf7[1] & (1 << 29)) && ssse3 && sse41;
+            features.crc32c = sse42;
+#endif
+
+            return features;
+        }
+
+        // Queried once while the emulator starts up
+        const HostFeatures hostFeatures = detectHostFeatures();
+
+
+        /* AES */
+
+        constexpr u8 multiplyGF8(u8 a, u8 b) {
+            u8 result = 0;
+            while (b != 0) {
+                if (b & 1)
+                    result ^= a;
+                a = u8(a << 1) ^ ((a & 0x80) ? 0x1B : 0x00);
+                b >>= 1;
+            }
+
+            return result;
+        }
+
+        // Multiplicative inverse in GF(2^8) followed by the affine transformation
+        constexpr std::array<u8, 256> makeSubstitutionBox() {
+            std::array<u8, 256> box = { };
+            for (u32 value = 0; value < 256; value++) {
+                u8 inverse = 0;
+                for (u32 candidate = 1; value != 0 && candidate < 256; candidate++) {
+                    if (multiplyGF8(value, candidate) == 1) {
+                        inverse = candidate;
+                        break;
+                    }
+                }
+
+                box[value] = inverse ^ std::rotl(inverse, 1) ^ std::rotl(inverse, 2) ^ std::rotl(inverse, 3) ^ std::rotl(inverse, 4) ^ 0x63;
+            }
+
+            return box;
+        }
+
+        constexpr std::array<u8, 256> makeInverseSubstitutionBox(const std::array<u8, 256> &box) {
+            std::array<u8, 256> inverse = { };
+            for (u32 value = 0; value < 256; value++)
+                inverse[box[value]] = value;
+
+            return inverse;
+        }
+
+        constexpr auto SubstitutionBox = makeSubstitutionBox();
+        constexpr auto InverseSubstitutionBox = makeInverseSubstitutionBox(SubstitutionBox);
+
+        // The state is stored column by column, byte r + 4 * c is row r of column c
+        VectorRegister aesSubBytesShiftRows(const VectorRegister &state, bool inverse) {
+            VectorRegister result;
+            for (u8 column = 0; column < 4; column++) {
+                for (u8 row = 0; row < 4; row++) {
+                    const u8 sourceColumn = inverse ? (column + 4 - row) % 4 : (column + row) % 4;
+                    const u8 value = state.B[row + 4 * sourceColumn];
+                    result.B[row + 4 * column] = inverse ? InverseSubstitutionBox[value] : SubstitutionBox[value];
+                }
+            }
+
+            return result;
+        }
+
+        VectorRegister aesMixColumns(const VectorRegister &state, bool inverse) {
+            const std::array<u8, 4> coefficients = inverse ? std::array<u8, 4>{ 0x0E, 0x0B, 0x0D, 0x09 } : std::array<u8, 4>{ 0x02, 0x03, 0x01, 0x01 };
+
+            VectorRegister result;
+            for (u8 column = 0; column < 4; column++) {
+                for (u8 row = 0; row < 4; row++) {
+                    u8 value = 0;
+                    for (u8 i = 0; i < 4; i++)
+                        value ^= multiplyGF8(state.B[(row + i) % 4 + 4 * column], coefficients[i]);
+                    result.B[row + 4 * column] = value;
+                }
+            }
+
+            return result;
+        }
+
+#if defined(HOST_X86)
+        HOST_TARGET("aes,sse2")
+        VectorRegister hostAes(u8 opcode, const VectorRegister &d, const VectorRegister &n) {
+            const __m128i state = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(d.B)), _mm_load_si128(reinterpret_cast<const __m128i*>(n.B)));
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i source = _mm_load_si128(reinterpret_cast<const __m128i*>(n.B));
+
+            __m128i result;
+            switch (opcode) {
+                case 0b00100: result = _mm_aesenclast_si128(state, zero); break;                               // AESE
+                case 0b00101: result = _mm_aesdeclast_si128(state, zero); break;                               // AESD
+                case 0b00110: result = _mm_aesenc_si128(_mm_aesdeclast_si128(source, zero), zero); break;      // AESMC, undoing the substitution and shift first
+                default:      result = _mm_aesimc_si128(source); break;                                        // AESIMC
+            }
+
+            VectorRegister value;
+            _mm_store_si128(reinterpret_cast<__m128i*>(value.B), result);
+            return value;
+        }
+#endif
+
+
+        /* SHA */
+
+        u32 sha1Choose(u32 x, u32 y, u32 z) { return ((y ^ z) & x) ^ z; }
+        u32 sha1Parity(u32 x, u32 y, u32 z) { return x ^ y ^ z; }
+        u32 sha1Majority(u32 x, u32 y, u32 z) { return (x & y) | ((x | y) & z); }
+
+        u32 sha256Sigma0(u32 x) { return std::rotr(x, 2) ^ std::rotr(x, 13) ^ std::rotr(x, 22); }
+        u32 sha256Sigma1(u32 x) { return std::rotr(x, 6) ^ std::rotr(x, 11) ^ std::rotr(x, 25); }
+        u32 sha256SmallSigma0(u32 x) { return std::rotr(x, 7) ^ std::rotr(x, 18) ^ (x >> 3); }
+        u32 sha256SmallSigma1(u32 x) { return std::rotr(x, 17) ^ std::rotr(x, 19) ^ (x >> 10); }
+
+        // Four rounds, X holds A to D, y is E and w the message words with the round constants already added
+        VectorRegister sha1Hash(VectorRegister x, u32 y, const VectorRegister &w, u32 (*function)(u32, u32, u32)) {
+            for (u8 e = 0; e < 4; e++) {
+                y = y + std::rotl(x.S[0], 5) + function(x.S[1], x.S[2], x.S[3]) + w.S[e];
+                x.S[1] = std::rotl(x.S[1], 30);
+
+                const u32 carry = x.S[3];
+                x.S[3] = x.S[2];
+                x.S[2] = x.S[1];
+                x.S[1] = x.S[0];
+                x.S[0] = y;
+                y = carry;
+            }
+
+            return x;
+        }
+
+        // Four rounds, X holds A to D and Y holds E to H. SHA256H returns the new X, SHA256H2 the new Y
+        VectorRegister sha256Hash(VectorRegister x, VectorRegister y, const VectorRegister &w, bool part1) {
+            for (u8 e = 0; e < 4; e++) {
+                const u32 choose = (y.S[0] & y.S[1]) ^ (~y.S[0] & y.S[2]);
+                const u32 majority = (x.S[0] & x.S[1]) ^ (x.S[0] & x.S[2]) ^ (x.S[1] & x.S[2]);
+                const u32 t = y.S[3] + sha256Sigma1(y.S[0]) + choose + w.S[e];
+
+                x.S[3] = t + x.S[3];
+                y.S[3] = t + sha256Sigma0(x.S[0]) + majority;
+
+                const u32 carryX = x.S[3], carryY = y.S[3];
+                for (u8 i = 3; i > 0; i--) {
+                    x.S[i] = x.S[i - 1];
+                    y.S[i] = y.S[i - 1];
+                }
+                x.S[0] = carryY;
+                y.S[0] = carryX;
+            }
+
+            return part1 ? x : y;
+        }
+
+#if defined(HOST_X86)
+        // SHA-NI keeps the first word in the highest lane, the Arm instructions in the lowest one
+        HOST_TARGET("sha,sse4.1,ssse3")
+        __m128i reverseWords(__m128i value) {
+            return _mm_shuffle_epi32(value, _MM_SHUFFLE(0, 1, 2, 3));
+        }
+
+        HOST_TARGET("sha,sse4.1,ssse3")
+        VectorRegister hostShaThreeRegister(u8 opcode, const VectorRegister &d, const VectorRegister &n, const VectorRegister &m) {
+            const __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(d.B));
+            const __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(n.B));
+            const __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(m.B));
+
+            __m128i result;
+            switch (opcode) {
+                case 0b000:     // SHA1C
+                case 0b001:     // SHA1P
+                case 0b010: {   // SHA1M
+                    // sha1rnds4 adds its own round constant and expects E to be added to the first message word
+                    static constexpr u32 RoundConstants[] = { 0x5A82'7999, 0x6ED9'EBA1, 0x8F1B'BCDC };
+                    __m128i message = _mm_sub_epi32(reverseWords(w), _mm_set1_epi32(s32(RoundConstants[opcode])));
+                    message = _mm_add_epi32(message, _mm_set_epi32(s32(n.S[0]), 0, 0, 0));
+
+                    const __m128i state = reverseWords(x);
+                    switch (opcode) {
+                        case 0b000: result = _mm_sha1rnds4_epu32(state, message, 0); break;
+                        case 0b001: result = _mm_sha1rnds4_epu32(state, message, 1); break;
+                        default:    result = _mm_sha1rnds4_epu32(state, message, 2); break;
+                    }
+                    result = reverseWords(result);
+                    break;
+                }
+                case 0b011: // SHA1SU0
+                    result = _mm_xor_si128(reverseWords(_mm_sha1msg1_epu32(reverseWords(x), reverseWords(y))), w);
+                    break;
+                case 0b100:     // SHA256H
+                case 0b101: {   // SHA256H2
+                    const __m128i abcd = reverseWords(opcode == 0b100 ? x : y);
+                    const __m128i efgh = reverseWords(opcode == 0b100 ? y : x);
+
+                    // Repack into the ABEF / CDGH layout sha256rnds2 works on, two rounds at a time
+                    const __m128i abef = _mm_unpackhi_epi64(efgh, abcd);
+                    const __m128i cdgh = _mm_unpacklo_epi64(efgh, abcd);
+                    const __m128i abef1 = _mm_sha256rnds2_epu32(cdgh, abef, w);
+                    const __m128i abef2 = _mm_sha256rnds2_epu32(abef, abef1, _mm_unpackhi_epi64(w, w));
+
+                    result = reverseWords(opcode == 0b100 ? _mm_unpackhi_epi64(abef1, abef2) : _mm_unpacklo_epi64(abef1, abef2));
+                    break;
+                }
+                default:    // SHA256SU1
+                    result = _mm_sha256msg2_epu32(_mm_add_epi32(x, _mm_alignr_epi8(w, y, 4)), w);
+                    break;
+            }
+
+            VectorRegister value;
+            _mm_store_si128(reinterpret_cast<__m128i*>(value.B), result);
+            return value;
+        }
+
+        HOST_TARGET("sha,sse4.1,ssse3")
+        VectorRegister hostShaTwoRegister(u8 opcode, const VectorRegister &d, const VectorRegister &n) {
+            const __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(d.B));
+            const __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(n.B));
+
+            __m128i result;
+            if (opcode == 0b00001)  // SHA1SU1
+                result = reverseWords(_mm_sha1msg2_epu32(reverseWords(x), reverseWords(y)));
+            else                    // SHA256SU0
+                result = _mm_sha256msg1_epu32(x, y);
+
+            VectorRegister value;
+            _mm_store_si128(reinterpret_cast<__m128i*>(value.B), result);
+            return value;
+        }
+#endif
+
+
+        /* CRC32 */
+
+        // Reflected polynomials, the instructions neither invert the accumulator nor the result
+        constexpr u32 CRC32Polynomial  = 0xEDB8'8320;
+        constexpr u32 CRC32CPolynomial = 0x82F6'3B78;
+
+        constexpr std::array<u32, 256> makeCrcTable(u32 polynomial) {
+            std::array<u32, 256> table = { };
+            for (u32 value = 0; value < 256; value++) {
+                u32 crc = value;
+                for (u8 bit = 0; bit < 8; bit++)
+                    crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+                table[value] = crc;
+            }
+
+            return table;
+        }
+
+        constexpr auto CRC32Table  = makeCrcTable(CRC32Polynomial);
+        constexpr auto CRC32CTable = makeCrcTable(CRC32CPolynomial);
+
+        u32 crcUpdate(const std::array<u32, 256> &table, u32 crc, u64 data, u8 bytes) {
+            for (u8 i = 0; i < bytes; i++)
+                crc = table[(crc ^ (data >> (i * 8))) & 0xFF] ^ (crc >> 8);
+
+            return crc;
+        }
+
+#if defined(HOST_X86)
+        HOST_TARGET("sse4.2")
+        u32 hostCrc32c(u32 crc, u64 data, u8 size) {
+            switch (size) {
+                case 0:  return _mm_crc32_u8(crc, u8(data));
+                case 1:  return _mm_crc32_u16(crc, u16(data));
+                case 2:  return _mm_crc32_u32(crc, u32(data));
+    #if defined(__x86_64__) || defined(_M_X64)
+                default: return u32(_mm_crc32_u64(crc, data));
+    #else
+                default: return _mm_crc32_u32(_mm_crc32_u32(crc, u32(data)), u32(data >> 32));
+    #endif
+            }
+        }
+#endif
+
+    }
+
+    INSTRUCTION_DEF(AES) {
+        const u8 opcode = extract<BITS(12:16)>(inst);
+
+#if defined(HOST_X86)
+        if (hostFeatures.aes) {
+            V[Rd] = hostAes(opcode, V[Rd], V[Rn]);
+            return;
+        }
+#endif
+
+        core::VectorRegister state;
+        switch (opcode) {
+            case 0b00100: // AESE
+            case 0b00101: // AESD
+                state.D[0] = V[Rd].D[0] ^ V[Rn].D[0];
+                state.D[1] = V[Rd].D[1] ^ V[Rn].D[1];
+                V[Rd] = aesSubBytesShiftRows(state, opcode == 0b00101);
+                break;
+            case 0b00110: // AESMC
+                V[Rd] = aesMixColumns(V[Rn], false);
+                break;
+            default:      // AESIMC
+                V[Rd] = aesMixColumns(V[Rn], true);
+                break;
+        }
+    }
+
+    INSTRUCTION_DEF(SHA_THREE_REGISTER) {
+        const u8 opcode = extract<BITS(12:14)>(inst);
+        if (opcode == 0b111)
+            return this->unimplementedInstruction(inst);
+
+#if defined(HOST_X86)
+        if (hostFeatures.sha) {
+            V[Rd] = hostShaThreeRegister(opcode, V[Rd], V[Rn], V[Rm]);
+            return;
+        }
+#endif
+
+        const core::VectorRegister &x = V[Rd];
+        const core::VectorRegister &y = V[Rn];
+        const core::VectorRegister &w = V[Rm];
+
+        core::VectorRegister result;
+        switch (opcode) {
+            case 0b000: result = sha1Hash(x, y.S[0], w, sha1Choose);   break; // SHA1C
+            case 0b001: result = sha1Hash(x, y.S[0], w, sha1Parity);   break; // SHA1P
+            case 0b010: result = sha1Hash(x, y.S[0], w, sha1Majority); break; // SHA1M
+            case 0b011: // SHA1SU0
+                result.S[0] = x.S[2] ^ x.S[0] ^ w.S[0];
+                result.S[1] = x.S[3] ^ x.S[1] ^ w.S[1];
+                result.S[2] = y.S[0] ^ x.S[2] ^ w.S[2];
+                result.S[3] = y.S[1] ^ x.S[3] ^ w.S[3];
+                break;
+            case 0b100: result = sha256Hash(x, y, w, true);  break; // SHA256H
+            case 0b101: result = sha256Hash(y, x, w, false); break; // SHA256H2
+            default:    // SHA256SU1
+                result.S[0] = x.S[0] + sha256SmallSigma1(w.S[2]) + y.S[1];
+                result.S[1] = x.S[1] + sha256SmallSigma1(w.S[3]) + y.S[2];
+                result.S[2] = x.S[2] + sha256SmallSigma1(result.S[0]) + y.S[3];
+                result.S[3] = x.S[3] + sha256SmallSigma1(result.S[1]) + w.S[0];
+                break;
+        }
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(SHA_TWO_REGISTER) {
+        const u8 opcode = extract<BITS(12:16)>(inst);
+        const core::VectorRegister &x = V[Rd];
+        const core::VectorRegister &y = V[Rn];
+
+        core::VectorRegister result;
+        switch (opcode) {
+            case 0b00000: // SHA1H
+                result.S[0] = std::rotl(y.S[0], 30);
+                break;
+            case 0b00001: // SHA1SU1
+            case 0b00010: // SHA256SU0
+#if defined(HOST_X86)
+                if (hostFeatures.sha) {
+                    result = hostShaTwoRegister(opcode, x, y);
+                    break;
+                }
+#endif
+                if (opcode == 0b00001) {
+                    const u32 t[4] = { x.S[0] ^ y.S[1], x.S[1] ^ y.S[2], x.S[2] ^ y.S[3], x.S[3] };
+                    for (u8 i = 0; i < 4; i++)
+                        result.S[i] = std::rotl(t[i], 1);
+                    result.S[3] ^= std::rotl(t[0], 2);
+                } else {
+                    const u32 t[4] = { x.S[1], x.S[2], x.S[3], y.S[0] };
+                    for (u8 i = 0; i < 4; i++)
+                        result.S[i] = x.S[i] + sha256SmallSigma0(t[i]);
+                }
+                break;
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(CRC32) {
+        const bool castagnoli = extract<BIT(12)>(inst);
+        const u8 dataSize = extract<BITS(10:11)>(inst);
+        if (sf != (dataSize == 0b11))
+            return this->unimplementedInstruction(inst);
+
+        const u32 accumulator = GPZR(Rn).X;
+        const u64 data = GPZR(Rm).X;
+
+        // CRC32C is what SSE4.2 implements, plain CRC32 has no x86 counterpart
+#if defined(HOST_X86)
+        if (castagnoli && hostFeatures.crc32c) {
+            GPZR(Rd).X = hostCrc32c(accumulator, data, dataSize);
+            return;
+        }
+#endif
+
+        GPZR(Rd).X = crcUpdate(castagnoli ? CRC32CTable : CRC32Table, accumulator, data, 1 << dataSize);
+    }
+
+}
@@ -0,0 +1,402 @@
+#include "core.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+namespace arm {
+
+    namespace {
+
+        constexpr u8 ConditionNotEqual = 0b0001;
+        constexpr u8 ConditionCarryClear = 0b0011;
+        constexpr u8 ConditionGreaterThan = 0b1100;
+
+        struct LoopAccess {
+            u8 pointer;
+            s64 offset;
+            u8 size;
+            u8 reg;
+            bool load;
+        };
+
+        struct FlagSetter {
+            u8 reg;
+            std::optional<u8> end;
+            s64 delta;
+            bool sf;
+        };
+
+        // The accesses have to cover [0, stride) exactly once
+        bool tilesStride(std::vector<LoopAccess> accesses, s64 stride) {
+            std::ranges::sort(accesses, {}, &LoopAccess::offset);
+
+            s64 covered = 0;
+            for (const auto &access : accesses) {
+                if (access.offset != covered)
+                    return false;
+                covered += access.size;
+            }
+
+            return covered == stride;
+        }
+
+    }
+
+    /*
+     * Recognises the loop shapes memcpy and memset implementations compile to: post-indexed or offset LDR / STR / LDP / STP
+     * and DC ZVA walking one or two pointers, a counter counted down by SUB(S) or a pointer compared against an end
+     * address, and a CBNZ or B.cond back to the start of the block. Registers are numbered the way the instructions encode
+     * them, 31 is SP as a base and ZR everywhere else.
+     */
+    std::optional<MemoryLoop> Core::analyzeMemoryLoop(addr_t address, const TranslationBlock &block) {
+        const auto &instructions = block.instructions;
+        if (instructions.size() < 3)
+            return std::nullopt;
+
+        MemoryLoop loop = { };
+
+        const inst_t branch = instructions.back().instruction;
+        const addr_t branchAddress = address + (instructions.size() - 1) * InstructionWidth;
+        const bool conditional = instructions.back().handler == &Core::B_COND;
+        if (conditional) {
+            loop.condition = extract<BITS(0:3)>(branch);
+            if (loop.condition != ConditionNotEqual && loop.condition != ConditionCarryClear && loop.condition != ConditionGreaterThan)
+                return std::nullopt;
+        } else if (instructions.back().handler == &Core::CBNZ) {
+            loop.condition = ConditionNotEqual;
+            loop.counter = extract<BITS(0:4)>(branch);
+            loop.is64 = extract<BIT(31)>(branch);
+            if (loop.counter == 31)
+                return std::nullopt;
+        } else {
+            return std::nullopt;
+        }
+
+        if (branchAddress + (extendSign(extract<BITS(5:23)>(branch), 19, 64) << 2) != address)
+            return std::nullopt;
+
+        std::array<s64, 32> delta = { };
+        std::bitset<32> pointers, loaded, updated, narrow, wide;
+        std::vector<LoopAccess> accesses;
+        std::optional<FlagSetter> flagSetter;
+        std::vector<std::pair<size_t, u8>> storedBeforeLoad;
+
+        const auto access = [&](u8 pointer, s64 offset, u8 size, u8 reg, bool load) {
+            pointers[pointer] = true;
+            if (load)
+                loaded[reg] = true;
+            else if (!loaded[reg])
+                storedBeforeLoad.emplace_back(accesses.size(), reg);
+
+            accesses.push_back({ pointer, offset, size, reg, load });
+        };
+
+        const auto update = [&](u8 reg, s64 amount, bool sf) {
+            delta[reg] += amount;
+            updated[reg] = true;
+            (sf ? wide : narrow)[reg] = true;
+        };
+
+        for (size_t i = 0; i < instructions.size() - 1; i++) {
+            const auto &[handler, inst, patternIndex] = instructions[i];
+            const u8 Rt = extract<BITS(0:4)>(inst);
+            const u8 Rn = extract<BITS(5:9)>(inst);
+
+            if (handler == &Core::STR_IMMEDIATE || handler == &Core::LDR_IMMEDIATE) {
+                const bool load = handler == &Core::LDR_IMMEDIATE;
+                const u8 size = 1 << extract<BITS(30:31)>(inst);
+                const s64 imm9 = extendSign(extract<BITS(12:20)>(inst), 9, 64);
+
+                if (load && Rt == Rn)
+                    return std::nullopt;
+
+                if (extract<BIT(24)>(inst)) {
+                    access(Rn, delta[Rn] + s64(extract<BITS(10:21)>(inst)) * size, size, Rt, load);
+                } else {
+                    switch (extract<BITS(10:11)>(inst)) {
+                        case 0b01:
+                            access(Rn, delta[Rn], size, Rt, load);
+                            delta[Rn] += imm9;
+                            break;
+                        case 0b11:
+                            delta[Rn] += imm9;
+                            access(Rn, delta[Rn], size, Rt, load);
+                            break;
+                        case 0b00:
+                            access(Rn, delta[Rn] + imm9, size, Rt, load);
+                            break;
+                        default:
+                            return std::nullopt;
+                    }
+                }
+            } else if (handler == &Core::STP || handler == &Core::LDP) {
+                const bool load = handler == &Core::LDP;
+                const u8 Rt2 = extract<BITS(10:14)>(inst);
+                const u8 opc = extract<BITS(30:31)>(inst);
+                const u8 mode = extract<BITS(23:24)>(inst);
+
+                if (opc != 0b00 && opc != 0b10)
+                    return std::nullopt;
+                if (load && (Rt == Rt2 || Rt == Rn || Rt2 == Rn))
+                    return std::nullopt;
+
+                const u8 size = opc == 0b10 ? 8 : 4;
+                const s64 offset = extendSign(extract<BITS(15:21)>(inst), 7, 64) * size;
+
+                if (mode == 0b11)
+                    delta[Rn] += offset;
+
+                const s64 base = mode == 0b01 || mode == 0b11 ? delta[Rn] : delta[Rn] + offset;
+                access(Rn, base, size, Rt, load);
+                access(Rn, base + size, size, Rt2, load);
+
+                if (mode == 0b01)
+                    delta[Rn] += offset;
+            } else if (handler == &Core::DC_ZVA) {
+                if (delta[Rt] % ZeroBlockSize != 0)
+                    return std::nullopt;
+
+                access(Rt, delta[Rt], ZeroBlockSize, 31, false);
+                loop.alignment = ZeroBlockSize;
+            } else if (handler == &Core::ADD_IMMEDIATE || handler == &Core::SUB_IMMEDIATE || handler == &Core::SUBS_IMMEDIATE) {
+                const bool sf = extract<BIT(31)>(inst);
+                const s64 imm = s64(extract<BITS(10:21)>(inst)) << (extract<BIT(22)>(inst) ? 12 : 0);
+
+                if (Rt != Rn)
+                    return std::nullopt;
+
+                if (handler == &Core::ADD_IMMEDIATE) {
+                    update(Rn, imm, sf);
+                } else {
+                    update(Rn, -imm, sf);
+
+                    if (handler == &Core::SUBS_IMMEDIATE) {
+                        if (Rn == 31)
+                            return std::nullopt;
+                        flagSetter = FlagSetter{ Rn, std::nullopt, delta[Rn], sf };
+                    }
+                }
+            } else if (handler == &Core::SUBS_SHIFTED_REGISTER) {
+                const u8 Rm = extract<BITS(16:20)>(inst);
+
+                // CMP pointer, end
+                if (Rt != 31 || Rn == 31 || Rm == 31 || extract<BITS(10:15)>(inst) != 0 || !extract<BIT(31)>(inst))
+                    return std::nullopt;
+
+                flagSetter = FlagSetter{ Rn, Rm, delta[Rn], true };
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        // Pointers move by their writeback too, not just by arithmetic
+        for (u8 reg = 0; reg < 32; reg++) {
+            if (delta[reg] != 0)
+                updated[reg] = true;
+            if (pointers[reg])
+                wide[reg] = true;
+            if (narrow[reg] && wide[reg])
+                return std::nullopt;
+        }
+
+        if ((loaded & (pointers | updated)).any())
+            return std::nullopt;
+
+        if (conditional) {
+            if (!flagSetter.has_value() || delta[flagSetter->reg] != flagSetter->delta)
+                return std::nullopt;
+
+            loop.counter = flagSetter->reg;
+            loop.end = flagSetter->end;
+            loop.is64 = flagSetter->sf;
+
+            if (loop.end.has_value()) {
+                if (loop.condition == ConditionGreaterThan || flagSetter->delta <= 0 || loaded[*loop.end] || updated[*loop.end])
+                    return std::nullopt;
+                loop.step = flagSetter->delta;
+            } else {
+                if (loop.condition == ConditionCarryClear || flagSetter->delta >= 0)
+                    return std::nullopt;
+                loop.step = -flagSetter->delta;
+            }
+        } else {
+            if (delta[loop.counter] >= 0 || narrow[loop.counter] == loop.is64)
+                return std::nullopt;
+            loop.step = -delta[loop.counter];
+        }
+
+        if (loaded[loop.counter] || pointers[loop.counter] != loop.end.has_value())
+            return std::nullopt;
+
+        std::vector<LoopAccess> loads, stores;
+        for (const auto &entry : accesses)
+            (entry.load ? loads : stores).push_back(entry);
+
+        if (stores.empty())
+            return std::nullopt;
+
+        loop.destination = stores.front().pointer;
+        if (!std::ranges::all_of(stores, [&](const auto &store) { return store.pointer == loop.destination; }))
+            return std::nullopt;
+
+        const s64 stride = delta[loop.destination];
+        if (stride <= 0 || stride > MaxMemoryLoopStride || !tilesStride(stores, stride))
+            return std::nullopt;
+        if (loop.alignment != 0 && stride % loop.alignment != 0)
+            return std::nullopt;
+
+        if (!loads.empty()) {
+            // Copy, every store writes back exactly what was loaded from the same offset in the source
+            loop.source = loads.front().pointer;
+            if (*loop.source == loop.destination || delta[*loop.source] != stride || !storedBeforeLoad.empty())
+                return std::nullopt;
+            if (!std::ranges::all_of(loads, [&](const auto &load) { return load.pointer == *loop.source; }) || !tilesStride(loads, stride))
+                return std::nullopt;
+
+            for (size_t i = 0; i < accesses.size(); i++) {
+                if (accesses[i].load)
+                    continue;
+
+                const auto &store = accesses[i];
+                const auto load = std::find_if(accesses.rbegin() + (accesses.size() - i), accesses.rend(), [&](const auto &candidate) {
+                    return candidate.load && candidate.reg == store.reg;
+                });
+
+                if (load == accesses.rend() || load->offset != store.offset || load->size != store.size)
+                    return std::nullopt;
+            }
+        } else {
+            // Fill, the stored registers have to hold the same value in every iteration
+            for (const auto &store : stores) {
+                if (store.reg != 31 && updated[store.reg])
+                    return std::nullopt;
+
+                loop.pattern.push_back({ u16(store.offset), store.size, store.reg });
+            }
+        }
+
+        loop.stride = stride;
+        if (loop.alignment == 0)
+            loop.alignment = 1;
+
+        for (u8 reg = 0; reg < 32; reg++) {
+            if (delta[reg] != 0)
+                loop.updates.push_back({ reg, delta[reg], !narrow[reg] });
+        }
+
+        return loop;
+    }
+
+    void Core::runMemoryLoop(const MemoryLoop &loop, size_t blockLength) {
+        // Anything watching individual accesses or instructions gets to see every iteration
+        if (this->m_memoryWriteLog != nullptr || this->m_profiler != nullptr || this->m_collectStatistics)
+            return;
+
+        u64 iterations;
+        if (loop.end.has_value()) {
+            const u64 current = GPZR(loop.counter).X;
+            const u64 end = GPZR(*loop.end).X;
+            if (end <= current)
+                return;
+
+            const u64 distance = end - current;
+            if (loop.condition == ConditionNotEqual && distance % loop.step != 0)
+                return;
+
+            iterations = (distance + loop.step - 1) / loop.step;
+        } else {
+            const u64 current = loop.is64 ? GPZR(loop.counter).X : GPZR(loop.counter).W;
+
+            if (loop.condition == ConditionNotEqual) {
+                if (current == 0 || current % loop.step != 0)
+                    return;
+
+                iterations = current / loop.step;
+            } else {
+                const s64 value = loop.is64 ? s64(current) : s32(current);
+                if (value <= 0)
+                    return;
+
+                iterations = (u64(value) + loop.step - 1) / loop.step;
+            }
+        }
+
+        // The last iteration sets the flags and leaves the loaded registers behind, the interpreter does that one. Stop short of the deadline so events stay on time
+        u64 remaining = iterations - 1;
+        if (this->m_deadline != std::numeric_limits<vtime_t>::max()) {
+            const vtime_t now = this->getVirtualTime();
+            const u64 budget = now < this->m_deadline ? (this->m_deadline - now) / blockLength : 0;
+            remaining = std::min(remaining, budget > 0 ? budget - 1 : 0);
+        }
+
+        if (remaining < MinimumMemoryLoopIterations || GPSP(loop.destination).X % loop.alignment != 0)
+            return;
+
+        std::array<u8, MaxMemoryLoopStride> pattern = { };
+        for (const auto &store : loop.pattern) {
+            const u64 value = GPZR(store.reg).X;
+            if (store.size <= sizeof(value))
+                std::memcpy(pattern.data() + store.offset, &value, store.size);
+        }
+        const bool uniform = std::all_of(pattern.begin(), pattern.begin() + loop.stride, [&](u8 byte) { return byte == pattern[0]; });
+
+        const auto translate = [this](addr_t address, AccessType access) -> std::optional<addr_t> {
+            try {
+                return this->m_mmu.translate(address, access, PSTATE.EL != 0);
+            } catch (const TranslationFault &) {
+                // Left to the loop itself so the abort is taken on the exact access
+                return std::nullopt;
+            }
+        };
+
+        // One page at a time, never splitting an iteration
+        while (remaining > 0) {
+            const addr_t destination = GPSP(loop.destination).X;
+            const addr_t source = loop.source.has_value() ? GPSP(*loop.source).X : 0;
+
+            u64 chunk = std::min(remaining, (MinimumPageSize - destination % MinimumPageSize) / loop.stride);
+            if (loop.source.has_value())
+                chunk = std::min(chunk, (MinimumPageSize - source % MinimumPageSize) / loop.stride);
+            if (chunk == 0)
+                break;
+
+            const size_t bytes = chunk * loop.stride;
+            const std::optional<addr_t> physicalTarget = translate(destination, AccessType::Write);
+            u8 *target = physicalTarget.has_value() ? this->m_addressSpace->getHostPointer(*physicalTarget, bytes, true) : nullptr;
+            if (target == nullptr)
+                break;
+
+            if (loop.source.has_value()) {
+                // Going iteration by iteration only matches a single copy if the two don't overlap
+                if (source < destination + bytes && destination < source + bytes)
+                    break;
+
+                const std::optional<addr_t> physicalOrigin = translate(source, AccessType::Read);
+                const u8 *origin = physicalOrigin.has_value() ? this->m_addressSpace->getHostPointer(*physicalOrigin, bytes, false) : nullptr;
+                if (origin == nullptr)
+                    break;
+
+                std::memcpy(target, origin, bytes);
+            } else if (uniform) {
+                std::memset(target, pattern[0], bytes);
+            } else {
+                for (u64 i = 0; i < chunk; i++)
+                    std::memcpy(target + i * loop.stride, pattern.data(), loop.stride);
+            }
+
+            this->m_addressSpace->commitWrite(*physicalTarget, bytes);
+
+            for (const auto &update : loop.updates) {
+                if (update.sf)
+                    GPSP(update.reg).X += update.delta * s64(chunk);
+                else
+                    GPSP(update.reg).X = u32(GPSP(update.reg).W + update.delta * s64(chunk));
+            }
+
+            this->m_retiredInstructions += chunk * blockLength;
+            remaining -= chunk;
+        }
+    }
+
+}
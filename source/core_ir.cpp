@@ -0,0 +1,332 @@
+#include "core.hpp"
+
+#include <algorithm>
+#include <span>
+
+namespace arm {
+
+    namespace {
+
+        class Builder {
+        public:
+            explicit Builder(ir::Block &block) : m_block(block) { }
+
+            u16 emit(ir::Opcode opcode, u8 width = 64, u16 a = 0, std::optional<u16> b = std::nullopt, u64 imm = 0, u8 reg = 0) {
+                this->m_block.instructions.push_back({ opcode, width, reg, this->m_guest, a, b.value_or(a), imm });
+
+                return u16(this->m_block.instructions.size() - 1);
+            }
+
+            u16 constant(u64 value) {
+                return this->emit(ir::Opcode::Const, 64, 0, std::nullopt, value);
+            }
+
+            // 31 is SP for base registers and the immediate arithmetic forms, ZR everywhere else
+            u16 read(u8 reg, bool sp) {
+                if (reg == 31 && !sp)
+                    return this->constant(0);
+
+                return this->emit(ir::Opcode::GetRegister, 64, 0, std::nullopt, 0, reg == 31 ? ir::StackPointer : reg);
+            }
+
+            void write(u8 reg, u16 value, bool sp) {
+                if (reg == 31 && !sp)
+                    return;
+
+                this->emit(ir::Opcode::SetRegister, 64, value, std::nullopt, 0, reg == 31 ? ir::StackPointer : reg);
+            }
+
+            u16 shift(u16 value, u8 shiftType, u8 amount, u8 width) {
+                constexpr std::array opcodes = { ir::Opcode::Shl, ir::Opcode::Lsr, ir::Opcode::Asr, ir::Opcode::Ror };
+
+                return this->emit(opcodes[shiftType], width, value, std::nullopt, amount);
+            }
+
+            void setGuest(u8 guest) {
+                this->m_guest = guest;
+            }
+
+        private:
+            ir::Block &m_block;
+            u8 m_guest = 0;
+        };
+
+    }
+
+    /*
+     * Lowers the data processing, move, PC relative, load / store and branch instructions blocks mostly consist of.
+     * Everything else becomes a Call to its handler, which the passes treat as touching all guest state. Blocks where too
+     * little gets lowered aren't worth it and keep running on the handlers alone.
+     */
+    std::optional<ir::Block> Core::lowerBlock(addr_t address, const TranslationBlock &block) {
+        ir::Block result = { address, u8(block.instructions.size()), { }, { }, { }, { } };
+        Builder builder(result);
+
+        const auto patterns = getInstructionPatterns();
+        size_t calls = 0;
+
+        for (u8 i = 0; i < block.instructions.size(); i++) {
+            const auto &[handler, inst, patternIndex] = block.instructions[i];
+            const InstructionHandler generic = patterns[patternIndex].type;
+            const addr_t pc = address + i * InstructionWidth;
+
+            const u8 Rd = extract<BITS(0:4)>(inst);
+            const u8 Rn = extract<BITS(5:9)>(inst);
+            const u8 Rm = extract<BITS(16:20)>(inst);
+            const bool sf = extract<BITS(31:31)>(inst);
+            const u8 width = sf ? 64 : 32;
+            const u8 imm6 = extract<BITS(10:15)>(inst);
+            const u16 imm12 = extract<BITS(10:21)>(inst);
+            const u8 shift = extract<BITS(22:23)>(inst);
+
+            builder.setGuest(i);
+
+            if (generic == &Core::ADD_IMMEDIATE || generic == &Core::ADDS_IMMEDIATE || generic == &Core::SUB_IMMEDIATE || generic == &Core::SUBS_IMMEDIATE) {
+                const bool subtract = generic == &Core::SUB_IMMEDIATE || generic == &Core::SUBS_IMMEDIATE;
+                const bool setFlags = generic == &Core::ADDS_IMMEDIATE || generic == &Core::SUBS_IMMEDIATE;
+
+                const u16 operand1 = builder.read(Rn, true);
+                const u16 operand2 = builder.constant(shift == 0b01 ? u64(imm12) << 12 : imm12);
+                const u16 value = builder.emit(subtract ? ir::Opcode::Sub : ir::Opcode::Add, width, operand1, operand2);
+
+                if (setFlags)
+                    builder.emit(ir::Opcode::SetFlags, 64, builder.emit(subtract ? ir::Opcode::SubFlags : ir::Opcode::AddFlags, width, operand1, operand2));
+                builder.write(Rd, value, !setFlags);
+            } else if (generic == &Core::ADD_SHIFTED_REGISTER || generic == &Core::SUB_SHIFTED_REGISTER || generic == &Core::SUBS_SHIFTED_REGISTER) {
+                const bool subtract = generic != &Core::ADD_SHIFTED_REGISTER;
+                const bool setFlags = generic == &Core::SUBS_SHIFTED_REGISTER;
+
+                const u16 operand1 = builder.read(Rn, false);
+                const u16 operand2 = builder.shift(builder.read(Rm, false), shift, imm6, width);
+                const u16 value = builder.emit(subtract ? ir::Opcode::Sub : ir::Opcode::Add, width, operand1, operand2);
+
+                if (setFlags)
+                    builder.emit(ir::Opcode::SetFlags, 64, builder.emit(ir::Opcode::SubFlags, width, operand1, operand2));
+                builder.write(Rd, value, false);
+            } else if (generic == &Core::AND_SHIFTED_REGISTER || generic == &Core::ORR_SHIFTED_REGISTER || generic == &Core::ANDS_SHIFTED_REGISTER ||
+                       generic == &Core::AND_IMMEDIATE || generic == &Core::ORR_IMMEDIATE || generic == &Core::ANDS_IMMEDIATE) {
+                const bool immediate = generic == &Core::AND_IMMEDIATE || generic == &Core::ORR_IMMEDIATE || generic == &Core::ANDS_IMMEDIATE;
+                const u8 opc = extract<BITS(29:30)>(inst);
+
+                u16 operand2;
+                if (immediate)
+                    operand2 = builder.constant(this->decodeImmediateWMask(extract<BIT(22)>(inst), extract<BITS(10:15)>(inst), extract<BITS(16:21)>(inst)));
+                else
+                    operand2 = builder.shift(builder.read(Rm, false), shift, imm6, width);
+
+                const u16 value = builder.emit(opc == 0b01 ? ir::Opcode::Or : ir::Opcode::And, width, builder.read(Rn, false), operand2);
+
+                if (opc == 0b11)
+                    builder.emit(ir::Opcode::SetFlags, 64, builder.emit(ir::Opcode::LogicFlags, width, value));
+                builder.write(Rd, value, immediate && opc != 0b11);
+            } else if (generic == &Core::MOVNZK) {
+                const u8 hw = extract<BITS(21:22)>(inst);
+                const u8 opc = extract<BITS(29:30)>(inst);
+                const u64 value = u64(extract<BITS(5:20)>(inst)) << (hw * 16);
+                const u64 mask = 0xFFFFULL << (hw * 16);
+
+                u16 result;
+                if (opc == 0b00)
+                    result = builder.constant(sf ? ~value : u32(~value));
+                else if (opc == 0b11)
+                    result = builder.emit(ir::Opcode::Or, width, builder.emit(ir::Opcode::And, width, builder.read(Rd, false), builder.constant(~mask)), builder.constant(value));
+                else
+                    result = builder.constant(sf ? value : u32(value));
+
+                builder.write(Rd, result, false);
+            } else if (generic == &Core::ADRP) {
+                const s64 imm = extendSign(((extract<BITS(5:23)>(inst) << 2) | extract<BITS(29:30)>(inst)) << 12, 33, 64);
+
+                builder.write(Rd, builder.constant((pc & ~0xFFFULL) + imm), false);
+            } else if ((generic == &Core::LDR_IMMEDIATE || generic == &Core::STR_IMMEDIATE) && !(extract<BITS(24:25)>(inst) == 0b00 && extract<BITS(10:11)>(inst) == 0b10)) {
+                const bool load = generic == &Core::LDR_IMMEDIATE;
+                const u8 scale = extract<BITS(31:30)>(inst);
+                const bool unsignedOffset = extract<BITS(24:25)>(inst) == 0b01;
+                const u8 mode = extract<BITS(10:11)>(inst);
+                const bool postIndex = !unsignedOffset && mode == 0b01;
+                const bool writeback = !unsignedOffset && mode != 0b00;
+
+                const u16 base = builder.read(Rn, true);
+                const u16 offset = builder.constant(unsignedOffset ? u64(imm12) << scale : extendSign(extract<BITS(12:20)>(inst), 9, 64));
+                const u16 target = builder.emit(ir::Opcode::Add, 64, base, offset);
+                const u16 accessAddress = postIndex ? base : target;
+
+                if (load) {
+                    const u16 value = builder.emit(ir::Opcode::Load, 1U << scale, accessAddress);
+                    if (writeback)
+                        builder.write(Rn, target, true);
+                    builder.write(Rd, value, false);
+                } else {
+                    builder.emit(ir::Opcode::Store, 1U << scale, accessAddress, builder.read(Rd, false));
+                    if (writeback)
+                        builder.write(Rn, target, true);
+                }
+            } else if ((generic == &Core::LDR_REGISTER || generic == &Core::STR_REGISTER) && (extract<BITS(13:15)>(inst) & 0b011) == 0b011) {
+                // Only LSL and SXTX, which take the offset register as is
+                const u8 scale = extract<BITS(31:30)>(inst);
+                const u16 offset = builder.shift(builder.read(Rm, false), 0b00, extract<BIT(12)>(inst) ? scale : 0, 64);
+                const u16 accessAddress = builder.emit(ir::Opcode::Add, 64, builder.read(Rn, true), offset);
+
+                if (generic == &Core::LDR_REGISTER)
+                    builder.write(Rd, builder.emit(ir::Opcode::Load, 1U << scale, accessAddress), false);
+                else
+                    builder.emit(ir::Opcode::Store, 1U << scale, accessAddress, builder.read(Rd, false));
+            } else if (generic == &Core::B || generic == &Core::BL) {
+                const s64 offset = extendSign(extract<BITS(0:25)>(inst), 26, 64) * InstructionWidth;
+
+                if (generic == &Core::BL)
+                    builder.write(30, builder.constant(pc + InstructionWidth), false);
+                builder.emit(ir::Opcode::Exit, 64, 0, std::nullopt, pc + offset);
+            } else if (generic == &Core::B_COND) {
+                const s64 offset = extendSign(extract<BITS(5:23)>(inst), 19, 64) * InstructionWidth;
+
+                builder.emit(ir::Opcode::ExitConditional, 64, builder.emit(ir::Opcode::GetFlags), std::nullopt, pc + offset, extract<BITS(0:3)>(inst));
+            } else if (generic == &Core::CBZ || generic == &Core::CBNZ) {
+                const s64 offset = extendSign(extract<BITS(5:23)>(inst), 19, 64) * InstructionWidth;
+
+                builder.emit(generic == &Core::CBZ ? ir::Opcode::ExitZero : ir::Opcode::ExitNotZero, width, builder.read(Rd, false), std::nullopt, pc + offset);
+            } else {
+                builder.emit(ir::Opcode::Call, 64, 0, std::nullopt, i);
+                calls++;
+            }
+        }
+
+        // Calls leave PC pointing past their instruction already, anything else has to set it explicitly
+        const auto last = result.instructions.back().opcode;
+        if (!ir::isExit(last) && last != ir::Opcode::Call)
+            builder.emit(ir::Opcode::Exit, 64, 0, std::nullopt, address + block.instructions.size() * InstructionWidth);
+
+        if (calls * 2 > block.instructions.size() || result.instructions.size() > ir::MaxInstructions)
+            return std::nullopt;
+
+        ir::optimize(result);
+
+        // Not worth the setup if it neither gets rid of any dispatches nor is a loop that can repeat itself
+        const bool loops = std::ranges::any_of(result.instructions, [&](const ir::Instruction &instruction) {
+            return ir::isExit(instruction.opcode) && instruction.imm == address;
+        });
+        if (!loops && result.instructions.size() >= block.instructions.size())
+            return std::nullopt;
+
+        return result;
+    }
+
+    void Core::executeIrBlock(const TranslationBlock &block) {
+        const ir::Block &ir = *block.ir;
+        u64 retired = this->m_retiredInstructions;
+        const addr_t nextBlock = ir.address + ir.guestInstructions * InstructionWidth;
+
+        std::array<u64, ir::MaxInstructions> values;
+        std::ranges::copy(ir.constants, values.begin());
+        u64 *inputs = values.data() + ir.constants.size();
+        u64 *results = inputs + ir.inputs.size();
+
+        // Faults and handlers see the same PC and retired instruction count they would when running instruction by instruction
+        const auto synchronize = [&](const ir::Instruction &instruction) {
+            PC.X = ir.address + (instruction.guest + 1) * InstructionWidth;
+            this->m_retiredInstructions = retired + instruction.guest;
+        };
+
+        while (true) {
+            for (u16 i = 0; i < ir.inputs.size(); i++)
+                inputs[i] = (ir.inputs[i] == ir::StackPointer ? GPSP(31) : GPR.direct(ir.inputs[i])).X;
+
+            for (u16 i = 0; i < ir.instructions.size(); i++) {
+                const auto &instruction = ir.instructions[i];
+
+                switch (instruction.opcode) {
+                    // Spelled out one by one so each case gets its own copy of evaluate() with the opcode known
+                    case ir::Opcode::Add:        results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::Sub:        results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::And:        results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::Or:         results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::Xor:        results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::Shl:        results[i] = ir::evaluate(instruction, values[instruction.a], 0); break;
+                    case ir::Opcode::Lsr:        results[i] = ir::evaluate(instruction, values[instruction.a], 0); break;
+                    case ir::Opcode::Asr:        results[i] = ir::evaluate(instruction, values[instruction.a], 0); break;
+                    case ir::Opcode::Ror:        results[i] = ir::evaluate(instruction, values[instruction.a], 0); break;
+                    case ir::Opcode::AddFlags:   results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::SubFlags:   results[i] = ir::evaluate(instruction, values[instruction.a], values[instruction.b]); break;
+                    case ir::Opcode::LogicFlags: results[i] = ir::evaluate(instruction, values[instruction.a], 0); break;
+                    case ir::Opcode::GetRegister:
+                        results[i] = (instruction.reg == ir::StackPointer ? GPSP(31) : GPR.direct(instruction.reg)).X;
+                        break;
+                    case ir::Opcode::GetFlags:
+                        results[i] = PSTATE.N << 3 | PSTATE.Z << 2 | PSTATE.C << 1 | PSTATE.V;
+                        break;
+                    case ir::Opcode::WriteBack:
+                        for (const auto &write : std::span(ir.writes).subspan(instruction.a, instruction.b)) {
+                            const u64 value = values[write.value];
+
+                            if (write.reg == ir::Flags) {
+                                PSTATE.N = (value & ir::FlagN) != 0;
+                                PSTATE.Z = (value & ir::FlagZ) != 0;
+                                PSTATE.C = (value & ir::FlagC) != 0;
+                                PSTATE.V = (value & ir::FlagV) != 0;
+                            } else {
+                                (write.reg == ir::StackPointer ? GPSP(31) : GPR.direct(write.reg)).X = value;
+                            }
+                        }
+                        break;
+                    case ir::Opcode::Load:
+                        synchronize(instruction);
+                        results[i] = this->readMemory(values[instruction.a], instruction.width);
+                        break;
+                    case ir::Opcode::Store:
+                        synchronize(instruction);
+                        this->writeMemory(values[instruction.a], instruction.width, values[instruction.b]);
+                        break;
+                    case ir::Opcode::Call: {
+                        const auto &decoded = block.instructions[instruction.imm];
+
+                        synchronize(instruction);
+                        this->m_currInstructionIndex = decoded.patternIndex;
+                        this->execute(decoded.handler, decoded.instruction);
+
+                        // Handlers that halt, branch or take an exception end the block right there
+                        if (this->m_halted || PC.X != ir.address + (instruction.guest + 1) * InstructionWidth) {
+                            this->m_retiredInstructions = retired + instruction.guest + 1;
+                            return;
+                        }
+                        break;
+                    }
+                    case ir::Opcode::Exit:
+                        PC.X = instruction.imm;
+                        break;
+                    case ir::Opcode::ExitConditional:
+                        PC.X = ir::conditionHolds(instruction.reg, values[instruction.a]) ? instruction.imm : nextBlock;
+                        break;
+                    case ir::Opcode::ExitZero:
+                    case ir::Opcode::ExitNotZero: {
+                        const bool zero = (instruction.width == 64 ? values[instruction.a] : u32(values[instruction.a])) == 0;
+
+                        PC.X = zero == (instruction.opcode == ir::Opcode::ExitZero) ? instruction.imm : nextBlock;
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+
+            this->m_retiredInstructions = retired + ir.guestInstructions;
+
+            // Loops branching back to their own start keep going right here instead of taking a round trip through tick()
+            if (PC.X != ir.address || !this->canRepeatBlock(ir.guestInstructions))
+                return;
+
+            retired = this->m_retiredInstructions;
+        }
+    }
+
+    bool Core::canRepeatBlock(size_t blockLength) const {
+        // Only while run() is driving the core, anything ticking it directly expects a single block per tick
+        if (this->m_deadline == std::numeric_limits<vtime_t>::max() || this->getVirtualTime() + blockLength > this->m_deadline)
+            return false;
+
+        return !this->m_halted && !this->m_waiting && !this->m_broken &&
+               !this->m_translationInvalidationsPending.load(std::memory_order_acquire) &&
+               !this->m_blockInvalidationsPending.load(std::memory_order_acquire) &&
+               !this->m_interruptPending.load(std::memory_order_acquire);
+    }
+
+}
@@ -0,0 +1,2163 @@
+#include "core.hpp"
+
+#include <bit>
+#include <cfenv>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+
+// SSE2 is part of the build's baseline, newer extensions are compiled in regardless of the build flags and only used if the CPU
+// has them. Everything without a host instruction falls back to per lane loops
+#if defined(__SSE2__) || defined(_M_X64)
+    #define HOST_SSE2
+    #include <immintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define HOST_TARGET(features)
+    #else
+        #include <cpuid.h>
+        #define HOST_TARGET(features) __attribute__((target(features)))
+    #endif
+#endif
+
+namespace arm {
+
+    namespace {
+
+        using core::VectorRegister;
+
+        struct HostFeatures {
+            bool ssse3 = false;
+            bool sse41 = false;
+            bool sse42 = false;
+            bool fma = false;
+        };
+
+        HostFeatures detectHostFeatures() {
+            HostFeatures features;
+
+#if defined(HOST_SSE2)
+            u32 leaf1[4] = { 0 };
+    #if defined(_MSC_VER)
+            __cpuidex(reinterpret_cast<int*>(leaf1), 1, 0);
+    #else
+            __get_cpuid_count(1, 0, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+    #endif
+
+            features.ssse3 = leaf1[2] & (1 << 9);
+            features.sse41 = leaf1[2] & (1 << 19);
+            features.sse42 = leaf1[2] & (1 << 20);
+
+            // FMA works on the AVX register state, which the OS has to save as well
+            const bool fma = leaf1[2] & (1 << 12), osxsave = leaf1[2] & (1 << 27), avx = leaf1[2] & (1 << 28);
+            if (fma && osxsave && avx) {
+    #if defined(_MSC_VER)
+                const u64 xcr0 = _xgetbv(0);
+    #else
+                u32 xcr0Low, xcr0High;
+                __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+                const u64 xcr0 = u64(xcr0High) << 32 | xcr0Low;
+    #endif
+                features.fma = (xcr0 & 0b110) == 0b110;
+            }
+#endif
+
+            return features;
+        }
+
+        // Queried once while the emulator starts up
+        const HostFeatures hostFeatures = detectHostFeatures();
+
+        template<typename T>
+        using Bits = std::conditional_t<sizeof(T) == 1, u8, std::conditional_t<sizeof(T) == 2, u16, std::conditional_t<sizeof(T) == 4, u32, u64>>>;
+
+        template<typename T> struct WideType;
+        template<> struct WideType<u8>  { using type = u16; };
+        template<> struct WideType<u16> { using type = u32; };
+        template<> struct WideType<u32> { using type = u64; };
+        template<> struct WideType<u64> { using type = u64; };
+        template<> struct WideType<s8>  { using type = s16; };
+        template<> struct WideType<s16> { using type = s32; };
+        template<> struct WideType<s32> { using type = s64; };
+        template<> struct WideType<s64> { using type = s64; };
+
+        template<typename T>
+        using Wide = typename WideType<T>::type;
+
+        template<typename T>
+        T getLane(const VectorRegister &reg, u8 index) {
+            T value;
+            std::memcpy(&value, &reg.B[index * sizeof(T)], sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        void setLane(VectorRegister &reg, u8 index, T value) {
+            std::memcpy(&reg.B[index * sizeof(T)], &value, sizeof(T));
+        }
+
+        template<typename T>
+        constexpr u8 laneCount(bool Q) {
+            return (Q ? 16 : 8) / sizeof(T);
+        }
+
+        // 64 bit operations always leave the upper half of the destination cleared
+        void assign(VectorRegister &destination, VectorRegister value, bool Q) {
+            if (!Q)
+                value.D[1] = 0;
+
+            destination = value;
+        }
+
+        // Calls op with T set to the element type selected by a size field
+        template<bool Signed, typename Op>
+        void forElementSize(u8 size, Op &&op) {
+            switch (size) {
+                case 0:  op.template operator()<std::conditional_t<Signed, s8, u8>>();   break;
+                case 1:  op.template operator()<std::conditional_t<Signed, s16, u16>>(); break;
+                case 2:  op.template operator()<std::conditional_t<Signed, s32, u32>>(); break;
+                default: op.template operator()<std::conditional_t<Signed, s64, u64>>(); break;
+            }
+        }
+
+        template<typename Op>
+        void forElementSize(u8 size, bool isSigned, Op &&op) {
+            if (isSigned)
+                forElementSize<true>(size, op);
+            else
+                forElementSize<false>(size, op);
+        }
+
+        template<typename Op>
+        void forFloatSize(bool doublePrecision, Op &&op) {
+            if (doublePrecision)
+                op.template operator()<double>();
+            else
+                op.template operator()<float>();
+        }
+
+        template<typename T, typename Op>
+        VectorRegister mapLanes(const VectorRegister &a, Op op) {
+            VectorRegister result;
+            for (u8 i = 0; i < 16 / sizeof(T); i++)
+                setLane<T>(result, i, op(getLane<T>(a, i)));
+
+            return result;
+        }
+
+        template<typename T, typename Op>
+        VectorRegister mapLanes(const VectorRegister &a, const VectorRegister &b, Op op) {
+            VectorRegister result;
+            for (u8 i = 0; i < 16 / sizeof(T); i++)
+                setLane<T>(result, i, op(getLane<T>(a, i), getLane<T>(b, i)));
+
+            return result;
+        }
+
+        // Comparisons set all bits of a lane if they hold
+        template<typename T, typename Op>
+        VectorRegister compareLanes(const VectorRegister &a, const VectorRegister &b, Op op) {
+            VectorRegister result;
+            for (u8 i = 0; i < 16 / sizeof(T); i++)
+                setLane<Bits<T>>(result, i, op(getLane<T>(a, i), getLane<T>(b, i)) ? Bits<T>(~Bits<T>(0)) : Bits<T>(0));
+
+            return result;
+        }
+
+        // Pairs of adjacent lanes of the concatenation of a and b get combined
+        template<typename T, typename Op>
+        VectorRegister pairwiseLanes(const VectorRegister &a, const VectorRegister &b, bool Q, Op op) {
+            const u8 half = laneCount<T>(Q) / 2;
+
+            VectorRegister result;
+            for (u8 i = 0; i < half; i++) {
+                setLane<T>(result, i, op(getLane<T>(a, 2 * i), getLane<T>(a, 2 * i + 1)));
+                setLane<T>(result, half + i, op(getLane<T>(b, 2 * i), getLane<T>(b, 2 * i + 1)));
+            }
+
+            return result;
+        }
+
+        VectorRegister duplicate(u64 value, u8 size) {
+            VectorRegister result;
+            forElementSize<false>(size, [&]<typename T>() {
+                for (u8 i = 0; i < 16 / sizeof(T); i++)
+                    setLane<T>(result, i, T(value));
+            });
+
+            return result;
+        }
+
+        template<typename T>
+        T saturatingAdd(T a, T b) {
+            if constexpr (std::is_unsigned_v<T>) {
+                const T result = a + b;
+                return result < a ? std::numeric_limits<T>::max() : result;
+            } else {
+                const T result = T(std::make_unsigned_t<T>(a) + std::make_unsigned_t<T>(b));
+                if (((a ^ result) & (b ^ result)) < 0)
+                    return a < 0 ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+                return result;
+            }
+        }
+
+        template<typename T>
+        T saturatingSub(T a, T b) {
+            if constexpr (std::is_unsigned_v<T>) {
+                return a < b ? T(0) : T(a - b);
+            } else {
+                const T result = T(std::make_unsigned_t<T>(a) - std::make_unsigned_t<T>(b));
+                if (((a ^ b) & (a ^ result)) < 0)
+                    return a < 0 ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+                return result;
+            }
+        }
+
+        // SSHL / USHL take a signed shift amount from the bottom byte of each lane, negative values shift right
+        template<typename T>
+        T shiftByRegister(T value, s8 amount) {
+            constexpr int Width = sizeof(T) * 8;
+
+            if (amount >= 0)
+                return amount >= Width ? T(0) : T(std::make_unsigned_t<T>(value) << amount);
+            if (-amount >= Width)
+                return (std::is_signed_v<T> && value < 0) ? T(-1) : T(0);
+
+            return T(value >> -amount);
+        }
+
+        template<typename T>
+        constexpr Bits<T> QuietBit = Bits<T>(1) << (std::numeric_limits<T>::digits - 2);
+
+        template<typename T>
+        bool isSignalingNaN(T value) {
+            return std::isnan(value) && (std::bit_cast<Bits<T>>(value) & QuietBit<T>) == 0;
+        }
+
+        // NaN results follow the architecture instead of the host: the first signaling NaN operand wins over the first quiet one,
+        // NaNs an operation created itself are the positive default NaN, and FPCR.DN turns every NaN into the default NaN
+        template<typename T>
+        T processNaNs(T result, std::initializer_list<T> operands, bool defaultNaN) {
+            if (!std::isnan(result)) [[likely]]
+                return result;
+
+            if (!defaultNaN) {
+                for (const T operand : operands) {
+                    if (isSignalingNaN(operand))
+                        return std::bit_cast<T>(Bits<T>(std::bit_cast<Bits<T>>(operand) | QuietBit<T>));
+                }
+                for (const T operand : operands) {
+                    if (std::isnan(operand))
+                        return operand;
+                }
+            }
+
+            return std::numeric_limits<T>::quiet_NaN();
+        }
+
+        // The addend is the first operand when picking a NaN, and a quiet NaN addend doesn't hide an infinity times zero product
+        template<typename T>
+        T fusedMultiplyAdd(T addend, T a, T b, bool defaultNaN) {
+            if (std::isnan(addend) && !isSignalingNaN(addend) && ((std::isinf(a) && b == 0) || (a == 0 && std::isinf(b)))) {
+                std::feraiseexcept(FE_INVALID);
+                return std::numeric_limits<T>::quiet_NaN();
+            }
+
+            return processNaNs(std::fma(a, b, addend), { addend, a, b }, defaultNaN);
+        }
+
+        // Lets two operand lane operations be used with mapLanes and pairwiseLanes while handling NaNs like processNaNs
+        template<typename T, typename F>
+        auto withNaNHandling(F operation, bool defaultNaN) {
+            return [operation, defaultNaN](T x, T y) { return processNaNs(T(operation(x, y)), { x, y }, defaultNaN); };
+        }
+
+        // Only the FPCR independent parts of FMAX / FMIN: NaNs propagate and +0 is larger than -0
+        template<typename T>
+        T floatMax(T a, T b) {
+            if (std::isnan(a) || std::isnan(b))
+                return a + b;
+            if (a == 0 && b == 0)
+                return std::signbit(a) ? b : a;
+
+            return a > b ? a : b;
+        }
+
+        template<typename T>
+        T floatMin(T a, T b) {
+            if (std::isnan(a) || std::isnan(b))
+                return a + b;
+            if (a == 0 && b == 0)
+                return std::signbit(a) ? a : b;
+
+            return a < b ? a : b;
+        }
+
+        // FMAXNM / FMINNM prefer a number over a quiet NaN, signaling NaNs still propagate
+        template<typename T>
+        T floatMaxNumber(T a, T b) {
+            if (std::isnan(a) != std::isnan(b) && !isSignalingNaN(a) && !isSignalingNaN(b))
+                return std::isnan(a) ? b : a;
+
+            return floatMax(a, b);
+        }
+
+        template<typename T>
+        T floatMinNumber(T a, T b) {
+            if (std::isnan(a) != std::isnan(b) && !isSignalingNaN(a) && !isSignalingNaN(b))
+                return std::isnan(a) ? b : a;
+
+            return floatMin(a, b);
+        }
+
+        // The first four match the FPCR.RMode and FRINT encodings
+        enum class Rounding : u8 {
+            TieEven         = 0b000,
+            PlusInfinity    = 0b001,
+            MinusInfinity   = 0b010,
+            Zero            = 0b011,
+            TieAway         = 0b100,
+            Current         = 0b111
+        };
+
+        template<typename T>
+        T roundToIntegral(T value, Rounding rounding) {
+            switch (rounding) {
+                case Rounding::TieEven:
+                    // std::round breaks ties away from zero, halving first moves them onto an even result
+                    if (std::fabs(value - std::trunc(value)) == T(0.5))
+                        return 2 * std::round(value / 2);
+                    return std::round(value);
+                case Rounding::PlusInfinity:    return std::ceil(value);
+                case Rounding::MinusInfinity:   return std::floor(value);
+                case Rounding::Zero:            return std::trunc(value);
+                case Rounding::TieAway:         return std::round(value);
+                default:                        return std::nearbyint(value);
+            }
+        }
+
+        // Out of range values saturate and NaN turns into 0, both are invalid operations
+        template<typename I, typename F>
+        I convertToInteger(F value, Rounding rounding) {
+            if (std::isnan(value)) {
+                std::feraiseexcept(FE_INVALID);
+                return 0;
+            }
+
+            const F rounded = roundToIntegral(value, rounding);
+            if (rounded < F(std::numeric_limits<I>::min())) {
+                std::feraiseexcept(FE_INVALID);
+                return std::numeric_limits<I>::min();
+            }
+
+            // The largest integer turns into the next power of two when it doesn't fit into the mantissa
+            const F largest = F(std::numeric_limits<I>::max());
+            if (sizeof(I) * 8 > std::numeric_limits<F>::digits ? rounded >= largest : rounded > largest) {
+                std::feraiseexcept(FE_INVALID);
+                return std::numeric_limits<I>::max();
+            }
+
+            if (rounded != value)
+                std::feraiseexcept(FE_INEXACT);
+
+            return I(rounded);
+        }
+
+        template<typename T>
+        u8 compareFloats(T a, T b, bool signaling) {
+            if (std::isunordered(a, b)) {
+                if (signaling || isSignalingNaN(a) || isSignalingNaN(b))
+                    std::feraiseexcept(FE_INVALID);
+                return 0b0011;
+            }
+
+            if (a == b)
+                return 0b0110;
+
+            return a < b ? 0b1000 : 0b0010;
+        }
+
+        u8 polynomialMultiply(u8 a, u8 b) {
+            u8 result = 0;
+            for (u8 bit = 0; bit < 8; bit++) {
+                if (b & (1 << bit))
+                    result ^= a << bit;
+            }
+
+            return result;
+        }
+
+#if defined(HOST_SSE2)
+        __m128i load(const VectorRegister &reg) {
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(reg.B));
+        }
+
+        VectorRegister store(__m128i value) {
+            VectorRegister result;
+            _mm_store_si128(reinterpret_cast<__m128i*>(result.B), value);
+            return result;
+        }
+
+        __m128 loadFloat(const VectorRegister &reg) {
+            return _mm_load_ps(reg.F32);
+        }
+
+        VectorRegister store(__m128 value) {
+            VectorRegister result;
+            _mm_store_ps(result.F32, value);
+            return result;
+        }
+
+        __m128d loadDouble(const VectorRegister &reg) {
+            return _mm_load_pd(reg.F64);
+        }
+
+        VectorRegister store(__m128d value) {
+            VectorRegister result;
+            _mm_store_pd(result.F64, value);
+            return result;
+        }
+
+        // SSE only compares signed integers, flipping the sign bits turns that into an unsigned comparison
+        __m128i signBias(u8 size) {
+            switch (size) {
+                case 0:  return _mm_set1_epi8(s8(0x80));
+                case 1:  return _mm_set1_epi16(s16(0x8000));
+                case 2:  return _mm_set1_epi32(s32(0x8000'0000));
+                default: return _mm_set1_epi64x(s64(0x8000'0000'0000'0000));
+            }
+        }
+
+        HOST_TARGET("sse4.1")
+        __m128i multiplyLow32(__m128i a, __m128i b) {
+            return _mm_mullo_epi32(a, b);
+        }
+
+        HOST_TARGET("sse4.1")
+        __m128i compareEqual64(__m128i a, __m128i b) {
+            return _mm_cmpeq_epi64(a, b);
+        }
+
+        HOST_TARGET("sse4.2")
+        __m128i compareGreater64(__m128i a, __m128i b) {
+            return _mm_cmpgt_epi64(a, b);
+        }
+
+        // The byte, 32 bit and remaining 16 bit forms SSE2 doesn't have
+        HOST_TARGET("sse4.1")
+        __m128i minMax(__m128i a, __m128i b, u8 size, bool isUnsigned, bool maximum) {
+            if (size == 0)
+                return maximum ? _mm_max_epi8(a, b) : _mm_min_epi8(a, b);
+            if (size == 1)
+                return maximum ? _mm_max_epu16(a, b) : _mm_min_epu16(a, b);
+            if (isUnsigned)
+                return maximum ? _mm_max_epu32(a, b) : _mm_min_epu32(a, b);
+            else
+                return maximum ? _mm_max_epi32(a, b) : _mm_min_epi32(a, b);
+        }
+#endif
+
+        VectorRegister vectorAnd(const VectorRegister &a, const VectorRegister &b) {
+#if defined(HOST_SSE2)
+            return store(_mm_and_si128(load(a), load(b)));
+#else
+            return mapLanes<u64>(a, b, [](u64 x, u64 y) { return x & y; });
+#endif
+        }
+
+        VectorRegister vectorOr(const VectorRegister &a, const VectorRegister &b) {
+#if defined(HOST_SSE2)
+            return store(_mm_or_si128(load(a), load(b)));
+#else
+            return mapLanes<u64>(a, b, [](u64 x, u64 y) { return x | y; });
+#endif
+        }
+
+        VectorRegister vectorXor(const VectorRegister &a, const VectorRegister &b) {
+#if defined(HOST_SSE2)
+            return store(_mm_xor_si128(load(a), load(b)));
+#else
+            return mapLanes<u64>(a, b, [](u64 x, u64 y) { return x ^ y; });
+#endif
+        }
+
+        // a & ~b
+        VectorRegister vectorAndNot(const VectorRegister &a, const VectorRegister &b) {
+#if defined(HOST_SSE2)
+            return store(_mm_andnot_si128(load(b), load(a)));
+#else
+            return mapLanes<u64>(a, b, [](u64 x, u64 y) { return x & ~y; });
+#endif
+        }
+
+        VectorRegister vectorNot(const VectorRegister &a) {
+#if defined(HOST_SSE2)
+            return store(_mm_xor_si128(load(a), _mm_set1_epi32(-1)));
+#else
+            return mapLanes<u64>(a, [](u64 x) { return ~x; });
+#endif
+        }
+
+        VectorRegister vectorAdd(const VectorRegister &a, const VectorRegister &b, u8 size) {
+#if defined(HOST_SSE2)
+            switch (size) {
+                case 0:  return store(_mm_add_epi8(load(a), load(b)));
+                case 1:  return store(_mm_add_epi16(load(a), load(b)));
+                case 2:  return store(_mm_add_epi32(load(a), load(b)));
+                default: return store(_mm_add_epi64(load(a), load(b)));
+            }
+#else
+            VectorRegister result;
+            forElementSize<false>(size, [&]<typename T>() { result = mapLanes<T>(a, b, [](T x, T y) { return T(x + y); }); });
+            return result;
+#endif
+        }
+
+        VectorRegister vectorSub(const VectorRegister &a, const VectorRegister &b, u8 size) {
+#if defined(HOST_SSE2)
+            switch (size) {
+                case 0:  return store(_mm_sub_epi8(load(a), load(b)));
+                case 1:  return store(_mm_sub_epi16(load(a), load(b)));
+                case 2:  return store(_mm_sub_epi32(load(a), load(b)));
+                default: return store(_mm_sub_epi64(load(a), load(b)));
+            }
+#else
+            VectorRegister result;
+            forElementSize<false>(size, [&]<typename T>() { result = mapLanes<T>(a, b, [](T x, T y) { return T(x - y); }); });
+            return result;
+#endif
+        }
+
+        VectorRegister vectorMultiply(const VectorRegister &a, const VectorRegister &b, u8 size) {
+#if defined(HOST_SSE2)
+            if (size == 1)
+                return store(_mm_mullo_epi16(load(a), load(b)));
+            if (size == 2 && hostFeatures.sse41)
+                return store(multiplyLow32(load(a), load(b)));
+#endif
+
+            VectorRegister result;
+            forElementSize<false>(size, [&]<typename T>() { result = mapLanes<T>(a, b, [](T x, T y) { return T(x * y); }); });
+            return result;
+        }
+
+        VectorRegister compareEqual(const VectorRegister &a, const VectorRegister &b, u8 size) {
+#if defined(HOST_SSE2)
+            switch (size) {
+                case 0:  return store(_mm_cmpeq_epi8(load(a), load(b)));
+                case 1:  return store(_mm_cmpeq_epi16(load(a), load(b)));
+                case 2:  return store(_mm_cmpeq_epi32(load(a), load(b)));
+                default: {
+                    if (hostFeatures.sse41)
+                        return store(compareEqual64(load(a), load(b)));
+
+                    // Both 32 bit halves have to match
+                    const __m128i equal = _mm_cmpeq_epi32(load(a), load(b));
+                    return store(_mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1))));
+                }
+            }
+#else
+            VectorRegister result;
+            forElementSize<false>(size, [&]<typename T>() { result = compareLanes<T>(a, b, [](T x, T y) { return x == y; }); });
+            return result;
+#endif
+        }
+
+        VectorRegister compareGreater(const VectorRegister &a, const VectorRegister &b, u8 size, bool isUnsigned) {
+#if defined(HOST_SSE2)
+            if (size < 3 || hostFeatures.sse42) {
+                __m128i x = load(a), y = load(b);
+                if (isUnsigned) {
+                    x = _mm_xor_si128(x, signBias(size));
+                    y = _mm_xor_si128(y, signBias(size));
+                }
+
+                switch (size) {
+                    case 0:  return store(_mm_cmpgt_epi8(x, y));
+                    case 1:  return store(_mm_cmpgt_epi16(x, y));
+                    case 2:  return store(_mm_cmpgt_epi32(x, y));
+                    default: return store(compareGreater64(x, y));
+                }
+            }
+#endif
+
+            VectorRegister result;
+            forElementSize(size, !isUnsigned, [&]<typename T>() { result = compareLanes<T>(a, b, [](T x, T y) { return x > y; }); });
+            return result;
+        }
+
+        VectorRegister vectorMinMax(const VectorRegister &a, const VectorRegister &b, u8 size, bool isUnsigned, bool maximum) {
+#if defined(HOST_SSE2)
+            if (size == 0 && isUnsigned)
+                return store(maximum ? _mm_max_epu8(load(a), load(b)) : _mm_min_epu8(load(a), load(b)));
+            if (size == 1 && !isUnsigned)
+                return store(maximum ? _mm_max_epi16(load(a), load(b)) : _mm_min_epi16(load(a), load(b)));
+            if (size < 3 && hostFeatures.sse41)
+                return store(minMax(load(a), load(b), size, isUnsigned, maximum));
+#endif
+
+            // Nothing has 64 bit minimum or maximum, picking by a comparison still stays in vector registers
+            if (size == 3) {
+                const VectorRegister greater = compareGreater(a, b, size, isUnsigned);
+                return maximum ? vectorOr(vectorAnd(greater, a), vectorAndNot(b, greater))
+                               : vectorOr(vectorAnd(greater, b), vectorAndNot(a, greater));
+            }
+
+            VectorRegister result;
+            forElementSize(size, !isUnsigned, [&]<typename T>() {
+                result = mapLanes<T>(a, b, [maximum](T x, T y) { return maximum ? std::max(x, y) : std::min(x, y); });
+            });
+            return result;
+        }
+
+        VectorRegister vectorSaturating(const VectorRegister &a, const VectorRegister &b, u8 size, bool isUnsigned, bool subtract) {
+#if defined(HOST_SSE2)
+            const __m128i x = load(a), y = load(b);
+            if (size == 0 && isUnsigned)
+                return store(subtract ? _mm_subs_epu8(x, y) : _mm_adds_epu8(x, y));
+            if (size == 0 && !isUnsigned)
+                return store(subtract ? _mm_subs_epi8(x, y) : _mm_adds_epi8(x, y));
+            if (size == 1 && isUnsigned)
+                return store(subtract ? _mm_subs_epu16(x, y) : _mm_adds_epu16(x, y));
+            if (size == 1 && !isUnsigned)
+                return store(subtract ? _mm_subs_epi16(x, y) : _mm_adds_epi16(x, y));
+#endif
+
+            VectorRegister result;
+            forElementSize(size, !isUnsigned, [&]<typename T>() {
+                result = mapLanes<T>(a, b, [subtract](T x, T y) { return subtract ? saturatingSub(x, y) : saturatingAdd(x, y); });
+            });
+            return result;
+        }
+
+        VectorRegister shiftLeft(const VectorRegister &a, u8 size, u8 amount) {
+#if defined(HOST_SSE2)
+            const __m128i count = _mm_cvtsi32_si128(amount);
+            switch (size) {
+                case 0:  return store(_mm_and_si128(_mm_sll_epi16(load(a), count), _mm_set1_epi8(s8(u8(0xFF << amount)))));
+                case 1:  return store(_mm_sll_epi16(load(a), count));
+                case 2:  return store(_mm_sll_epi32(load(a), count));
+                default: return store(_mm_sll_epi64(load(a), count));
+            }
+#else
+            VectorRegister result;
+            forElementSize<false>(size, [&]<typename T>() { result = mapLanes<T>(a, [amount](T x) { return shiftByRegister<T>(x, amount); }); });
+            return result;
+#endif
+        }
+
+        VectorRegister shiftRight(const VectorRegister &a, u8 size, u8 amount, bool isUnsigned) {
+#if defined(HOST_SSE2)
+            const __m128i count = _mm_cvtsi32_si128(amount);
+            if (isUnsigned) {
+                switch (size) {
+                    case 0:  return store(_mm_and_si128(_mm_srl_epi16(load(a), count), _mm_set1_epi8(s8(u8(0xFF >> std::min<u8>(amount, 8))))));
+                    case 1:  return store(_mm_srl_epi16(load(a), count));
+                    case 2:  return store(_mm_srl_epi32(load(a), count));
+                    default: return store(_mm_srl_epi64(load(a), count));
+                }
+            }
+
+            switch (size) {
+                case 0: {
+                    // Each byte gets shifted as the upper half of a 16 bit lane, the low ones moved up there first
+                    const __m128i byteCount = _mm_cvtsi32_si128(std::min<u8>(amount, 8));
+                    const __m128i low = _mm_srli_epi16(_mm_sra_epi16(_mm_slli_epi16(load(a), 8), byteCount), 8);
+                    const __m128i high = _mm_and_si128(_mm_sra_epi16(load(a), byteCount), _mm_set1_epi16(s16(0xFF00)));
+                    return store(_mm_or_si128(low, high));
+                }
+                case 1:  return store(_mm_sra_epi16(load(a), count));
+                case 2:  return store(_mm_sra_epi32(load(a), count));
+                default: {
+                    // Logical shift with the sign shifted in from the top
+                    const u8 clamped = std::min<u8>(amount, 64);
+                    const __m128i sign = _mm_shuffle_epi32(_mm_srai_epi32(load(a), 31), _MM_SHUFFLE(3, 3, 1, 1));
+                    return store(_mm_or_si128(_mm_srl_epi64(load(a), _mm_cvtsi32_si128(clamped)), _mm_sll_epi64(sign, _mm_cvtsi32_si128(64 - clamped))));
+                }
+            }
+#endif
+
+            VectorRegister result;
+            forElementSize(size, !isUnsigned, [&]<typename T>() { result = mapLanes<T>(a, [amount](T x) { return shiftByRegister<T>(x, -s8(amount)); }); });
+            return result;
+        }
+
+#if defined(HOST_SSE2)
+        bool containsNaN(const VectorRegister &value, bool doublePrecision) {
+            if (doublePrecision) {
+                const __m128d x = loadDouble(value);
+                return _mm_movemask_pd(_mm_cmpunord_pd(x, x)) != 0;
+            } else {
+                const __m128 x = loadFloat(value);
+                return _mm_movemask_ps(_mm_cmpunord_ps(x, x)) != 0;
+            }
+        }
+#endif
+
+        template<typename T>
+        T floatOperation(T x, T y, char operation) {
+            switch (operation) {
+                case '+': return x + y;
+                case '-': return x - y;
+                case '*': return x * y;
+                default:  return x / y;
+            }
+        }
+
+        // The host's SIMD results are only used when no lane is NaN, the rare rest gets redone lane by lane to pick the right NaN
+        VectorRegister floatArithmetic(const VectorRegister &a, const VectorRegister &b, bool doublePrecision, char operation, bool defaultNaN) {
+#if defined(HOST_SSE2)
+            VectorRegister result;
+            if (doublePrecision) {
+                const __m128d x = loadDouble(a), y = loadDouble(b);
+                switch (operation) {
+                    case '+': result = store(_mm_add_pd(x, y)); break;
+                    case '-': result = store(_mm_sub_pd(x, y)); break;
+                    case '*': result = store(_mm_mul_pd(x, y)); break;
+                    default:  result = store(_mm_div_pd(x, y)); break;
+                }
+            } else {
+                const __m128 x = loadFloat(a), y = loadFloat(b);
+                switch (operation) {
+                    case '+': result = store(_mm_add_ps(x, y)); break;
+                    case '-': result = store(_mm_sub_ps(x, y)); break;
+                    case '*': result = store(_mm_mul_ps(x, y)); break;
+                    default:  result = store(_mm_div_ps(x, y)); break;
+                }
+            }
+
+            if (!containsNaN(result, doublePrecision)) [[likely]]
+                return result;
+#else
+            VectorRegister result;
+#endif
+
+            forFloatSize(doublePrecision, [&]<typename T>() {
+                result = mapLanes<T>(a, b, withNaNHandling<T>([operation](T x, T y) { return floatOperation(x, y, operation); }, defaultNaN));
+            });
+            return result;
+        }
+
+#if defined(HOST_SSE2)
+        HOST_TARGET("fma")
+        VectorRegister hostFloatMultiplyAdd(const VectorRegister &accumulator, const VectorRegister &a, const VectorRegister &b, bool doublePrecision, bool subtract) {
+            if (doublePrecision)
+                return store(subtract ? _mm_fnmadd_pd(loadDouble(a), loadDouble(b), loadDouble(accumulator)) : _mm_fmadd_pd(loadDouble(a), loadDouble(b), loadDouble(accumulator)));
+            else
+                return store(subtract ? _mm_fnmadd_ps(loadFloat(a), loadFloat(b), loadFloat(accumulator)) : _mm_fmadd_ps(loadFloat(a), loadFloat(b), loadFloat(accumulator)));
+        }
+#endif
+
+        // FMLA / FMLS round only once, so they need a real fused multiply-add
+        VectorRegister floatMultiplyAdd(const VectorRegister &accumulator, const VectorRegister &a, const VectorRegister &b, bool doublePrecision, bool subtract, bool defaultNaN) {
+#if defined(HOST_SSE2)
+            if (hostFeatures.fma) {
+                const VectorRegister result = hostFloatMultiplyAdd(accumulator, a, b, doublePrecision, subtract);
+                if (!containsNaN(result, doublePrecision)) [[likely]]
+                    return result;
+            }
+#endif
+
+            VectorRegister result;
+            forFloatSize(doublePrecision, [&]<typename T>() {
+                for (u8 i = 0; i < 16 / sizeof(T); i++)
+                    setLane<T>(result, i, fusedMultiplyAdd(getLane<T>(accumulator, i), subtract ? -getLane<T>(a, i) : getLane<T>(a, i), getLane<T>(b, i), defaultNaN));
+            });
+            return result;
+        }
+
+        VectorRegister floatSquareRoot(const VectorRegister &a, bool doublePrecision, bool defaultNaN) {
+#if defined(HOST_SSE2)
+            const VectorRegister host = doublePrecision ? store(_mm_sqrt_pd(loadDouble(a))) : store(_mm_sqrt_ps(loadFloat(a)));
+            if (!containsNaN(host, doublePrecision)) [[likely]]
+                return host;
+#endif
+
+            VectorRegister result;
+            forFloatSize(doublePrecision, [&]<typename T>() { result = mapLanes<T>(a, [defaultNaN](T x) { return processNaNs(std::sqrt(x), { x }, defaultNaN); }); });
+            return result;
+        }
+
+#if defined(HOST_SSE2)
+        HOST_TARGET("ssse3")
+        VectorRegister hostPermuteBytes(const VectorRegister *table, u8 tableSize, const VectorRegister &indices, const VectorRegister &fallback) {
+            // Saturating adds push every index above 15 into the range pshufb treats as zero
+            __m128i result = _mm_setzero_si128();
+            __m128i remaining = load(indices);
+            for (u8 i = 0; i < tableSize; i++) {
+                result = _mm_or_si128(result, _mm_shuffle_epi8(load(table[i]), _mm_adds_epu8(remaining, _mm_set1_epi8(0x70))));
+                remaining = _mm_sub_epi8(remaining, _mm_set1_epi8(16));
+            }
+
+            const __m128i outOfRange = _mm_cmpeq_epi8(_mm_min_epu8(load(indices), _mm_set1_epi8(s8(tableSize * 16 - 1))), load(indices));
+            return store(_mm_or_si128(_mm_and_si128(outOfRange, result), _mm_andnot_si128(outOfRange, load(fallback))));
+        }
+
+        HOST_TARGET("ssse3")
+        VectorRegister hostPopulationCount(const VectorRegister &a) {
+            // Nibble lookup table, two shuffles per byte
+            const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m128i lowMask = _mm_set1_epi8(0x0F);
+            const __m128i value = load(a);
+            const __m128i low = _mm_shuffle_epi8(lookup, _mm_and_si128(value, lowMask));
+            const __m128i high = _mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(value, 4), lowMask));
+            return store(_mm_add_epi8(low, high));
+        }
+#endif
+
+        // result[i] = table[indices[i]], out of range indices select fallback[i]
+        VectorRegister permuteBytes(const VectorRegister *table, u8 tableSize, const VectorRegister &indices, const VectorRegister &fallback) {
+#if defined(HOST_SSE2)
+            if (hostFeatures.ssse3)
+                return hostPermuteBytes(table, tableSize, indices, fallback);
+#endif
+
+            VectorRegister result;
+            for (u8 i = 0; i < 16; i++) {
+                const u8 index = indices.B[i];
+                result.B[i] = index < tableSize * 16 ? table[index / 16].B[index % 16] : fallback.B[i];
+            }
+
+            return result;
+        }
+
+        VectorRegister reverseElements(const VectorRegister &a, u8 size, u8 containerBytes) {
+            const u8 elementBytes = 1 << size;
+
+            VectorRegister indices;
+            for (u8 i = 0; i < 16; i++) {
+                const u8 container = i / containerBytes * containerBytes;
+                const u8 element = (i % containerBytes) / elementBytes;
+                const u8 reversed = containerBytes / elementBytes - 1 - element;
+                indices.B[i] = container + reversed * elementBytes + i % elementBytes;
+            }
+
+            return permuteBytes(&a, 1, indices, VectorRegister());
+        }
+
+        VectorRegister populationCount(const VectorRegister &a) {
+#if defined(HOST_SSE2)
+            if (hostFeatures.ssse3)
+                return hostPopulationCount(a);
+#endif
+
+            return mapLanes<u8>(a, [](u8 x) { return u8(std::popcount(x)); });
+        }
+
+        u64 replicate(u64 value, u8 bits) {
+            switch (bits) {
+                case 8:  return value * 0x0101'0101'0101'0101;
+                case 16: return value * 0x0001'0001'0001'0001;
+                case 32: return value | value << 32;
+                default: return value;
+            }
+        }
+
+        // VFPExpandImm, the 8 bit immediate holds the sign, a 3 bit exponent and a 4 bit fraction
+        u64 expandFloatImmediate(u8 imm8, bool doublePrecision) {
+            const u64 a = extract<BIT(7)>(imm8), b = extract<BIT(6)>(imm8), cd = extract<BITS(4:5)>(imm8), efgh = extract<BITS(0:3)>(imm8);
+
+            if (!doublePrecision)
+                return a << 31 | (b ^ 1) << 30 | (b ? u64(0x1F) : 0) << 25 | cd << 23 | efgh << 19;
+            else
+                return a << 63 | (b ^ 1) << 62 | (b ? u64(0xFF) : 0) << 54 | cd << 52 | efgh << 48;
+        }
+
+        // AdvSIMDExpandImm
+        u64 expandImmediate(bool op, u8 cmode, u8 imm8) {
+            switch (cmode >> 1) {
+                case 0b000: return replicate(imm8, 32);
+                case 0b001: return replicate(u64(imm8) << 8, 32);
+                case 0b010: return replicate(u64(imm8) << 16, 32);
+                case 0b011: return replicate(u64(imm8) << 24, 32);
+                case 0b100: return replicate(imm8, 16);
+                case 0b101: return replicate(u64(imm8) << 8, 16);
+                case 0b110: return replicate((cmode & 1) ? (u64(imm8) << 16 | 0xFFFF) : (u64(imm8) << 8 | 0xFF), 32);
+                default:
+                    if (!(cmode & 1)) {
+                        if (!op)
+                            return replicate(imm8, 8);
+
+                        u64 value = 0;
+                        for (u8 bit = 0; bit < 8; bit++) {
+                            if (imm8 & (1 << bit))
+                                value |= u64(0xFF) << (bit * 8);
+                        }
+                        return value;
+                    }
+
+                    // FMOV
+                    return op ? expandFloatImmediate(imm8, true) : replicate(expandFloatImmediate(imm8, false), 32);
+            }
+        }
+
+    }
+
+    core::VectorRegister Core::readMemoryVector(addr_t address, u8 scale) {
+        core::VectorRegister value;
+        if (scale == 4) {
+            this->readMemoryBlock(address, sizeof(value.B), value.B);
+        } else {
+            value.D[0] = this->readMemory(address, 1 << scale);
+        }
+
+        return value;
+    }
+
+    void Core::writeMemoryVector(addr_t address, u8 scale, const core::VectorRegister &value) {
+        if (scale == 4) {
+            this->writeMemoryBlock(address, sizeof(value.B), value.B);
+        } else {
+            this->writeMemory(address, 1 << scale, value.D[0]);
+        }
+    }
+
+    thread_local Core *Core::s_hostFloatingPointOwner = nullptr;
+    thread_local u32 Core::s_hostFloatingPointControl = 0;
+
+#if defined(HOST_SSE2)
+    // FZ flushes denormal inputs and results, the same as DAZ and FTZ together
+    constexpr u32 HostFlushToZero = 0x8040;
+#endif
+
+    // The host FP environment is only touched when FPCR changed or another core ran FP code on this thread since.
+    // Exception flags stay in the host's sticky flags until FPSR gets read, another core takes over or control goes back to the caller.
+    void Core::prepareFloatingPoint() {
+        if (s_hostFloatingPointOwner != this) [[unlikely]] {
+            if (s_hostFloatingPointOwner != nullptr)
+                s_hostFloatingPointOwner->collectFloatingPointExceptions();
+            else
+                std::feclearexcept(FE_ALL_EXCEPT);
+
+            s_hostFloatingPointOwner = this;
+        }
+
+        const u32 control = FPCR.X & FPCRHostControlMask;
+        if (s_hostFloatingPointControl != control) [[unlikely]] {
+            static constexpr int RoundingModes[] = { FE_TONEAREST, FE_UPWARD, FE_DOWNWARD, FE_TOWARDZERO };
+            std::fesetround(RoundingModes[extract<BITS(22:23)>(control)]);
+
+#if defined(HOST_SSE2)
+            _mm_setcsr((_mm_getcsr() & ~HostFlushToZero) | (extract<BIT(24)>(control) ? HostFlushToZero : 0));
+#endif
+
+            s_hostFloatingPointControl = control;
+        }
+    }
+
+    // Puts the host's own rounding and denormal handling back once guest code is done. Device accesses made from
+    // inside a block still see the guest's settings, they must not rely on the host defaults for FP math.
+    // The guest's exception flags are moved into FPSR first, so host FP code running until the next run can't add to them
+    void Core::restoreHostFloatingPoint() {
+        this->collectFloatingPointExceptions();
+        this->releaseFloatingPoint();
+
+        if (s_hostFloatingPointControl == 0) [[likely]]
+            return;
+
+        std::fesetround(FE_TONEAREST);
+#if defined(HOST_SSE2)
+        _mm_setcsr(_mm_getcsr() & ~HostFlushToZero);
+#endif
+
+        s_hostFloatingPointControl = 0;
+    }
+
+    void Core::collectFloatingPointExceptions() {
+        if (s_hostFloatingPointOwner != this)
+            return;
+
+        const int raised = std::fetestexcept(FE_ALL_EXCEPT);
+        if (raised == 0)
+            return;
+
+        FPSR.X |= ((raised & FE_INVALID)   ? 1 << 0 : 0) |  // IOC
+                  ((raised & FE_DIVBYZERO) ? 1 << 1 : 0) |  // DZC
+                  ((raised & FE_OVERFLOW)  ? 1 << 2 : 0) |  // OFC
+                  ((raised & FE_UNDERFLOW) ? 1 << 3 : 0) |  // UFC
+                  ((raised & FE_INEXACT)   ? 1 << 4 : 0);   // IXC
+        std::feclearexcept(FE_ALL_EXCEPT);
+    }
+
+    void Core::releaseFloatingPoint() {
+        if (s_hostFloatingPointOwner == this)
+            s_hostFloatingPointOwner = nullptr;
+    }
+
+    // Encodings inside an implemented class that aren't handled (yet) halt the core just like unknown instructions do
+    void Core::unimplementedInstruction(const inst_t &inst) {
+        Logger::debug("Unimplemented instruction 0x%08x at 0x%016llx", inst, PC.X - InstructionWidth);
+        this->halt();
+    }
+
+    INSTRUCTION_DEF(SIMD_LOAD_STORE_IMMEDIATE) {
+        const u8 opc = extract<BITS(22:23)>(inst);
+        const u8 scale = (opc & 0b10) << 1 | extract<BITS(30:31)>(inst);
+        if (scale > 4)
+            return this->unimplementedInstruction(inst);
+
+        const addr_t address = GPSP(Rn).X + (u64(imm12) << scale);
+        if (opc & 0b01)
+            V[Rd] = this->readMemoryVector(address, scale);
+        else
+            this->writeMemoryVector(address, scale, V[Rd]);
+    }
+
+    INSTRUCTION_DEF(SIMD_LOAD_STORE) {
+        const u8 opc = extract<BITS(22:23)>(inst);
+        const u8 scale = (opc & 0b10) << 1 | extract<BITS(30:31)>(inst);
+        const bool load = opc & 0b01;
+        const u8 mode = extract<BITS(10:11)>(inst);
+        if (scale > 4)
+            return this->unimplementedInstruction(inst);
+
+        addr_t address = GPSP(Rn).X;
+        std::optional<addr_t> writeback;
+        if (extract<BIT(21)>(inst)) {
+            // Register offset
+            if (mode != 0b10)
+                return this->unimplementedInstruction(inst);
+
+            address += extendRegister(GPZR(Rm).X, extract<BITS(13:15)>(inst), extract<BIT(12)>(inst) ? scale : 0);
+        } else {
+            // Unscaled (LDUR / STUR), post-index and pre-index
+            if (mode == 0b10)
+                return this->unimplementedInstruction(inst);
+
+            const u64 offset = extendSign(extract<BITS(12:20)>(inst), 9, 64);
+            if (mode != 0b01)
+                address += offset;
+
+            if (mode == 0b01)
+                writeback = address + offset;
+            else if (mode == 0b11)
+                writeback = address;
+        }
+
+        if (load)
+            V[Rd] = this->readMemoryVector(address, scale);
+        else
+            this->writeMemoryVector(address, scale, V[Rd]);
+
+        // Only once the access went through, a fault has to leave Rn untouched so the instruction can be restarted
+        if (writeback.has_value())
+            GPSP(Rn).X = *writeback;
+    }
+
+    INSTRUCTION_DEF(SIMD_LOAD_STORE_PAIR) {
+        const u8 opc = extract<BITS(30:31)>(inst);
+        if (opc == 0b11)
+            return this->unimplementedInstruction(inst);
+
+        const u8 scale = 2 + opc;
+        const u8 mode = extract<BITS(23:24)>(inst);
+        const bool load = extract<BIT(22)>(inst);
+        const u8 Rt2 = extract<BITS(10:14)>(inst);
+        const u64 offset = extendSign(extract<BITS(15:21)>(inst), 7, 64) << scale;
+
+        // Modes are no-allocate and signed offset, both treated the same, post-index and pre-index
+        addr_t address = GPSP(Rn).X;
+        if (mode != 0b01)
+            address += offset;
+
+        // Both registers are transferred as one block
+        const u8 elementBytes = 1 << scale;
+        std::array<u8, 2 * sizeof(core::VectorRegister::B)> buffer;
+        if (load) {
+            this->readMemoryBlock(address, 2 * elementBytes, buffer.data());
+
+            core::VectorRegister first, second;
+            std::memcpy(first.B, buffer.data(), elementBytes);
+            std::memcpy(second.B, buffer.data() + elementBytes, elementBytes);
+            V[Rd] = first;
+            V[Rt2] = second;
+        } else {
+            std::memcpy(buffer.data(), V[Rd].B, elementBytes);
+            std::memcpy(buffer.data() + elementBytes, V[Rt2].B, elementBytes);
+
+            this->writeMemoryBlock(address, 2 * elementBytes, buffer.data());
+        }
+
+        if (mode == 0b01)
+            GPSP(Rn).X = address + offset;
+        else if (mode == 0b11)
+            GPSP(Rn).X = address;
+    }
+
+    INSTRUCTION_DEF(SIMD_LOAD_STORE_MULTIPLE) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool load = extract<BIT(22)>(inst);
+        const bool postIndex = extract<BIT(23)>(inst);
+        const u8 elementSize = extract<BITS(10:11)>(inst);
+
+        u8 registers, structures;
+        switch (extract<BITS(12:15)>(inst)) {
+            case 0b0000: registers = 4; structures = 4; break; // LD4 / ST4
+            case 0b0010: registers = 4; structures = 1; break; // LD1 / ST1, 4 registers
+            case 0b0100: registers = 3; structures = 3; break; // LD3 / ST3
+            case 0b0110: registers = 3; structures = 1; break; // LD1 / ST1, 3 registers
+            case 0b0111: registers = 1; structures = 1; break; // LD1 / ST1, 1 register
+            case 0b1000: registers = 2; structures = 2; break; // LD2 / ST2
+            case 0b1010: registers = 2; structures = 1; break; // LD1 / ST1, 2 registers
+            default: return this->unimplementedInstruction(inst);
+        }
+
+        if (elementSize == 3 && !Q && structures > 1)
+            return this->unimplementedInstruction(inst);
+
+        const u8 registerBytes = Q ? 16 : 8;
+        const u8 elementBytes = 1 << elementSize;
+        const u8 elements = registerBytes / elementBytes;
+        const u32 totalBytes = registers * registerBytes;
+        const addr_t address = GPSP(Rn).X;
+
+        // Memory is always accessed as a whole, LD2 to LD4 (de)interleave their structures on the host
+        std::array<u8, 64> buffer;
+        if (load) {
+            for (u32 offset = 0; offset < totalBytes; offset += sizeof(u64)) {
+                const u64 value = this->readMemory(address + offset, sizeof(u64));
+                std::memcpy(&buffer[offset], &value, sizeof(u64));
+            }
+
+            for (u8 r = 0; r < registers; r++) {
+                core::VectorRegister value;
+                if (structures == 1) {
+                    std::memcpy(value.B, &buffer[r * registerBytes], registerBytes);
+                } else {
+                    for (u8 e = 0; e < elements; e++)
+                        std::memcpy(&value.B[e * elementBytes], &buffer[(e * structures + r) * elementBytes], elementBytes);
+                }
+
+                V[(Rd + r) % 32] = value;
+            }
+        } else {
+            for (u8 r = 0; r < registers; r++) {
+                const core::VectorRegister &value = V[(Rd + r) % 32];
+                if (structures == 1) {
+                    std::memcpy(&buffer[r * registerBytes], value.B, registerBytes);
+                } else {
+                    for (u8 e = 0; e < elements; e++)
+                        std::memcpy(&buffer[(e * structures + r) * elementBytes], &value.B[e * elementBytes], elementBytes);
+                }
+            }
+
+            for (u32 offset = 0; offset < totalBytes; offset += sizeof(u64)) {
+                u64 value;
+                std::memcpy(&value, &buffer[offset], sizeof(u64));
+                this->writeMemory(address + offset, sizeof(u64), value);
+            }
+        }
+
+        if (postIndex)
+            GPSP(Rn).X = address + (Rm == 31 ? totalBytes : GPZR(Rm).X);
+    }
+
+    INSTRUCTION_DEF(SIMD_LOAD_REPLICATE) {
+        const bool Q = extract<BIT(30)>(inst);
+        const u8 elementSize = extract<BITS(10:11)>(inst);
+        const addr_t address = GPSP(Rn).X;
+
+        assign(V[Rd], duplicate(this->readMemory(address, 1 << elementSize), elementSize), Q);
+
+        if (extract<BIT(23)>(inst))
+            GPSP(Rn).X = address + (Rm == 31 ? (1 << elementSize) : GPZR(Rm).X);
+    }
+
+    INSTRUCTION_DEF(SIMD_THREE_SAME) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const u8 opcode = extract<BITS(11:15)>(inst);
+        const core::VectorRegister &n = V[Rn];
+        const core::VectorRegister &m = V[Rm];
+
+        if (size == 3 && !Q && opcode != 0b00011)
+            return this->unimplementedInstruction(inst);
+
+        core::VectorRegister result;
+        switch (opcode) {
+            case 0b00000: // SHADD / UHADD
+                forElementSize(size, !U, [&]<typename T>() {
+                    result = mapLanes<T>(n, m, [](T x, T y) { return T((Wide<T>(x) + Wide<T>(y)) >> 1); });
+                });
+                break;
+            case 0b00001: // SQADD / UQADD
+                result = vectorSaturating(n, m, size, U, false);
+                break;
+            case 0b00101: // SQSUB / UQSUB
+                result = vectorSaturating(n, m, size, U, true);
+                break;
+            case 0b00011: // Logical operations, size selects the operation
+                if (!U) {
+                    switch (size) {
+                        case 0b00: result = vectorAnd(n, m);                break; // AND
+                        case 0b01: result = vectorAndNot(n, m);             break; // BIC
+                        case 0b10: result = vectorOr(n, m);                 break; // ORR
+                        default:   result = vectorOr(n, vectorNot(m));      break; // ORN
+                    }
+                } else {
+                    const core::VectorRegister &d = V[Rd];
+                    switch (size) {
+                        case 0b00: result = vectorXor(n, m);                                            break; // EOR
+                        case 0b01: result = vectorOr(vectorAnd(d, n), vectorAndNot(m, d));              break; // BSL
+                        case 0b10: result = vectorOr(vectorAndNot(d, m), vectorAnd(n, m));              break; // BIT
+                        default:   result = vectorOr(vectorAnd(d, m), vectorAndNot(n, m));              break; // BIF
+                    }
+                }
+                break;
+            case 0b00110: // CMGT / CMHI
+                result = compareGreater(n, m, size, U);
+                break;
+            case 0b00111: // CMGE / CMHS
+                result = vectorNot(compareGreater(m, n, size, U));
+                break;
+            case 0b01000: // SSHL / USHL
+                forElementSize(size, !U, [&]<typename T>() {
+                    result = mapLanes<T>(n, m, [](T x, T y) { return shiftByRegister<T>(x, s8(y)); });
+                });
+                break;
+            case 0b01100: // SMAX / UMAX
+                result = vectorMinMax(n, m, size, U, true);
+                break;
+            case 0b01101: // SMIN / UMIN
+                result = vectorMinMax(n, m, size, U, false);
+                break;
+            case 0b01110: // SABD / UABD
+                result = vectorSub(vectorMinMax(n, m, size, U, true), vectorMinMax(n, m, size, U, false), size);
+                break;
+            case 0b10000: // ADD / SUB
+                result = U ? vectorSub(n, m, size) : vectorAdd(n, m, size);
+                break;
+            case 0b10001: // CMTST / CMEQ
+                result = U ? compareEqual(n, m, size) : vectorNot(compareEqual(vectorAnd(n, m), core::VectorRegister(), size));
+                break;
+            case 0b10010: // MLA / MLS
+                if (size == 3)
+                    return this->unimplementedInstruction(inst);
+                result = U ? vectorSub(V[Rd], vectorMultiply(n, m, size), size) : vectorAdd(V[Rd], vectorMultiply(n, m, size), size);
+                break;
+            case 0b10011: // MUL / PMUL
+                if (size == 3 || (U && size != 0))
+                    return this->unimplementedInstruction(inst);
+                result = U ? mapLanes<u8>(n, m, polynomialMultiply) : vectorMultiply(n, m, size);
+                break;
+            case 0b10111: // ADDP
+                if (U)
+                    return this->unimplementedInstruction(inst);
+                forElementSize<false>(size, [&]<typename T>() { result = pairwiseLanes<T>(n, m, Q, [](T x, T y) { return T(x + y); }); });
+                break;
+            case 0b10100: // SMAXP / UMAXP
+            case 0b10101: // SMINP / UMINP
+                if (size == 3)
+                    return this->unimplementedInstruction(inst);
+                forElementSize(size, !U, [&]<typename T>() {
+                    const bool maximum = opcode == 0b10100;
+                    result = pairwiseLanes<T>(n, m, Q, [maximum](T x, T y) { return maximum ? std::max(x, y) : std::min(x, y); });
+                });
+                break;
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        assign(V[Rd], result, Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_FLOAT_THREE_SAME) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const bool a = extract<BIT(23)>(inst);
+        const bool doublePrecision = extract<BIT(22)>(inst);
+        const u8 opcode = extract<BITS(11:15)>(inst);
+        const core::VectorRegister &n = V[Rn];
+        const core::VectorRegister &m = V[Rm];
+
+        if (doublePrecision && !Q)
+            return this->unimplementedInstruction(inst);
+
+        this->prepareFloatingPoint();
+        const bool defaultNaN = extract<BIT(25)>(FPCR.X);
+
+        core::VectorRegister result;
+        switch (u8(U) << 6 | u8(a) << 5 | opcode) {
+            case 0b0'0'11010: result = floatArithmetic(n, m, doublePrecision, '+', defaultNaN); break; // FADD
+            case 0b0'1'11010: result = floatArithmetic(n, m, doublePrecision, '-', defaultNaN); break; // FSUB
+            case 0b1'0'11011: result = floatArithmetic(n, m, doublePrecision, '*', defaultNaN); break; // FMUL
+            case 0b1'0'11111: result = floatArithmetic(n, m, doublePrecision, '/', defaultNaN); break; // FDIV
+            case 0b0'0'11001: result = floatMultiplyAdd(V[Rd], n, m, doublePrecision, false, defaultNaN); break; // FMLA
+            case 0b0'1'11001: result = floatMultiplyAdd(V[Rd], n, m, doublePrecision, true, defaultNaN);  break; // FMLS
+            case 0b1'0'11010: // FADDP
+                forFloatSize(doublePrecision, [&]<typename T>() { result = pairwiseLanes<T>(n, m, Q, withNaNHandling<T>([](T x, T y) { return x + y; }, defaultNaN)); });
+                break;
+            case 0b0'0'11110: // FMAX
+                forFloatSize(doublePrecision, [&]<typename T>() { result = mapLanes<T>(n, m, withNaNHandling<T>(floatMax<T>, defaultNaN)); });
+                break;
+            case 0b0'1'11110: // FMIN
+                forFloatSize(doublePrecision, [&]<typename T>() { result = mapLanes<T>(n, m, withNaNHandling<T>(floatMin<T>, defaultNaN)); });
+                break;
+            case 0b0'0'11000: // FMAXNM
+                forFloatSize(doublePrecision, [&]<typename T>() { result = mapLanes<T>(n, m, withNaNHandling<T>(floatMaxNumber<T>, defaultNaN)); });
+                break;
+            case 0b0'1'11000: // FMINNM
+                forFloatSize(doublePrecision, [&]<typename T>() { result = mapLanes<T>(n, m, withNaNHandling<T>(floatMinNumber<T>, defaultNaN)); });
+                break;
+            case 0b1'0'11110: // FMAXP
+                forFloatSize(doublePrecision, [&]<typename T>() { result = pairwiseLanes<T>(n, m, Q, withNaNHandling<T>(floatMax<T>, defaultNaN)); });
+                break;
+            case 0b1'1'11110: // FMINP
+                forFloatSize(doublePrecision, [&]<typename T>() { result = pairwiseLanes<T>(n, m, Q, withNaNHandling<T>(floatMin<T>, defaultNaN)); });
+                break;
+            case 0b0'0'11100: // FCMEQ
+#if defined(HOST_SSE2)
+                result = doublePrecision ? store(_mm_cmpeq_pd(loadDouble(n), loadDouble(m))) : store(_mm_cmpeq_ps(loadFloat(n), loadFloat(m)));
+#else
+                forFloatSize(doublePrecision, [&]<typename T>() { result = compareLanes<T>(n, m, [](T x, T y) { return x == y; }); });
+#endif
+                break;
+            case 0b1'0'11100: // FCMGE
+#if defined(HOST_SSE2)
+                result = doublePrecision ? store(_mm_cmpge_pd(loadDouble(n), loadDouble(m))) : store(_mm_cmpge_ps(loadFloat(n), loadFloat(m)));
+#else
+                forFloatSize(doublePrecision, [&]<typename T>() { result = compareLanes<T>(n, m, [](T x, T y) { return x >= y; }); });
+#endif
+                break;
+            case 0b1'1'11100: // FCMGT
+#if defined(HOST_SSE2)
+                result = doublePrecision ? store(_mm_cmpgt_pd(loadDouble(n), loadDouble(m))) : store(_mm_cmpgt_ps(loadFloat(n), loadFloat(m)));
+#else
+                forFloatSize(doublePrecision, [&]<typename T>() { result = compareLanes<T>(n, m, [](T x, T y) { return x > y; }); });
+#endif
+                break;
+            case 0b1'0'11101: // FACGE
+                forFloatSize(doublePrecision, [&]<typename T>() { result = compareLanes<T>(n, m, [](T x, T y) { return std::fabs(x) >= std::fabs(y); }); });
+                break;
+            case 0b1'1'11101: // FACGT
+                forFloatSize(doublePrecision, [&]<typename T>() { result = compareLanes<T>(n, m, [](T x, T y) { return std::fabs(x) > std::fabs(y); }); });
+                break;
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        assign(V[Rd], result, Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_THREE_DIFFERENT) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const u8 opcode = extract<BITS(12:15)>(inst);
+        const core::VectorRegister &n = V[Rn];
+        const core::VectorRegister &m = V[Rm];
+        const core::VectorRegister &d = V[Rd];
+
+        if (size == 3)
+            return this->unimplementedInstruction(inst);
+
+        // The "2" variants (Q set) read their narrow operands from the upper half
+        core::VectorRegister result;
+        bool implemented = true;
+        forElementSize(size, !U, [&]<typename T>() {
+            using W = Wide<T>;
+            const u8 count = 8 / sizeof(T);
+            const u8 offset = Q ? count : 0;
+
+            for (u8 i = 0; i < count; i++) {
+                const W x = getLane<T>(n, offset + i);
+                const W y = getLane<T>(m, offset + i);
+                const W wide = getLane<W>(n, i);
+                const W accumulator = getLane<W>(d, i);
+
+                W value;
+                switch (opcode) {
+                    case 0b0000: value = W(x + y);                   break; // SADDL / UADDL
+                    case 0b0001: value = W(wide + y);                break; // SADDW / UADDW
+                    case 0b0010: value = W(x - y);                   break; // SSUBL / USUBL
+                    case 0b0011: value = W(wide - y);                break; // SSUBW / USUBW
+                    case 0b0111: value = W(x > y ? x - y : y - x);   break; // SABDL / UABDL
+                    case 0b1000: value = W(accumulator + x * y);     break; // SMLAL / UMLAL
+                    case 0b1010: value = W(accumulator - x * y);     break; // SMLSL / UMLSL
+                    case 0b1100: value = W(x * y);                   break; // SMULL / UMULL
+                    default: implemented = false; return;
+                }
+
+                setLane<W>(result, i, value);
+            }
+        });
+
+        if (!implemented)
+            return this->unimplementedInstruction(inst);
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(SIMD_TWO_REGISTER_MISC) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const u8 opcode = extract<BITS(12:16)>(inst);
+        const bool doublePrecision = extract<BIT(22)>(inst);
+        const bool floatHigh = extract<BIT(23)>(inst);
+        const core::VectorRegister &n = V[Rn];
+        const core::VectorRegister zero;
+
+        core::VectorRegister result;
+        switch (u8(U) << 5 | opcode) {
+            case 0b0'00000: // REV64
+                if (size == 3)
+                    return this->unimplementedInstruction(inst);
+                result = reverseElements(n, size, 8);
+                break;
+            case 0b1'00000: // REV32
+                if (size > 1)
+                    return this->unimplementedInstruction(inst);
+                result = reverseElements(n, size, 4);
+                break;
+            case 0b0'00001: // REV16
+                if (size != 0)
+                    return this->unimplementedInstruction(inst);
+                result = reverseElements(n, size, 2);
+                break;
+            case 0b0'00101: // CNT
+                if (size != 0)
+                    return this->unimplementedInstruction(inst);
+                result = populationCount(n);
+                break;
+            case 0b1'00101: // NOT / RBIT
+                if (size == 0)
+                    result = vectorNot(n);
+                else if (size == 1)
+                    result = mapLanes<u8>(n, [](u8 x) { return u8((x * 0x0202020202ULL & 0x010884422010ULL) % 1023); });
+                else
+                    return this->unimplementedInstruction(inst);
+                break;
+            case 0b0'01000: result = compareGreater(n, zero, size, false);                                                 break; // CMGT #0
+            case 0b1'01000: result = vectorNot(compareGreater(zero, n, size, false));                                      break; // CMGE #0
+            case 0b0'01001: result = compareEqual(n, zero, size);                                                          break; // CMEQ #0
+            case 0b1'01001: result = vectorNot(compareGreater(n, zero, size, false));                                      break; // CMLE #0
+            case 0b0'01010: result = compareGreater(zero, n, size, false);                                                 break; // CMLT #0
+            case 0b1'01011: result = vectorSub(zero, n, size);                                                             break; // NEG
+            case 0b0'01011: // ABS
+                result = vectorMinMax(n, vectorSub(zero, n, size), size, false, true);
+                // The most negative value stays as it is
+                if (size == 3)
+                    result = mapLanes<s64>(n, [](s64 x) { return x < 0 ? s64(0 - u64(x)) : x; });
+                break;
+            case 0b0'10010: // XTN / XTN2
+                if (size == 3)
+                    return this->unimplementedInstruction(inst);
+                result = Q ? V[Rd] : zero;
+                forElementSize<false>(size, [&]<typename T>() {
+                    const u8 count = 8 / sizeof(T);
+                    for (u8 i = 0; i < count; i++)
+                        setLane<T>(result, (Q ? count : 0) + i, T(getLane<Wide<T>>(n, i)));
+                });
+                V[Rd] = result;
+                return;
+            case 0b0'01111: // FABS
+            case 0b1'01111: // FNEG
+                if (!floatHigh || (doublePrecision && !Q))
+                    return this->unimplementedInstruction(inst);
+#if defined(HOST_SSE2)
+                if (doublePrecision)
+                    result = store(U ? _mm_xor_pd(loadDouble(n), _mm_set1_pd(-0.0)) : _mm_andnot_pd(_mm_set1_pd(-0.0), loadDouble(n)));
+                else
+                    result = store(U ? _mm_xor_ps(loadFloat(n), _mm_set1_ps(-0.0f)) : _mm_andnot_ps(_mm_set1_ps(-0.0f), loadFloat(n)));
+#else
+                forFloatSize(doublePrecision, [&]<typename T>() { result = mapLanes<T>(n, [U](T x) { return U ? -x : std::fabs(x); }); });
+#endif
+                break;
+            case 0b1'11111: // FSQRT
+                if (!floatHigh || (doublePrecision && !Q))
+                    return this->unimplementedInstruction(inst);
+                this->prepareFloatingPoint();
+                result = floatSquareRoot(n, doublePrecision, extract<BIT(25)>(FPCR.X));
+                break;
+            case 0b0'11101: // SCVTF
+            case 0b1'11101: // UCVTF
+                if (floatHigh || (doublePrecision && !Q))
+                    return this->unimplementedInstruction(inst);
+                this->prepareFloatingPoint();
+                if (doublePrecision) {
+                    for (u8 i = 0; i < 2; i++)
+                        setLane<double>(result, i, U ? double(getLane<u64>(n, i)) : double(getLane<s64>(n, i)));
+                } else {
+#if defined(HOST_SSE2)
+                    if (!U) {
+                        result = store(_mm_cvtepi32_ps(load(n)));
+                        break;
+                    }
+#endif
+                    for (u8 i = 0; i < 4; i++)
+                        setLane<float>(result, i, U ? float(getLane<u32>(n, i)) : float(getLane<s32>(n, i)));
+                }
+                break;
+            case 0b0'11011: // FCVTZS
+            case 0b1'11011: // FCVTZU
+                if (!floatHigh || (doublePrecision && !Q))
+                    return this->unimplementedInstruction(inst);
+                this->prepareFloatingPoint();
+                if (doublePrecision) {
+                    for (u8 i = 0; i < 2; i++) {
+                        const double value = getLane<double>(n, i);
+                        setLane<u64>(result, i, U ? convertToInteger<u64>(value, Rounding::Zero) : u64(convertToInteger<s64>(value, Rounding::Zero)));
+                    }
+                } else {
+                    for (u8 i = 0; i < 4; i++) {
+                        const float value = getLane<float>(n, i);
+                        setLane<u32>(result, i, U ? convertToInteger<u32>(value, Rounding::Zero) : u32(convertToInteger<s32>(value, Rounding::Zero)));
+                    }
+                }
+                break;
+            case 0b0'01100: // FCMGT #0
+            case 0b1'01100: // FCMGE #0
+            case 0b0'01101: // FCMEQ #0
+            case 0b1'01101: // FCMLE #0
+            case 0b0'01110: // FCMLT #0
+                if (!floatHigh || (doublePrecision && !Q))
+                    return this->unimplementedInstruction(inst);
+                this->prepareFloatingPoint();
+                forFloatSize(doublePrecision, [&]<typename T>() {
+                    const u8 operation = u8(U) << 5 | opcode;
+                    result = compareLanes<T>(n, zero, [operation](T x, T y) {
+                        switch (operation) {
+                            case 0b0'01100: return x > y;
+                            case 0b1'01100: return x >= y;
+                            case 0b0'01101: return x == y;
+                            case 0b1'01101: return x <= y;
+                            default:        return x < y;
+                        }
+                    });
+                });
+                break;
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        assign(V[Rd], result, Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_ACROSS_LANES) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const u8 opcode = extract<BITS(12:16)>(inst);
+        const core::VectorRegister &n = V[Rn];
+
+        if (size == 3 || (size == 2 && !Q))
+            return this->unimplementedInstruction(inst);
+
+        core::VectorRegister result;
+        switch (u8(U) << 5 | opcode) {
+            case 0b0'11011: // ADDV
+#if defined(HOST_SSE2)
+                if (size == 0) {
+                    // Sums of absolute differences against zero add up 8 bytes at a time
+                    const __m128i source = Q ? load(n) : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(n.B));
+                    const __m128i sums = _mm_sad_epu8(source, _mm_setzero_si128());
+                    result.B[0] = u8(_mm_cvtsi128_si32(_mm_add_epi64(sums, _mm_unpackhi_epi64(sums, sums))));
+                    break;
+                }
+#endif
+                forElementSize<false>(size, [&]<typename T>() {
+                    T sum = 0;
+                    for (u8 i = 0; i < laneCount<T>(Q); i++)
+                        sum += getLane<T>(n, i);
+                    setLane<T>(result, 0, sum);
+                });
+                break;
+            case 0b0'00011: // SADDLV
+            case 0b1'00011: // UADDLV
+                forElementSize(size, !U, [&]<typename T>() {
+                    Wide<T> sum = 0;
+                    for (u8 i = 0; i < laneCount<T>(Q); i++)
+                        sum += getLane<T>(n, i);
+                    setLane<Wide<T>>(result, 0, sum);
+                });
+                break;
+            case 0b0'01010: // SMAXV
+            case 0b1'01010: // UMAXV
+            case 0b0'11010: // SMINV
+            case 0b1'11010: // UMINV
+                forElementSize(size, !U, [&]<typename T>() {
+                    const bool maximum = opcode == 0b01010;
+                    T value = getLane<T>(n, 0);
+                    for (u8 i = 1; i < laneCount<T>(Q); i++)
+                        value = maximum ? std::max(value, getLane<T>(n, i)) : std::min(value, getLane<T>(n, i));
+                    setLane<T>(result, 0, value);
+                });
+                break;
+            case 0b1'01100: // FMAXNMV / FMINNMV
+            case 0b1'01111: // FMAXV / FMINV
+            {
+                if (!Q || extract<BIT(22)>(inst))
+                    return this->unimplementedInstruction(inst);
+                this->prepareFloatingPoint();
+
+                const bool minimum = extract<BIT(23)>(inst);
+                const bool number = opcode == 0b01100;
+                const auto combine = withNaNHandling<float>([minimum, number](float x, float y) {
+                    if (number)
+                        return minimum ? floatMinNumber(x, y) : floatMaxNumber(x, y);
+                    return minimum ? floatMin(x, y) : floatMax(x, y);
+                }, extract<BIT(25)>(FPCR.X));
+
+                setLane<float>(result, 0, combine(combine(n.F32[0], n.F32[1]), combine(n.F32[2], n.F32[3])));
+                break;
+            }
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(SIMD_COPY) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool op = extract<BIT(29)>(inst);
+        const u8 imm5 = extract<BITS(16:20)>(inst);
+        const u8 imm4 = extract<BITS(11:14)>(inst);
+
+        if ((imm5 & 0b1111) == 0)
+            return this->unimplementedInstruction(inst);
+
+        const u8 elementSize = std::countr_zero(imm5);
+        const u8 index = imm5 >> (elementSize + 1);
+
+        // INS (element)
+        if (op) {
+            forElementSize<false>(elementSize, [&]<typename T>() {
+                setLane<T>(V[Rd], index, getLane<T>(V[Rn], imm4 >> elementSize));
+            });
+            return;
+        }
+
+        switch (imm4) {
+            case 0b0000: // DUP (element)
+                forElementSize<false>(elementSize, [&]<typename T>() {
+                    assign(V[Rd], duplicate(getLane<T>(V[Rn], index), elementSize), Q);
+                });
+                break;
+            case 0b0001: // DUP (general)
+                assign(V[Rd], duplicate(GPZR(Rn).X, elementSize), Q);
+                break;
+            case 0b0011: // INS (general)
+                forElementSize<false>(elementSize, [&]<typename T>() { setLane<T>(V[Rd], index, T(GPZR(Rn).X)); });
+                break;
+            case 0b0101: // SMOV
+                forElementSize<true>(elementSize, [&]<typename T>() {
+                    const s64 value = getLane<T>(V[Rn], index);
+                    GPZR(Rd).X = Q ? u64(value) : u32(value);
+                });
+                break;
+            case 0b0111: // UMOV
+                forElementSize<false>(elementSize, [&]<typename T>() { GPZR(Rd).X = getLane<T>(V[Rn], index); });
+                break;
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+    }
+
+    INSTRUCTION_DEF(SIMD_PERMUTE) {
+        const bool Q = extract<BIT(30)>(inst);
+        const u8 opcode = extract<BITS(12:14)>(inst);
+        const core::VectorRegister &n = V[Rn];
+        const core::VectorRegister &m = V[Rm];
+
+        if ((size == 3 && !Q) || (opcode & 0b011) == 0)
+            return this->unimplementedInstruction(inst);
+
+        core::VectorRegister result;
+
+#if defined(HOST_SSE2)
+        // Full width zips are exactly the unpack instructions
+        if (Q && (opcode & 0b011) == 0b011) {
+            const bool high = opcode & 0b100;
+            const __m128i x = load(n), y = load(m);
+            switch (size) {
+                case 0:  result = store(high ? _mm_unpackhi_epi8(x, y)  : _mm_unpacklo_epi8(x, y));  break;
+                case 1:  result = store(high ? _mm_unpackhi_epi16(x, y) : _mm_unpacklo_epi16(x, y)); break;
+                case 2:  result = store(high ? _mm_unpackhi_epi32(x, y) : _mm_unpacklo_epi32(x, y)); break;
+                default: result = store(high ? _mm_unpackhi_epi64(x, y) : _mm_unpacklo_epi64(x, y)); break;
+            }
+
+            V[Rd] = result;
+            return;
+        }
+#endif
+
+        forElementSize<false>(size, [&]<typename T>() {
+            const u8 count = laneCount<T>(Q);
+            const u8 half = count / 2;
+            const u8 part = (opcode & 0b100) ? 1 : 0;
+
+            for (u8 i = 0; i < count; i++) {
+                T value;
+                switch (opcode & 0b011) {
+                    case 0b01: // UZP1 / UZP2
+                        value = i < half ? getLane<T>(n, 2 * i + part) : getLane<T>(m, 2 * (i - half) + part);
+                        break;
+                    case 0b10: // TRN1 / TRN2
+                        value = (i % 2 == 0) ? getLane<T>(n, i + part) : getLane<T>(m, i - 1 + part);
+                        break;
+                    default:   // ZIP1 / ZIP2
+                        value = (i % 2 == 0) ? getLane<T>(n, part * half + i / 2) : getLane<T>(m, part * half + i / 2);
+                        break;
+                }
+
+                setLane<T>(result, i, value);
+            }
+        });
+
+        assign(V[Rd], result, Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_EXTRACT) {
+        const bool Q = extract<BIT(30)>(inst);
+        const u8 position = extract<BITS(11:14)>(inst);
+        const u8 bytes = Q ? 16 : 8;
+
+        if (!Q && position >= 8)
+            return this->unimplementedInstruction(inst);
+
+        std::array<u8, 32> concatenated;
+        std::memcpy(&concatenated[0], V[Rn].B, bytes);
+        std::memcpy(&concatenated[bytes], V[Rm].B, bytes);
+
+        core::VectorRegister result;
+        std::memcpy(result.B, &concatenated[position], bytes);
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(SIMD_TABLE_LOOKUP) {
+        const bool Q = extract<BIT(30)>(inst);
+        const u8 length = extract<BITS(13:14)>(inst) + 1;
+        const bool extension = extract<BIT(12)>(inst);
+
+        std::array<core::VectorRegister, 4> table;
+        for (u8 i = 0; i < length; i++)
+            table[i] = V[(Rn + i) % 32];
+
+        // TBL zeroes lanes with out of range indices, TBX leaves them untouched
+        assign(V[Rd], permuteBytes(table.data(), length, V[Rm], extension ? V[Rd] : core::VectorRegister()), Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_MODIFIED_IMMEDIATE) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool op = extract<BIT(29)>(inst);
+        const u8 cmode = extract<BITS(12:15)>(inst);
+        const u8 imm8 = extract<BITS(16:18)>(inst) << 5 | extract<BITS(5:9)>(inst);
+
+        if (op && cmode == 0b1111 && !Q)
+            return this->unimplementedInstruction(inst);
+
+        const u64 immediate = expandImmediate(op, cmode, imm8);
+
+        core::VectorRegister result;
+        if ((cmode & 0b1001) == 0b0001 || (cmode & 0b1101) == 0b1001) {
+            // ORR / BIC with a shifted 32 or 16 bit immediate
+            for (u8 i = 0; i < 2; i++)
+                result.D[i] = op ? (V[Rd].D[i] & ~immediate) : (V[Rd].D[i] | immediate);
+        } else {
+            // MOVI, MVNI and FMOV
+            const bool invert = op && cmode != 0b1110 && cmode != 0b1111;
+            result.D[0] = result.D[1] = invert ? ~immediate : immediate;
+        }
+
+        assign(V[Rd], result, Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_SHIFT_IMMEDIATE) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const u8 immh = extract<BITS(19:22)>(inst);
+        const u8 opcode = extract<BITS(11:15)>(inst);
+        const core::VectorRegister &n = V[Rn];
+
+        if (immh == 0)
+            return this->unimplementedInstruction(inst);
+
+        // The position of the highest set bit of immh selects the element size, the rest encodes the shift
+        const u8 elementSize = 31 - std::countl_zero(u32(immh));
+        const u8 elementBits = 8 << elementSize;
+        const u8 immhb = immh << 3 | extract<BITS(16:18)>(inst);
+        const u8 rightShift = 2 * elementBits - immhb;
+        const u8 leftShift = immhb - elementBits;
+
+        const bool narrowing = opcode == 0b10000;
+        const bool widening = opcode == 0b10100;
+        if ((elementSize == 3 && (!Q || narrowing || widening)))
+            return this->unimplementedInstruction(inst);
+
+        core::VectorRegister result;
+        switch (u8(U) << 5 | opcode) {
+            case 0b0'00000: // SSHR
+            case 0b1'00000: // USHR
+                result = shiftRight(n, elementSize, rightShift, U);
+                break;
+            case 0b0'00010: // SSRA
+            case 0b1'00010: // USRA
+                result = vectorAdd(V[Rd], shiftRight(n, elementSize, rightShift, U), elementSize);
+                break;
+            case 0b0'01010: // SHL
+                result = shiftLeft(n, elementSize, leftShift);
+                break;
+            case 0b1'01010: // SLI
+                forElementSize<false>(elementSize, [&]<typename T>() {
+                    const T kept = leftShift == 0 ? T(0) : T(T(~T(0)) >> (sizeof(T) * 8 - leftShift));
+                    result = mapLanes<T>(n, V[Rd], [&](T x, T d) { return T(T(x << leftShift) | (d & kept)); });
+                });
+                break;
+            case 0b1'01000: // SRI
+                forElementSize<false>(elementSize, [&]<typename T>() {
+                    const T kept = rightShift == sizeof(T) * 8 ? T(~T(0)) : T(~(T(~T(0)) >> rightShift));
+                    result = mapLanes<T>(n, V[Rd], [&](T x, T d) { return T(shiftByRegister<T>(x, -s8(rightShift)) | (d & kept)); });
+                });
+                break;
+            case 0b0'10100: // SSHLL / SXTL
+            case 0b1'10100: // USHLL / UXTL
+#if defined(HOST_SSE2)
+                if (U) {
+                    // Zero extension is an unpack with zeroes
+                    const __m128i source = Q ? _mm_unpackhi_epi64(load(n), load(n)) : load(n);
+                    switch (elementSize) {
+                        case 0:  result = store(_mm_unpacklo_epi8(source, _mm_setzero_si128()));  break;
+                        case 1:  result = store(_mm_unpacklo_epi16(source, _mm_setzero_si128())); break;
+                        default: result = store(_mm_unpacklo_epi32(source, _mm_setzero_si128())); break;
+                    }
+
+                    V[Rd] = shiftLeft(result, elementSize + 1, leftShift);
+                    return;
+                }
+#endif
+                forElementSize(elementSize, !U, [&]<typename T>() {
+                    const u8 count = 8 / sizeof(T);
+                    for (u8 i = 0; i < count; i++)
+                        setLane<Wide<T>>(result, i, Wide<T>(std::make_unsigned_t<Wide<T>>(getLane<T>(n, (Q ? count : 0) + i)) << leftShift));
+                });
+                V[Rd] = result;
+                return;
+            case 0b0'10000: // SHRN / SHRN2
+                result = Q ? V[Rd] : core::VectorRegister();
+                forElementSize<false>(elementSize, [&]<typename T>() {
+                    const u8 count = 8 / sizeof(T);
+                    for (u8 i = 0; i < count; i++)
+                        setLane<T>(result, (Q ? count : 0) + i, T(getLane<Wide<T>>(n, i) >> rightShift));
+                });
+                V[Rd] = result;
+                return;
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        assign(V[Rd], result, Q);
+    }
+
+    INSTRUCTION_DEF(SIMD_BY_ELEMENT) {
+        const bool Q = extract<BIT(30)>(inst);
+        const bool U = extract<BIT(29)>(inst);
+        const u8 opcode = extract<BITS(12:15)>(inst);
+        const bool L = extract<BIT(21)>(inst);
+        const bool M = extract<BIT(20)>(inst);
+        const bool H = extract<BIT(11)>(inst);
+        const core::VectorRegister &n = V[Rn];
+
+        core::VectorRegister result;
+        switch (u8(U) << 4 | opcode) {
+            case 0b0'1000: // MUL
+            case 0b1'0000: // MLA
+            case 0b1'0100: // MLS
+            {
+                if (size != 1 && size != 2)
+                    return this->unimplementedInstruction(inst);
+
+                // 16 bit elements can only come from V0 to V15, M becomes part of the index instead
+                const u8 index = size == 1 ? (H << 2 | L << 1 | M) : (H << 1 | L);
+                const u8 elementRegister = size == 1 ? (Rm & 0b1111) : Rm;
+
+                core::VectorRegister element;
+                forElementSize<false>(size, [&]<typename T>() { element = duplicate(getLane<T>(V[elementRegister], index), size); });
+
+                const core::VectorRegister product = vectorMultiply(n, element, size);
+                if (opcode == 0b1000)
+                    result = product;
+                else
+                    result = opcode == 0b0000 ? vectorAdd(V[Rd], product, size) : vectorSub(V[Rd], product, size);
+                break;
+            }
+            case 0b0'0001: // FMLA
+            case 0b0'0101: // FMLS
+            case 0b0'1001: // FMUL
+            {
+                const bool doublePrecision = extract<BIT(22)>(inst);
+                if (!extract<BIT(23)>(inst) || (doublePrecision && (L || !Q)))
+                    return this->unimplementedInstruction(inst);
+                this->prepareFloatingPoint();
+
+                const u8 index = doublePrecision ? H : (H << 1 | L);
+
+                core::VectorRegister element;
+                if (doublePrecision)
+                    element = duplicate(getLane<u64>(V[Rm], index), 3);
+                else
+                    element = duplicate(getLane<u32>(V[Rm], index), 2);
+
+                const bool defaultNaN = extract<BIT(25)>(FPCR.X);
+                if (opcode == 0b1001)
+                    result = floatArithmetic(n, element, doublePrecision, '*', defaultNaN);
+                else
+                    result = floatMultiplyAdd(V[Rd], n, element, doublePrecision, opcode == 0b0101, defaultNaN);
+                break;
+            }
+            default:
+                return this->unimplementedInstruction(inst);
+        }
+
+        assign(V[Rd], result, Q);
+    }
+
+
+    INSTRUCTION_DEF(FP_CONVERT_INTEGER) {
+        const u8 rmode = extract<BITS(19:20)>(inst);
+        const u8 opcode = extract<BITS(16:18)>(inst);
+
+        // FMOV (general), a raw bit copy between a general purpose register and a FP register or the top half of a vector register
+        if (opcode >= 0b110) {
+            const bool toFloat = opcode & 1;
+            if (sf && size == 0b10 && rmode == 0b01) {
+                if (toFloat)
+                    V[Rd].D[1] = GPZR(Rn).X;
+                else
+                    GPZR(Rd).X = V[Rn].D[1];
+            } else if (rmode == 0b00 && size == (sf ? 0b01 : 0b00)) {
+                if (toFloat) {
+                    core::VectorRegister value;
+                    value.D[0] = sf ? GPZR(Rn).X : u32(GPZR(Rn).X);
+                    V[Rd] = value;
+                } else {
+                    GPZR(Rd).X = sf ? V[Rn].D[0] : u32(V[Rn].D[0]);
+                }
+            } else {
+                return this->unimplementedInstruction(inst);
+            }
+
+            return;
+        }
+
+        if (size > 1)
+            return this->unimplementedInstruction(inst);
+
+        this->prepareFloatingPoint();
+
+        bool implemented = true;
+        forFloatSize(size == 1, [&]<typename T>() {
+            // SCVTF / UCVTF
+            if (opcode == 0b010 || opcode == 0b011) {
+                if (rmode != 0b00) {
+                    implemented = false;
+                    return;
+                }
+
+                const u64 value = GPZR(Rn).X;
+                T result;
+                if (opcode == 0b010)
+                    result = sf ? T(s64(value)) : T(s32(value));
+                else
+                    result = sf ? T(value) : T(u32(value));
+
+                core::VectorRegister destination;
+                setLane<T>(destination, 0, result);
+                V[Rd] = destination;
+                return;
+            }
+
+            // FCVTNS / FCVTAS / FCVTPS / FCVTMS / FCVTZS and their unsigned versions
+            Rounding rounding;
+            if (rmode == 0b00 && (opcode & 0b110) == 0b000)
+                rounding = Rounding::TieEven;
+            else if (rmode == 0b00 && (opcode & 0b110) == 0b100)
+                rounding = Rounding::TieAway;
+            else if (rmode != 0b00 && (opcode & 0b110) == 0b000)
+                rounding = Rounding(rmode);
+            else {
+                implemented = false;
+                return;
+            }
+
+            const T value = getLane<T>(V[Rn], 0);
+            if (opcode & 1)
+                GPZR(Rd).X = sf ? convertToInteger<u64>(value, rounding) : convertToInteger<u32>(value, rounding);
+            else
+                GPZR(Rd).X = sf ? u64(convertToInteger<s64>(value, rounding)) : u32(convertToInteger<s32>(value, rounding));
+        });
+
+        if (!implemented)
+            return this->unimplementedInstruction(inst);
+    }
+
+    INSTRUCTION_DEF(FP_ONE_SOURCE) {
+        const u8 opcode = extract<BITS(15:20)>(inst);
+        if (size > 1 || (opcode == 0b000100 && size == 0) || (opcode == 0b000101 && size == 1))
+            return this->unimplementedInstruction(inst);
+
+        this->prepareFloatingPoint();
+        const bool defaultNaN = extract<BIT(25)>(FPCR.X);
+
+        // Scalar results clear the rest of the vector register. The host converts NaNs between precisions the same way the
+        // architecture does, FMOV, FABS and FNEG never touch them
+        core::VectorRegister result;
+        bool implemented = true;
+        forFloatSize(size == 1, [&]<typename T>() {
+            const T value = getLane<T>(V[Rn], 0);
+
+            switch (opcode) {
+                case 0b000000: setLane<Bits<T>>(result, 0, getLane<Bits<T>>(V[Rn], 0));                               break;  // FMOV
+                case 0b000001: setLane<T>(result, 0, std::fabs(value));                                               break;  // FABS
+                case 0b000010: setLane<T>(result, 0, -value);                                                         break;  // FNEG
+                case 0b000011: setLane<T>(result, 0, processNaNs(std::sqrt(value), { value }, defaultNaN));           break;  // FSQRT
+                case 0b000100: setLane<float>(result, 0, processNaNs(float(value), { float(value) }, defaultNaN));    break;  // FCVT to single precision
+                case 0b000101: setLane<double>(result, 0, processNaNs(double(value), { double(value) }, defaultNaN)); break;  // FCVT to double precision
+                case 0b001000:                                                                                                // FRINTN
+                case 0b001001:                                                                                                // FRINTP
+                case 0b001010:                                                                                                // FRINTM
+                case 0b001011:                                                                                                // FRINTZ
+                case 0b001100:                                                                                                // FRINTA
+                case 0b001111:                                                                                                // FRINTI
+                    setLane<T>(result, 0, processNaNs(roundToIntegral(value, Rounding(opcode & 0b111)), { value }, defaultNaN));
+                    break;
+                case 0b001110: setLane<T>(result, 0, processNaNs(std::rint(value), { value }, defaultNaN));           break;  // FRINTX, signals inexact results
+                default: implemented = false; break;
+            }
+        });
+
+        if (!implemented)
+            return this->unimplementedInstruction(inst);
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(FP_TWO_SOURCE) {
+        const u8 opcode = extract<BITS(12:15)>(inst);
+        if (size > 1 || opcode > 0b1000)
+            return this->unimplementedInstruction(inst);
+
+        this->prepareFloatingPoint();
+        const bool defaultNaN = extract<BIT(25)>(FPCR.X);
+
+        core::VectorRegister result;
+        forFloatSize(size == 1, [&]<typename T>() {
+            const T a = getLane<T>(V[Rn], 0);
+            const T b = getLane<T>(V[Rm], 0);
+
+            T value;
+            switch (opcode) {
+                case 0b0000: value = a * b;                 break; // FMUL
+                case 0b0001: value = a / b;                 break; // FDIV
+                case 0b0010: value = a + b;                 break; // FADD
+                case 0b0011: value = a - b;                 break; // FSUB
+                case 0b0100: value = floatMax(a, b);        break; // FMAX
+                case 0b0101: value = floatMin(a, b);        break; // FMIN
+                case 0b0110: value = floatMaxNumber(a, b);  break; // FMAXNM
+                case 0b0111: value = floatMinNumber(a, b);  break; // FMINNM
+                default:     value = a * b;                 break; // FNMUL, negates the finished product including NaNs
+            }
+
+            value = processNaNs(value, { a, b }, defaultNaN);
+            setLane<T>(result, 0, opcode == 0b1000 ? -value : value);
+        });
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(FP_THREE_SOURCE) {
+        const bool o1 = extract<BIT(21)>(inst);
+        const bool o0 = extract<BIT(15)>(inst);
+        const u8 Ra = extract<BITS(10:14)>(inst);
+        if (size > 1)
+            return this->unimplementedInstruction(inst);
+
+        this->prepareFloatingPoint();
+        const bool defaultNaN = extract<BIT(25)>(FPCR.X);
+
+        // All four round only once
+        core::VectorRegister result;
+        forFloatSize(size == 1, [&]<typename T>() {
+            const T a = getLane<T>(V[Ra], 0);
+            const T n = getLane<T>(V[Rn], 0);
+            const T m = getLane<T>(V[Rm], 0);
+
+            T value;
+            switch (u8(o1) << 1 | u8(o0)) {
+                case 0b00: value = fusedMultiplyAdd(a, n, m, defaultNaN);    break; // FMADD
+                case 0b01: value = fusedMultiplyAdd(a, -n, m, defaultNaN);   break; // FMSUB
+                case 0b10: value = fusedMultiplyAdd(-a, -n, m, defaultNaN);  break; // FNMADD
+                default:   value = fusedMultiplyAdd(-a, n, m, defaultNaN);   break; // FNMSUB
+            }
+
+            setLane<T>(result, 0, value);
+        });
+
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(FP_COMPARE) {
+        const bool withZero = extract<BIT(3)>(inst);
+        const bool signaling = extract<BIT(4)>(inst);
+        if (size > 1)
+            return this->unimplementedInstruction(inst);
+
+        this->prepareFloatingPoint();
+
+        // FCMP / FCMPE
+        u8 nzcv;
+        forFloatSize(size == 1, [&]<typename T>() {
+            nzcv = compareFloats(getLane<T>(V[Rn], 0), withZero ? T(0) : getLane<T>(V[Rm], 0), signaling);
+        });
+
+        PSTATE.N = extract<BIT(3)>(nzcv);
+        PSTATE.Z = extract<BIT(2)>(nzcv);
+        PSTATE.C = extract<BIT(1)>(nzcv);
+        PSTATE.V = extract<BIT(0)>(nzcv);
+    }
+
+    INSTRUCTION_DEF(FP_CONDITIONAL_COMPARE) {
+        const u8 cond = extract<BITS(12:15)>(inst);
+        const bool signaling = extract<BIT(4)>(inst);
+        if (size > 1)
+            return this->unimplementedInstruction(inst);
+
+        // FCCMP / FCCMPE
+        u8 nzcv = extract<BITS(0:3)>(inst);
+        if (this->doesConditionHold(cond)) {
+            this->prepareFloatingPoint();
+
+            forFloatSize(size == 1, [&]<typename T>() {
+                nzcv = compareFloats(getLane<T>(V[Rn], 0), getLane<T>(V[Rm], 0), signaling);
+            });
+        }
+
+        PSTATE.N = extract<BIT(3)>(nzcv);
+        PSTATE.Z = extract<BIT(2)>(nzcv);
+        PSTATE.C = extract<BIT(1)>(nzcv);
+        PSTATE.V = extract<BIT(0)>(nzcv);
+    }
+
+    INSTRUCTION_DEF(FP_CONDITIONAL_SELECT) {
+        const u8 cond = extract<BITS(12:15)>(inst);
+        if (size > 1)
+            return this->unimplementedInstruction(inst);
+
+        // FCSEL
+        core::VectorRegister result;
+        result.D[0] = V[this->doesConditionHold(cond) ? Rn : Rm].D[0] & (size == 1 ? ~u64(0) : u64(0xFFFF'FFFF));
+        V[Rd] = result;
+    }
+
+    INSTRUCTION_DEF(FP_IMMEDIATE) {
+        if (size > 1)
+            return this->unimplementedInstruction(inst);
+
+        // FMOV (scalar, immediate)
+        core::VectorRegister result;
+        result.D[0] = expandFloatImmediate(extract<BITS(13:20)>(inst), size == 1);
+        V[Rd] = result;
+    }
+
+}
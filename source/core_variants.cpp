@@ -0,0 +1,190 @@
+#include "core.hpp"
+
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+namespace arm {
+
+    namespace {
+
+        template<bool sf, u8 shiftType>
+        u64 shiftOperand(u64 value, u8 amount) {
+            using T = std::conditional_t<sf, u64, u32>;
+            const T operand = T(value);
+
+            if constexpr (shiftType == 0b00)
+                return T(operand << amount);
+            else if constexpr (shiftType == 0b01)
+                return T(operand >> amount);
+            else if constexpr (shiftType == 0b10)
+                return T(std::make_signed_t<T>(operand) >> amount);
+            else
+                return std::rotr(operand, amount);
+        }
+
+    }
+
+    template<bool sf, bool setFlags>
+    u64 Core::addWithCarry(u64 x, u64 y, bool carry) {
+        if constexpr (!sf) {
+            u64 unsignedSum = u64(u32(x)) + u64(u32(y)) + carry;
+            s64 signedSum = s64(s32(x)) + s64(s32(y)) + carry;
+            u32 result = u32(unsignedSum);
+
+            if constexpr (setFlags) {
+                PSTATE.N = result >> 31;
+                PSTATE.Z = result == 0;
+                PSTATE.C = u64(result) != unsignedSum;
+                PSTATE.V = s64(s32(result)) != signedSum;
+            }
+
+            return result;
+        } else {
+            u64 result = x + y + carry;
+
+            if constexpr (setFlags) {
+                PSTATE.N = result >> 63;
+                PSTATE.Z = result == 0;
+                PSTATE.C = result < x || (carry && result == x);
+                PSTATE.V = ((~(x ^ y) & (x ^ result)) >> 63) != 0;
+            }
+
+            return result;
+        }
+    }
+
+    template<bool subtract, bool setFlags, bool is64, bool shifted, Core::Operands operands>
+    INSTRUCTION_DEF(ADD_SUB_IMMEDIATE) {
+        const u64 operand1 = operands == Operands::Generic ? GPSP(Rn).X : GPR.direct(Rn).X;
+        const u64 operand2 = shifted ? u64(imm12) << 12 : imm12;
+
+        u64 result;
+        if constexpr (subtract)
+            result = this->addWithCarry<is64, setFlags>(operand1, ~operand2, true);
+        else
+            result = this->addWithCarry<is64, setFlags>(operand1, operand2, false);
+
+        if constexpr (operands == Operands::Direct)
+            GPR.direct(Rd).X = result;
+        else if constexpr (operands == Operands::Generic)
+            (setFlags ? GPZR(Rd) : GPSP(Rd)).X = result;
+    }
+
+    template<bool subtract, bool setFlags, bool is64, u8 shiftType, Core::Operands operands>
+    INSTRUCTION_DEF(ADD_SUB_SHIFTED_REGISTER) {
+        constexpr bool generic = operands == Operands::Generic;
+
+        const u64 operand1 = operands == Operands::ZeroFirst ? 0 : generic ? GPZR(Rn).X : GPR.direct(Rn).X;
+        const u64 operand2 = shiftOperand<is64, shiftType>(generic ? GPZR(Rm).X : GPR.direct(Rm).X, imm6);
+
+        u64 result;
+        if constexpr (subtract)
+            result = this->addWithCarry<is64, setFlags>(operand1, ~operand2, true);
+        else
+            result = this->addWithCarry<is64, setFlags>(operand1, operand2, false);
+
+        if constexpr (generic)
+            GPZR(Rd).X = result;
+        else if constexpr (operands != Operands::DiscardResult)
+            GPR.direct(Rd).X = result;
+    }
+
+    template<u8 opc, bool is64, u8 shiftType, Core::Operands operands>
+    INSTRUCTION_DEF(LOGICAL_SHIFTED_REGISTER) {
+        constexpr bool generic = operands == Operands::Generic;
+
+        const u64 operand1 = operands == Operands::ZeroFirst ? 0 : generic ? GPZR(Rn).X : GPR.direct(Rn).X;
+        const u64 operand2 = shiftOperand<is64, shiftType>(generic ? GPZR(Rm).X : GPR.direct(Rm).X, imm6);
+
+        u64 result;
+        if constexpr (opc == 0b01)
+            result = operand1 | operand2;
+        else if constexpr (opc == 0b10)
+            result = operand1 ^ operand2;
+        else
+            result = operand1 & operand2;
+
+        if constexpr (!is64)
+            result = u32(result);
+
+        if constexpr (opc == 0b11) {
+            PSTATE.N = result >> (is64 ? 63 : 31);
+            PSTATE.Z = result == 0;
+            PSTATE.C = 0;
+            PSTATE.V = 0;
+        }
+
+        if constexpr (generic)
+            GPZR(Rd).X = result;
+        else if constexpr (operands != Operands::DiscardResult)
+            GPR.direct(Rd).X = result;
+    }
+
+    /*
+     * Swaps the generic handler of the most common data processing instructions for one instantiated with the operand size,
+     * shift type, flag setting and register 31 handling of this particular encoding, so executing it doesn't branch on any
+     * of them anymore. Only translated blocks use these, the interpreter keeps running the generic handlers which makes it
+     * the reference to lockstep them against. Anything else is returned unchanged.
+     */
+    InstructionHandler Core::specializeHandler(InstructionHandler handler, inst_t instruction) {
+        const u8 Rd = extract<BITS(0:4)>(instruction);
+        const u8 Rn = extract<BITS(5:9)>(instruction);
+        const u8 Rm = extract<BITS(16:20)>(instruction);
+        const bool sf = extract<BITS(31:31)>(instruction);
+        const u8 shift = extract<BITS(22:23)>(instruction);
+
+        // Register 31 is SP for the immediate forms, those never take ZeroFirst
+        const auto getRegisterOperands = [&] {
+            if (Rm == 31 || (Rn == 31 && Rd == 31))
+                return Operands::Generic;
+            else if (Rn == 31)
+                return Operands::ZeroFirst;
+            else if (Rd == 31)
+                return Operands::DiscardResult;
+            else
+                return Operands::Direct;
+        };
+
+        if (handler == &Core::ADD_IMMEDIATE || handler == &Core::ADDS_IMMEDIATE || handler == &Core::SUB_IMMEDIATE || handler == &Core::SUBS_IMMEDIATE) {
+            static constexpr std::array variants = []<size_t... I>(std::index_sequence<I...>) {
+                return std::array { &Core::ADD_SUB_IMMEDIATE<bool(I & 1), bool(I & 2), bool(I & 4), bool(I & 8), Operands(I >> 4)>... };
+            }(std::make_index_sequence<48>());
+
+            const bool subtract = handler == &Core::SUB_IMMEDIATE || handler == &Core::SUBS_IMMEDIATE;
+            const bool setFlags = handler == &Core::ADDS_IMMEDIATE || handler == &Core::SUBS_IMMEDIATE;
+
+            auto operands = Operands::Generic;
+            if (Rn != 31 && Rd != 31)
+                operands = Operands::Direct;
+            else if (Rn != 31 && setFlags)
+                operands = Operands::DiscardResult;
+
+            return variants[subtract | setFlags << 1 | sf << 2 | (shift == 0b01) << 3 | u8(operands) << 4];
+        }
+
+        if (handler == &Core::ADD_SHIFTED_REGISTER || handler == &Core::SUB_SHIFTED_REGISTER || handler == &Core::SUBS_SHIFTED_REGISTER) {
+            static constexpr std::array variants = []<size_t... I>(std::index_sequence<I...>) {
+                return std::array { &Core::ADD_SUB_SHIFTED_REGISTER<bool(I & 1), bool(I & 2), bool(I & 4), u8((I >> 3) & 3), Operands(I >> 5)>... };
+            }(std::make_index_sequence<128>());
+
+            const bool subtract = handler != &Core::ADD_SHIFTED_REGISTER;
+            const bool setFlags = handler == &Core::SUBS_SHIFTED_REGISTER;
+
+            return variants[subtract | setFlags << 1 | sf << 2 | shift << 3 | u8(getRegisterOperands()) << 5];
+        }
+
+        if (handler == &Core::AND_SHIFTED_REGISTER || handler == &Core::ORR_SHIFTED_REGISTER || handler == &Core::ANDS_SHIFTED_REGISTER) {
+            static constexpr std::array variants = []<size_t... I>(std::index_sequence<I...>) {
+                return std::array { &Core::LOGICAL_SHIFTED_REGISTER<u8(I & 3), bool(I & 4), u8((I >> 3) & 3), Operands(I >> 5)>... };
+            }(std::make_index_sequence<128>());
+
+            const u8 opc = extract<BITS(29:30)>(instruction);
+
+            return variants[opc | sf << 2 | shift << 3 | u8(getRegisterOperands()) << 5];
+        }
+
+        return handler;
+    }
+
+}
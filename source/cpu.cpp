@@ -1,10 +1,27 @@
 #include "cpu.hpp"
 
+#include <limits>
+
 namespace arm {
 
     Cpu::Cpu(u8 numCores) : m_numCores(numCores) {
+        // Cores are handed out by reference and get captured by scheduled events, they must never move
         for (u8 i = 0; i < numCores; i++)
-            this->m_cores.emplace_back(Core(&this->m_addressSpace));
+            this->m_cores.emplace_back(&this->m_addressSpace);
+
+        // Stores to pages blocks were built from invalidate them on every core, whichever core did the store
+        this->m_addressSpace.setCodeWriteHandler([this](addr_t page) {
+            for (auto &core : this->m_cores)
+                core.invalidateCode(page);
+        });
+
+        // Events and inner shareable maintenance operations reach every core
+        for (auto &core : this->m_cores) {
+            core.setBroadcastHandler([this](const std::function<void(Core&)> &operation) {
+                for (auto &core : this->m_cores)
+                    operation(core);
+            });
+        }
     }
 
     Cpu::~Cpu() {
@@ -23,6 +40,23 @@ namespace arm {
             this->m_cores[core].tick();
     }
 
+    void Cpu::run(const Scheduler &scheduler) {
+        for (u8 core = 0; core < this->m_numCores; core++)
+            this->m_cores[core].run(scheduler);
+    }
+
+    vtime_t Cpu::getVirtualTime() const {
+        vtime_t time = std::numeric_limits<vtime_t>::max();
+        for (const auto &core : this->m_cores)
+            time = std::min(time, core.getVirtualTime());
+
+        return time;
+    }
+
+    bool Cpu::isIdle() const {
+        return std::all_of(this->m_cores.begin(), this->m_cores.end(), [](const Core &core) { return core.isIdle(); });
+    }
+
     u8 Cpu::getCoreCount() {
         return this->m_numCores;
     }
@@ -35,4 +69,13 @@ namespace arm {
         this->m_addressSpace.addDevice(device, baseAddress);
     }
 
+    bool Cpu::enableFastmem() {
+        return this->m_addressSpace.enableFastmem();
+    }
+
+    void Cpu::attachScheduler(Scheduler *scheduler) {
+        for (auto &core : this->m_cores)
+            core.attachScheduler(scheduler);
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "devices/gic.hpp"
+
+#include "core.hpp"
+
+namespace arm::dev {
+
+    GIC::CpuInterface::CpuInterface(GIC &gic, u8 coreId) : Device(4_kiB), m_gic(gic), m_coreId(coreId) {
+    }
+
+    u64 GIC::CpuInterface::read(offset_t offset, size_t size) {
+        if (offset + size > this->getSize())
+            Logger::fatal("Tried to access an invalid address at BASE + %016llx!", offset);
+
+        std::scoped_lock lock(this->m_gic.m_mutex);
+        return this->m_gic.readCpuInterface(this->m_coreId, offset);
+    }
+
+    void GIC::CpuInterface::write(offset_t offset, size_t size, u64 value) {
+        if (offset + size > this->getSize())
+            Logger::fatal("Tried to access an invalid address at BASE + %016llx!", offset);
+
+        std::scoped_lock lock(this->m_gic.m_mutex);
+        this->m_gic.writeCpuInterface(this->m_coreId, offset, value);
+    }
+
+
+    GIC::GIC() : Device(4_kiB) {
+    }
+
+    GIC::~GIC() {
+    }
+
+    u8 GIC::connectCore(Core *core) {
+        std::scoped_lock lock(this->m_mutex);
+
+        if (this->m_cpus.size() >= GICMaxCores)
+            Logger::fatal("GIC supports at most %u cores!", GICMaxCores);
+
+        const u8 coreId = this->m_cpus.size();
+        this->m_cpus.emplace_back(core);
+        this->m_cpuInterfaces.push_back(std::make_unique<CpuInterface>(*this, coreId));
+
+        // SGIs are always enabled and edge triggered, PPIs default to level sensitive
+        for (u32 id = 0; id < GICNumSoftwareInterrupts; id++) {
+            this->m_privateInterrupts[coreId][id].enabled = true;
+            this->m_privateInterrupts[coreId][id].edgeTriggered = true;
+        }
+        for (auto &interrupt : this->m_privateInterrupts[coreId])
+            interrupt.targets = 1 << coreId;
+
+        return coreId;
+    }
+
+    GIC::CpuInterface* GIC::getCpuInterface(u8 coreId) {
+        return this->m_cpuInterfaces[coreId].get();
+    }
+
+    void GIC::setLevel(u8 coreId, u32 id, bool level) {
+        std::scoped_lock lock(this->m_mutex);
+
+        auto &interrupt = this->getInterrupt(coreId, id);
+
+        if (level && (!interrupt.level || !interrupt.edgeTriggered))
+            interrupt.pending = true;
+        else if (!level && !interrupt.edgeTriggered)
+            interrupt.pending = false;
+        interrupt.level = level;
+
+        this->update();
+    }
+
+    GIC::Interrupt& GIC::getInterrupt(u8 coreId, u32 id) {
+        if (id < GICNumPrivateInterrupts)
+            return this->m_privateInterrupts[coreId][id];
+        else
+            return this->m_sharedInterrupts[id - GICNumPrivateInterrupts];
+    }
+
+    u8 GIC::getRunningPriority(u8 coreId) {
+        const auto &activeInterrupts = this->m_cpus[coreId].activeInterrupts;
+
+        if (activeInterrupts.empty())
+            return GICIdlePriority;
+        else
+            return this->getInterrupt(coreId, activeInterrupts.back()).priority;
+    }
+
+    std::optional<u32> GIC::getHighestPendingInterrupt(u8 coreId) {
+        std::optional<u32> highest;
+        u8 highestPriority = GICIdlePriority;
+
+        for (u32 id = 0; id < GICNumInterrupts; id++) {
+            const auto &interrupt = this->getInterrupt(coreId, id);
+
+            if (interrupt.enabled && interrupt.pending && !interrupt.active && (interrupt.targets & (1 << coreId)) && interrupt.priority < highestPriority) {
+                highest = id;
+                highestPriority = interrupt.priority;
+            }
+        }
+
+        return highest;
+    }
+
+    void GIC::update() {
+        // Cores only ever look at their pending flag, all the priority logic happens here whenever the state changes
+        for (u8 coreId = 0; coreId < this->m_cpus.size(); coreId++) {
+            const auto &cpu = this->m_cpus[coreId];
+
+            bool signal = false;
+            if (this->m_enabled && cpu.enabled) {
+                if (auto id = this->getHighestPendingInterrupt(coreId); id.has_value()) {
+                    const u8 priority = this->getInterrupt(coreId, *id).priority;
+                    signal = priority < cpu.priorityMask && priority < this->getRunningPriority(coreId);
+                }
+            }
+
+            cpu.core->setInterruptPending(signal);
+        }
+    }
+
+    u64 GIC::read(offset_t offset, size_t size) {
+        if (offset + size > this->getSize())
+            Logger::fatal("Tried to access an invalid address at BASE + %016llx!", offset);
+
+        std::scoped_lock lock(this->m_mutex);
+
+        // Accesses don't carry the requesting core, banked registers always refer to the first one
+        constexpr u8 coreId = 0;
+
+        auto readBits = [&](offset_t base, auto getter) {
+            u64 value = 0;
+            const u32 first = (offset - base) * 8;
+            for (u32 bit = 0; bit < size * 8 && first + bit < GICNumInterrupts; bit++)
+                value |= u64(getter(this->getInterrupt(coreId, first + bit))) << bit;
+
+            return value;
+        };
+
+        auto readBytes = [&](offset_t base, auto getter) {
+            u64 value = 0;
+            const u32 first = offset - base;
+            for (u32 byte = 0; byte < size && first + byte < GICNumInterrupts; byte++)
+                value |= u64(getter(this->getInterrupt(coreId, first + byte))) << (byte * 8);
+
+            return value;
+        };
+
+        if (offset == GICD_CTLR)
+            return this->m_enabled;
+        else if (offset == GICD_TYPER)
+            return (std::max<size_t>(this->m_cpus.size(), 1) - 1) << 5 | (GICNumInterrupts / 32 - 1);
+        else if (offset >= GICD_ISENABLER && offset < GICD_ICENABLER + 0x80)
+            return readBits(offset < GICD_ICENABLER ? GICD_ISENABLER : GICD_ICENABLER, [](const Interrupt &interrupt) { return interrupt.enabled; });
+        else if (offset >= GICD_ISPENDR && offset < GICD_ICPENDR + 0x80)
+            return readBits(offset < GICD_ICPENDR ? GICD_ISPENDR : GICD_ICPENDR, [](const Interrupt &interrupt) { return interrupt.pending; });
+        else if (offset >= GICD_ISACTIVER && offset < GICD_ICACTIVER + 0x80)
+            return readBits(offset < GICD_ICACTIVER ? GICD_ISACTIVER : GICD_ICACTIVER, [](const Interrupt &interrupt) { return interrupt.active; });
+        else if (offset >= GICD_IPRIORITYR && offset < GICD_IPRIORITYR + GICByteBankSize)
+            return readBytes(GICD_IPRIORITYR, [](const Interrupt &interrupt) { return interrupt.priority; });
+        else if (offset >= GICD_ITARGETSR && offset < GICD_ITARGETSR + GICByteBankSize)
+            return readBytes(GICD_ITARGETSR, [](const Interrupt &interrupt) { return interrupt.targets; });
+        else if (offset >= GICD_ICFGR && offset < GICD_ICFGR + GICConfigBankSize) {
+            u64 value = 0;
+            const u32 first = (offset - GICD_ICFGR) * 4;
+            for (u32 id = 0; id < size * 4 && first + id < GICNumInterrupts; id++)
+                value |= u64(this->getInterrupt(coreId, first + id).edgeTriggered) << (id * 2 + 1);
+
+            return value;
+        }
+
+        return 0x00;
+    }
+
+    void GIC::write(offset_t offset, size_t size, u64 value) {
+        if (offset + size > this->getSize())
+            Logger::fatal("Tried to access an invalid address at BASE + %016llx!", offset);
+
+        std::scoped_lock lock(this->m_mutex);
+
+        constexpr u8 coreId = 0;
+
+        auto writeBits = [&](offset_t base, auto setter) {
+            const u32 first = (offset - base) * 8;
+            for (u32 bit = 0; bit < size * 8 && first + bit < GICNumInterrupts; bit++) {
+                if (value & (u64(1) << bit))
+                    setter(this->getInterrupt(coreId, first + bit), first + bit);
+            }
+        };
+
+        auto writeBytes = [&](offset_t base, auto setter) {
+            const u32 first = offset - base;
+            for (u32 byte = 0; byte < size && first + byte < GICNumInterrupts; byte++)
+                setter(this->getInterrupt(coreId, first + byte), first + byte, u8(value >> (byte * 8)));
+        };
+
+        if (offset == GICD_CTLR)
+            this->m_enabled = value & 1;
+        else if (offset >= GICD_ISENABLER && offset < GICD_ISENABLER + 0x80)
+            writeBits(GICD_ISENABLER, [](Interrupt &interrupt, u32) { interrupt.enabled = true; });
+        else if (offset >= GICD_ICENABLER && offset < GICD_ICENABLER + 0x80)
+            writeBits(GICD_ICENABLER, [](Interrupt &interrupt, u32 id) { interrupt.enabled = id < GICNumSoftwareInterrupts; });
+        else if (offset >= GICD_ISPENDR && offset < GICD_ISPENDR + 0x80)
+            writeBits(GICD_ISPENDR, [](Interrupt &interrupt, u32) { interrupt.pending = true; });
+        else if (offset >= GICD_ICPENDR && offset < GICD_ICPENDR + 0x80)
+            writeBits(GICD_ICPENDR, [](Interrupt &interrupt, u32) { interrupt.pending = false; });
+        else if (offset >= GICD_ISACTIVER && offset < GICD_ISACTIVER + 0x80)
+            writeBits(GICD_ISACTIVER, [](Interrupt &interrupt, u32) { interrupt.active = true; });
+        else if (offset >= GICD_ICACTIVER && offset < GICD_ICACTIVER + 0x80)
+            writeBits(GICD_ICACTIVER, [](Interrupt &interrupt, u32) { interrupt.active = false; });
+        else if (offset >= GICD_IPRIORITYR && offset < GICD_IPRIORITYR + GICByteBankSize)
+            writeBytes(GICD_IPRIORITYR, [](Interrupt &interrupt, u32, u8 priority) { interrupt.priority = priority; });
+        else if (offset >= GICD_ITARGETSR && offset < GICD_ITARGETSR + GICByteBankSize)
+            writeBytes(GICD_ITARGETSR, [](Interrupt &interrupt, u32 id, u8 targets) {
+                // Targets of private interrupts are fixed to their own core
+                if (id >= GICNumPrivateInterrupts)
+                    interrupt.targets = targets;
+            });
+        else if (offset >= GICD_ICFGR && offset < GICD_ICFGR + GICConfigBankSize) {
+            const u32 first = (offset - GICD_ICFGR) * 4;
+            for (u32 id = 0; id < size * 4 && first + id < GICNumInterrupts; id++) {
+                if (first + id >= GICNumSoftwareInterrupts)
+                    this->getInterrupt(coreId, first + id).edgeTriggered = value & (u64(1) << (id * 2 + 1));
+            }
+        }
+        else if (offset == GICD_SGIR)
+            this->sendSoftwareInterrupt(coreId, value);
+
+        this->update();
+    }
+
+    void GIC::sendSoftwareInterrupt(u8 sourceCore, u32 value) {
+        const u32 id = extract<BITS(0:3)>(value);
+        const u8 filter = extract<BITS(24:25)>(value);
+
+        u8 targets;
+        switch (filter) {
+            case 0b00: targets = extract<BITS(16:23)>(value); break;
+            case 0b01: targets = ~(1 << sourceCore);           break;
+            case 0b10: targets = 1 << sourceCore;              break;
+            default: return;
+        }
+
+        for (u8 coreId = 0; coreId < this->m_cpus.size(); coreId++) {
+            if (targets & (1 << coreId))
+                this->m_privateInterrupts[coreId][id].pending = true;
+        }
+    }
+
+    u64 GIC::readCpuInterface(u8 coreId, offset_t offset) {
+        auto &cpu = this->m_cpus[coreId];
+
+        switch (offset) {
+            case GICC_CTLR: return cpu.enabled;
+            case GICC_PMR:  return cpu.priorityMask;
+            case GICC_BPR:  return cpu.binaryPoint;
+            case GICC_RPR:  return this->getRunningPriority(coreId);
+            case GICC_HPPIR:
+                return this->getHighestPendingInterrupt(coreId).value_or(GICSpuriousInterrupt);
+            case GICC_IAR: {
+                // Acknowledging moves the interrupt from pending to active and raises the running priority
+                auto id = this->getHighestPendingInterrupt(coreId);
+                if (!id.has_value() || this->getInterrupt(coreId, *id).priority >= std::min(cpu.priorityMask, this->getRunningPriority(coreId)))
+                    return GICSpuriousInterrupt;
+
+                auto &interrupt = this->getInterrupt(coreId, *id);
+                interrupt.pending = false;
+                interrupt.active = true;
+                cpu.activeInterrupts.push_back(*id);
+
+                this->update();
+                return *id;
+            }
+            default:
+                return 0x00;
+        }
+    }
+
+    void GIC::writeCpuInterface(u8 coreId, offset_t offset, u64 value) {
+        auto &cpu = this->m_cpus[coreId];
+
+        switch (offset) {
+            case GICC_CTLR: cpu.enabled = value & 1;   break;
+            case GICC_PMR:  cpu.priorityMask = value;  break;
+            case GICC_BPR:  cpu.binaryPoint = value & 0b111; break;
+            case GICC_EOIR: {
+                const u32 id = extract<BITS(0:9)>(value);
+                if (id >= GICNumInterrupts)
+                    break;
+
+                auto &activeInterrupts = cpu.activeInterrupts;
+                if (auto it = std::find(activeInterrupts.begin(), activeInterrupts.end(), id); it != activeInterrupts.end())
+                    activeInterrupts.erase(it);
+
+                auto &interrupt = this->getInterrupt(coreId, id);
+                interrupt.active = false;
+
+                // Level sensitive sources that are still asserted become pending again straight away
+                if (!interrupt.edgeTriggered && interrupt.level)
+                    interrupt.pending = true;
+                break;
+            }
+            default:
+                break;
+        }
+
+        this->update();
+    }
+
+}
@@ -1,13 +1,51 @@
 #include "devices/memory.hpp"
 
+#include <bit>
+#include <cstring>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
 namespace arm::dev {
 
-    Memory::Memory(size_t size) : Device(size) {
-        this->m_memory = new u8[size];
+    Memory::Memory(size_t size) : Device(size), m_codePages(new std::atomic<u64>[(size / MemoryPageSize + 63) / 64]()) {
+        #if defined(_WIN32)
+            this->m_memory = new u8[size];
+        #else
+            // Shared memory instead of a plain allocation so the fastmem arena can map the same pages again
+            #if defined(__linux__)
+                this->m_fd = memfd_create("archway-memory", MFD_CLOEXEC);
+            #else
+                char name[64];
+                snprintf(name, sizeof(name), "/archway-memory-%d-%p", getpid(), static_cast<void*>(this));
+                this->m_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+                shm_unlink(name);
+            #endif
+
+            if (this->m_fd == -1 || ftruncate(this->m_fd, size) != 0)
+                Logger::fatal("Failed to create a shared memory region of size 0x%lX!", size);
+
+            void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, this->m_fd, 0);
+            if (memory == MAP_FAILED)
+                Logger::fatal("Failed to map a shared memory region of size 0x%lX!", size);
+
+            this->m_memory = static_cast<u8*>(memory);
+        #endif
     }
 
     Memory::~Memory() {
-        delete[] this->m_memory;
+        if (this->m_dirtyPages != nullptr)
+            s_writeTrackingDevices--;
+
+        #if defined(_WIN32)
+            delete[] this->m_memory;
+        #else
+            munmap(this->m_memory, this->getSize());
+            close(this->m_fd);
+        #endif
     }
 
     u64 Memory::read(offset_t offset, size_t size) {
@@ -28,11 +66,180 @@ namespace arm::dev {
         if (size > sizeof(u64))
             Logger::fatal("Tried to write more than 8 bytes: %u!", size);
 
+        this->notifyWrite(offset, size);
         memcpy(&this->m_memory[offset], &value, size);
+
+        if (this->m_dirtyPages != nullptr) [[unlikely]]
+            this->markDirty(offset, size);
+    }
+
+    u8* Memory::getHostPointer(offset_t offset, size_t size, bool write) {
+        if (offset < 0 || offset + size > this->getSize())
+            return nullptr;
+
+        if (write)
+            this->notifyWrite(offset, size);
+
+        return &this->m_memory[offset];
+    }
+
+    // Marking pages dirty before the write could let a collection in between clear them while the old contents are still there
+    void Memory::commitWrite(offset_t offset, size_t size) {
+        if (this->m_dirtyPages != nullptr) [[unlikely]]
+            this->markDirty(offset, size);
+    }
+
+    bool Memory::mirrorAt(u8 *address) {
+        #if defined(_WIN32)
+            return false;
+        #else
+            // Code pages get write protected in the mirror, which only works if host pages are no larger than ours
+            if (sysconf(_SC_PAGESIZE) > long(MemoryPageSize))
+                return false;
+
+            if (mmap(address, this->getSize(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, this->m_fd, 0) == MAP_FAILED)
+                return false;
+
+            this->m_mirror = address;
+            return true;
+        #endif
+    }
+
+    void Memory::markCode(offset_t offset) {
+        const size_t page = offset / MemoryPageSize;
+        const u64 bit = 1ULL << (page % 64);
+
+        if (this->m_codePages[page / 64].fetch_or(bit, std::memory_order_relaxed) & bit)
+            return;
+
+        // Stores through the fastmem arena fault on code pages and come back through write()
+        this->updateMirrorProtection(page);
+    }
+
+    void Memory::notifyWrite(offset_t offset, size_t size) {
+        for (size_t page = offset / MemoryPageSize; page <= (offset + size - 1) / MemoryPageSize; page++) {
+            if (this->m_codePages[page / 64].load(std::memory_order_relaxed) & (1ULL << (page % 64))) [[unlikely]]
+                this->invalidateCode(page);
+        }
+    }
+
+    void Memory::invalidateCode(size_t page) {
+        const u64 bit = 1ULL << (page % 64);
+        if (!(this->m_codePages[page / 64].fetch_and(~bit, std::memory_order_relaxed) & bit))
+            return;
+
+        this->updateMirrorProtection(page);
+
+        if (this->m_codeWriteHandler)
+            this->m_codeWriteHandler(page * MemoryPageSize);
+    }
+
+    void Memory::updateMirrorProtection(size_t page) {
+        #if !defined(_WIN32)
+            if (this->m_mirror == nullptr)
+                return;
+
+            // Pages stay read-only in the mirror while they hold code or while a store to them still has to mark them dirty
+            bool writable = !(this->m_codePages[page / 64].load(std::memory_order_relaxed) & (1ULL << (page % 64)));
+            if (writable && this->m_dirtyPages != nullptr) {
+                const size_t dirtyPage = (page * MemoryPageSize) >> this->m_dirtyPageShift;
+                writable = (1ULL << this->m_dirtyPageShift) >= MemoryPageSize &&
+                           (this->m_dirtyPages[dirtyPage / 64].load(std::memory_order_relaxed) & (1ULL << (dirtyPage % 64)));
+            }
+
+            mprotect(this->m_mirror + page * MemoryPageSize, MemoryPageSize, writable ? PROT_READ | PROT_WRITE : PROT_READ);
+        #endif
+    }
+
+    void Memory::enableDirtyTracking(size_t pageSize) {
+        if (!std::has_single_bit(pageSize))
+            Logger::fatal("Dirty tracking page size 0x%lX is not a power of two!", pageSize);
+
+        const size_t pageCount = (this->getSize() + pageSize - 1) / pageSize;
+
+        if (this->m_dirtyPages == nullptr)
+            s_writeTrackingDevices++;
+
+        this->m_dirtyPageShift = std::countr_zero(pageSize);
+        this->m_dirtyPages.reset(new std::atomic<u64>[(pageCount + 63) / 64]());
+
+        #if !defined(_WIN32)
+            if (this->m_mirror != nullptr)
+                mprotect(this->m_mirror, this->getSize(), PROT_READ);
+        #endif
+    }
+
+    void Memory::disableDirtyTracking() {
+        if (this->m_dirtyPages != nullptr)
+            s_writeTrackingDevices--;
+
+        this->m_dirtyPages.reset();
+
+        #if !defined(_WIN32)
+            if (this->m_mirror == nullptr)
+                return;
+
+            mprotect(this->m_mirror, this->getSize(), PROT_READ | PROT_WRITE);
+            for (size_t word = 0; word < (this->getSize() / MemoryPageSize + 63) / 64; word++) {
+                for (u64 bits = this->m_codePages[word].load(std::memory_order_relaxed); bits != 0; bits &= bits - 1)
+                    this->updateMirrorProtection(word * 64 + std::countr_zero(bits));
+            }
+        #endif
+    }
+
+    void Memory::markDirty(offset_t offset, size_t size) {
+        for (size_t page = offset >> this->m_dirtyPageShift; page <= (offset + size - 1) >> this->m_dirtyPageShift; page++) {
+            const u64 bit = 1ULL << (page % 64);
+
+            // Pages are usually dirty already, a plain load keeps the locked read-modify-write off that path
+            auto &word = this->m_dirtyPages[page / 64];
+            if ((word.load(std::memory_order_relaxed) & bit) || (word.fetch_or(bit, std::memory_order_release) & bit))
+                continue;
+
+            // First store since the last collection, further ones can go straight through the mirror
+            if (this->m_mirror != nullptr && (1ULL << this->m_dirtyPageShift) >= MemoryPageSize) {
+                const size_t first = (page << this->m_dirtyPageShift) / MemoryPageSize;
+                const size_t last = std::min(((page + 1) << this->m_dirtyPageShift), this->getSize()) / MemoryPageSize;
+
+                for (size_t mirrorPage = first; mirrorPage < last; mirrorPage++)
+                    this->updateMirrorProtection(mirrorPage);
+            }
+        }
+    }
+
+    std::vector<offset_t> Memory::collectAndClearDirty() {
+        std::vector<offset_t> result;
+        if (this->m_dirtyPages == nullptr)
+            return result;
+
+        const size_t pageSize = 1ULL << this->m_dirtyPageShift;
+        const size_t wordCount = ((this->getSize() + pageSize - 1) / pageSize + 63) / 64;
+
+        for (size_t word = 0; word < wordCount; word++) {
+            // Most words are clean, so only touch the ones that aren't with a read-modify-write
+            const u64 bits = this->m_dirtyPages[word].load(std::memory_order_acquire);
+            if (bits == 0)
+                continue;
+
+            // Mirror stores have to fault again before the bits go away, otherwise one landing in between is never seen
+            for (u64 remaining = bits; remaining != 0; remaining &= remaining - 1) {
+                const offset_t offset = (word * 64 + std::countr_zero(remaining)) << this->m_dirtyPageShift;
+                result.push_back(offset);
+
+                #if !defined(_WIN32)
+                    if (this->m_mirror != nullptr && pageSize >= MemoryPageSize)
+                        mprotect(this->m_mirror + offset, std::min<size_t>(pageSize, this->getSize() - offset), PROT_READ);
+                #endif
+            }
+
+            this->m_dirtyPages[word].fetch_and(~bits, std::memory_order_acq_rel);
+        }
+
+        return result;
     }
 
     void Memory::load(const std::string &path) {
-        FILE *file = fopen(path.c_str(), "r");
+        FILE *file = fopen(path.c_str(), "rb");
         if (file == nullptr)
             Logger::fatal("File " + path + " cannot be read!");
 
@@ -43,8 +250,14 @@ namespace arm::dev {
         if (fileSize > this->getSize())
             Logger::fatal("File content of size 0x%lX does not fit into memory region of size 0x%lX!", fileSize, this->getSize());
 
+        if (fileSize > 0)
+            this->notifyWrite(0, fileSize);
+
         fread(this->m_memory, 1, fileSize, file);
         fclose(file);
+
+        if (fileSize > 0 && this->m_dirtyPages != nullptr)
+            this->markDirty(0, fileSize);
     }
 
     void Memory::load(const std::initializer_list<inst_t> &instructions) {
@@ -62,7 +275,12 @@ namespace arm::dev {
     void Memory::load(const u8 *data, const size_t size) {
         if (size > this->getSize())
             return;
+        if (size > 0)
+            this->notifyWrite(0, size);
         memcpy(this->m_memory, data, size);
+
+        if (size > 0 && this->m_dirtyPages != nullptr)
+            this->markDirty(0, size);
     }
 
 }
\ No newline at end of file
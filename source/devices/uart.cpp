@@ -1,11 +1,37 @@
 #include "devices/uart.hpp"
 
+#include <fcntl.h>
+#include <cstdlib>
+#include <thread>
+
+#if defined(_WIN32)
+    #include <io.h>
+#else
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
 namespace arm::dev {
 
-    UART::UART() : Device(sizeof(u64)) {
+    UART::UART() : Device(4_kiB), m_outputFd(fileno(stdout)) {
+        this->m_txFifo.reserve(UARTTxFlushThreshold);
     }
 
     UART::~UART() {
+        this->m_scheduler = nullptr;
+
+        #if !defined(_WIN32)
+            // Writes to a pseudo-terminal block until a reader takes them, output nobody reads by now doesn't hold up shutting down
+            if (this->m_pseudoTerminalFd != -1)
+                fcntl(this->m_pseudoTerminalFd, F_SETFL, fcntl(this->m_pseudoTerminalFd, F_GETFL) | O_NONBLOCK);
+        #endif
+
+        this->flush();
+
+        #if !defined(_WIN32)
+            if (this->m_pseudoTerminalFd != -1)
+                close(this->m_pseudoTerminalFd);
+        #endif
     }
 
     u64 UART::read(offset_t offset, size_t size) {
@@ -14,7 +40,34 @@ namespace arm::dev {
         if (size > sizeof(u64))
             Logger::fatal("Tried to read more than 8 bytes: %u", size);
 
-        return 0x00;
+        switch (offset) {
+            case DR: {
+                if (this->m_rxCount == 0)
+                    this->receive();
+                if (this->m_rxCount == 0)
+                    return 0x00;
+
+                u8 value = this->m_rxFifo[this->m_rxHead];
+                this->m_rxHead = (this->m_rxHead + 1) % UARTRxFifoSize;
+                this->m_rxCount--;
+
+                return value;
+            }
+            case FR: {
+                if (this->m_rxCount == 0)
+                    this->receive();
+
+                u32 flags = FR_TXFE;
+                if (this->m_rxCount == 0)
+                    flags |= FR_RXFE;
+                if (this->m_rxCount == UARTRxFifoSize)
+                    flags |= FR_RXFF;
+
+                return flags;
+            }
+            default:
+                return 0x00;
+        }
     }
 
     void UART::write(offset_t offset, size_t size, u64 value) {
@@ -23,7 +76,124 @@ namespace arm::dev {
         if (size > sizeof(u64))
             Logger::fatal("Tried to write more than 8 bytes: %u!", size);
 
-        Logger::info("UART Output: %c", static_cast<char>(value));
+        if (offset != DR)
+            return;
+
+        this->m_txFifo.push_back(static_cast<u8>(value));
+
+        if (this->m_txFifo.size() >= UARTTxFlushThreshold)
+            this->flush();
+        else
+            this->schedulePoll();
+    }
+
+    void UART::setOutput(int fd) {
+        this->flush();
+        this->m_outputFd = fd;
+    }
+
+    // The fd stays blocking, a pseudo-terminal uses the same one for output. Reads only happen once poll() reports input
+    void UART::setInput(int fd) {
+        this->m_inputFd = fd;
+    }
+
+    std::string UART::openPseudoTerminal() {
+        #if defined(_WIN32)
+            Logger::fatal("Pseudo-terminals are not supported on this platform!");
+        #else
+            int fd = posix_openpt(O_RDWR | O_NOCTTY);
+            if (fd == -1 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+                Logger::fatal("Failed to open pseudo-terminal!");
+
+            this->m_pseudoTerminalFd = fd;
+            this->setOutput(fd);
+            this->setInput(fd);
+
+            return ptsname(fd);
+        #endif
+    }
+
+    void UART::attachScheduler(Scheduler *scheduler) {
+        this->m_scheduler = scheduler;
+        this->schedulePoll();
+    }
+
+    void UART::schedulePoll() {
+        // Only keep an event around while there's pending output. Host input is picked up when the guest reads or the idle
+        // board waits for it, so an attached input doesn't keep the board awake
+        if (this->m_scheduler == nullptr || this->m_pollScheduled || this->m_txFifo.empty())
+            return;
+
+        this->m_pollScheduled = true;
+        this->m_scheduler->scheduleIn(UARTPollPeriod, [this] {
+            this->m_pollScheduled = false;
+            this->poll();
+            this->schedulePoll();
+        });
+    }
+
+    void UART::poll() {
+        this->flush();
+        this->receive();
+    }
+
+    void UART::flush() {
+        if (this->m_outputFd == -1) {
+            this->m_txFifo.clear();
+            return;
+        }
+
+        size_t written = 0;
+        while (written < this->m_txFifo.size()) {
+            auto result = ::write(this->m_outputFd, this->m_txFifo.data() + written, this->m_txFifo.size() - written);
+            if (result <= 0)
+                break;
+
+            written += result;
+        }
+
+        // Whatever the host didn't take yet stays queued for the next poll
+        this->m_txFifo.erase(this->m_txFifo.begin(), this->m_txFifo.begin() + written);
+        this->schedulePoll();
+    }
+
+    void UART::receive() {
+        if (this->m_inputFd == -1)
+            return;
+
+        while (this->m_rxCount < UARTRxFifoSize) {
+            #if !defined(_WIN32)
+                pollfd request = { this->m_inputFd, POLLIN, 0 };
+                if (::poll(&request, 1, 0) <= 0 || !(request.revents & POLLIN))
+                    break;
+            #endif
+
+            u8 value;
+            if (::read(this->m_inputFd, &value, 1) != 1)
+                break;
+
+            this->m_rxFifo[(this->m_rxHead + this->m_rxCount) % UARTRxFifoSize] = value;
+            this->m_rxCount++;
+        }
+    }
+
+    void UART::waitForInput(std::chrono::milliseconds timeout) {
+        #if !defined(_WIN32)
+            if (this->m_inputFd != -1 && this->m_rxCount < UARTRxFifoSize) {
+                pollfd request = { this->m_inputFd, POLLIN, 0 };
+                const int result = ::poll(&request, 1, int(timeout.count()));
+                if (result == 0)
+                    return;
+
+                if (result > 0 && (request.revents & POLLIN)) {
+                    this->receive();
+                    return;
+                }
+            }
+        #endif
+
+        // No input to watch, or it hung up without a reader on the other end
+        std::this_thread::sleep_for(timeout);
     }
 
-}
\ No newline at end of file
+}
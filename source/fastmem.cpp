@@ -0,0 +1,210 @@
+#include "fastmem.hpp"
+
+#include <cstring>
+#include <mutex>
+
+#if !defined(_WIN32) && (defined(__x86_64__) || defined(__aarch64__))
+    #define FASTMEM_SUPPORTED
+    #include <csignal>
+    #include <sys/mman.h>
+    #include <ucontext.h>
+#endif
+
+#if defined(FASTMEM_SUPPORTED)
+
+    #if defined(__APPLE__)
+        #define FASTMEM_SYMBOL(name) "_" #name
+    #else
+        #define FASTMEM_SYMBOL(name) #name
+    #endif
+
+    #define FASTMEM_FUNCTION(name) ".p2align 4\n.globl " FASTMEM_SYMBOL(name) "\n" FASTMEM_SYMBOL(name) ":\n"
+
+    /*
+     * Every arena access goes through one of these. The access is the only instruction in here that can fault, and when it
+     * does the signal handler resumes at archway_fastmem_fail instead, which returns false to the caller in its place.
+     */
+    asm(
+        ".text\n"
+        FASTMEM_FUNCTION(archway_fastmem_begin)
+    #if defined(__x86_64__)
+        FASTMEM_FUNCTION(archway_fastmem_read8)   "movzbl (%rdi), %eax\n movq %rax, (%rsi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_read16)  "movzwl (%rdi), %eax\n movq %rax, (%rsi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_read32)  "movl (%rdi), %eax\n movq %rax, (%rsi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_read64)  "movq (%rdi), %rax\n movq %rax, (%rsi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write8)  "movb %sil, (%rdi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write16) "movw %si, (%rdi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write32) "movl %esi, (%rdi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write64) "movq %rsi, (%rdi)\n movl $1, %eax\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_fail)    "xorl %eax, %eax\n ret\n"
+    #else
+        FASTMEM_FUNCTION(archway_fastmem_read8)   "ldrb w2, [x0]\n str x2, [x1]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_read16)  "ldrh w2, [x0]\n str x2, [x1]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_read32)  "ldr w2, [x0]\n str x2, [x1]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_read64)  "ldr x2, [x0]\n str x2, [x1]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write8)  "strb w1, [x0]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write16) "strh w1, [x0]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write32) "str w1, [x0]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_write64) "str x1, [x0]\n mov w0, #1\n ret\n"
+        FASTMEM_FUNCTION(archway_fastmem_fail)    "mov w0, #0\n ret\n"
+    #endif
+        FASTMEM_FUNCTION(archway_fastmem_end)
+    );
+
+    extern "C" {
+        void archway_fastmem_begin();
+        bool archway_fastmem_read8(const u8 *host, u64 *value);
+        bool archway_fastmem_read16(const u8 *host, u64 *value);
+        bool archway_fastmem_read32(const u8 *host, u64 *value);
+        bool archway_fastmem_read64(const u8 *host, u64 *value);
+        bool archway_fastmem_write8(u8 *host, u64 value);
+        bool archway_fastmem_write16(u8 *host, u64 value);
+        bool archway_fastmem_write32(u8 *host, u64 value);
+        bool archway_fastmem_write64(u8 *host, u64 value);
+        bool archway_fastmem_fail();
+        void archway_fastmem_end();
+    }
+
+#endif
+
+namespace arm {
+
+    #if defined(FASTMEM_SUPPORTED)
+
+        namespace {
+
+            std::once_flag s_handlerInstalled;
+            struct sigaction s_previousSegv, s_previousBus;
+
+            // The saved PC isn't declared as uintptr_t on every platform, so it's only ever accessed through memcpy
+            void* getFaultingPC(void *context) {
+                auto uc = static_cast<ucontext_t*>(context);
+
+                #if defined(__APPLE__) && defined(__x86_64__)
+                    return &uc->uc_mcontext->__ss.__rip;
+                #elif defined(__APPLE__)
+                    return &uc->uc_mcontext->__ss.__pc;
+                #elif defined(__x86_64__)
+                    return &uc->uc_mcontext.gregs[REG_RIP];
+                #else
+                    return &uc->uc_mcontext.pc;
+                #endif
+            }
+
+            void forwardSignal(int signal, siginfo_t *info, void *context, const struct sigaction &previous) {
+                if (previous.sa_flags & SA_SIGINFO) {
+                    previous.sa_sigaction(signal, info, context);
+                } else if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN) {
+                    // Returning re-executes the faulting instruction, which then gets the default treatment
+                    sigaction(signal, &previous, nullptr);
+                } else {
+                    previous.sa_handler(signal);
+                }
+            }
+
+            void handleFault(int signal, siginfo_t *info, void *context) {
+                void *savedPC = getFaultingPC(context);
+
+                uintptr_t pc;
+                std::memcpy(&pc, savedPC, sizeof(pc));
+
+                if (pc >= reinterpret_cast<uintptr_t>(&archway_fastmem_begin) && pc < reinterpret_cast<uintptr_t>(&archway_fastmem_end)) {
+                    const uintptr_t failPC = reinterpret_cast<uintptr_t>(&archway_fastmem_fail);
+                    std::memcpy(savedPC, &failPC, sizeof(failPC));
+                    return;
+                }
+
+                forwardSignal(signal, info, context, signal == SIGBUS ? s_previousBus : s_previousSegv);
+            }
+
+            void installFaultHandler() {
+                std::call_once(s_handlerInstalled, [] {
+                    struct sigaction action = { };
+                    action.sa_sigaction = handleFault;
+                    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+                    sigemptyset(&action.sa_mask);
+
+                    sigaction(SIGSEGV, &action, &s_previousSegv);
+                    sigaction(SIGBUS, &action, &s_previousBus);
+                });
+            }
+
+        }
+
+        Fastmem::Fastmem() {
+            void *arena = mmap(nullptr, FastmemArenaSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (arena == MAP_FAILED)
+                Logger::fatal("Failed to reserve %llu bytes of host address space for fastmem!", FastmemArenaSize);
+
+            this->m_arena = static_cast<u8*>(arena);
+            installFaultHandler();
+        }
+
+        Fastmem::~Fastmem() {
+            munmap(this->m_arena, FastmemArenaSize);
+        }
+
+        bool Fastmem::isSupported() {
+            return true;
+        }
+
+        bool Fastmem::map(Device *device, addr_t baseAddress) {
+            if (baseAddress + device->getSize() > FastmemArenaSize)
+                return false;
+
+            return device->mirrorAt(this->m_arena + baseAddress);
+        }
+
+        bool Fastmem::read(addr_t address, size_t size, u64 &value) {
+            if (address >= FastmemArenaSize - sizeof(u64))
+                return false;
+
+            switch (size) {
+                case 1:  return archway_fastmem_read8(this->m_arena + address, &value);
+                case 2:  return archway_fastmem_read16(this->m_arena + address, &value);
+                case 4:  return archway_fastmem_read32(this->m_arena + address, &value);
+                case 8:  return archway_fastmem_read64(this->m_arena + address, &value);
+                default: return false;
+            }
+        }
+
+        bool Fastmem::write(addr_t address, size_t size, u64 value) {
+            if (address >= FastmemArenaSize - sizeof(u64))
+                return false;
+
+            switch (size) {
+                case 1:  return archway_fastmem_write8(this->m_arena + address, value);
+                case 2:  return archway_fastmem_write16(this->m_arena + address, value);
+                case 4:  return archway_fastmem_write32(this->m_arena + address, value);
+                case 8:  return archway_fastmem_write64(this->m_arena + address, value);
+                default: return false;
+            }
+        }
+
+    #else
+
+        Fastmem::Fastmem() {
+            Logger::fatal("Fastmem is not supported on this platform!");
+        }
+
+        Fastmem::~Fastmem() { }
+
+        bool Fastmem::isSupported() {
+            return false;
+        }
+
+        bool Fastmem::map(Device *device, addr_t baseAddress) {
+            return false;
+        }
+
+        bool Fastmem::read(addr_t address, size_t size, u64 &value) {
+            return false;
+        }
+
+        bool Fastmem::write(addr_t address, size_t size, u64 value) {
+            return false;
+        }
+
+    #endif
+
+}
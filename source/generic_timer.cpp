@@ -0,0 +1,112 @@
+#include "generic_timer.hpp"
+
+#include <limits>
+#include <thread>
+
+namespace arm {
+
+    GenericTimer::GenericTimer() : m_epoch(std::chrono::steady_clock::now()) {
+    }
+
+    void GenericTimer::attachScheduler(Scheduler *scheduler) {
+        this->m_scheduler = scheduler;
+    }
+
+    void GenericTimer::setInterruptHandler(InterruptHandler handler) {
+        this->m_interruptHandler = std::move(handler);
+    }
+
+    void GenericTimer::setRealTime(bool realTime) {
+        this->m_realTime = realTime;
+        this->m_epoch = std::chrono::steady_clock::now();
+    }
+
+    u64 GenericTimer::getCounter(vtime_t now) const {
+        if (!this->m_realTime)
+            return now;
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->m_epoch).count();
+        return u64(elapsed) * (GenericTimerFrequency / 1'000'000) / 1'000;
+    }
+
+    u64 GenericTimer::getControl(Channel channel, vtime_t now) const {
+        const auto &comparator = this->m_comparators[u8(channel)];
+
+        u64 control = comparator.control & (CTL_ENABLE | CTL_IMASK);
+        if ((control & CTL_ENABLE) && this->getCounter(now) >= comparator.compareValue)
+            control |= CTL_ISTATUS;
+
+        return control;
+    }
+
+    void GenericTimer::setControl(Channel channel, u64 value, vtime_t now) {
+        this->m_comparators[u8(channel)].control = value & (CTL_ENABLE | CTL_IMASK);
+        this->update(channel, now);
+    }
+
+    u64 GenericTimer::getCompareValue(Channel channel) const {
+        return this->m_comparators[u8(channel)].compareValue;
+    }
+
+    void GenericTimer::setCompareValue(Channel channel, u64 value, vtime_t now) {
+        this->m_comparators[u8(channel)].compareValue = value;
+        this->update(channel, now);
+    }
+
+    u64 GenericTimer::getTimerValue(Channel channel, vtime_t now) const {
+        return u32(this->m_comparators[u8(channel)].compareValue - this->getCounter(now));
+    }
+
+    void GenericTimer::setTimerValue(Channel channel, u64 value, vtime_t now) {
+        // TVAL is a signed 32 bit downcounter relative to the current count
+        this->setCompareValue(channel, this->getCounter(now) + extendSign(value & 0xFFFF'FFFF, 32, 64), now);
+    }
+
+    u64 GenericTimer::getKernelControl() const {
+        return this->m_kernelControl;
+    }
+
+    void GenericTimer::setKernelControl(u64 value) {
+        this->m_kernelControl = value;
+    }
+
+    void GenericTimer::update(Channel channel, vtime_t now) {
+        auto &comparator = this->m_comparators[u8(channel)];
+
+        if (comparator.expiryEvent.has_value()) {
+            this->m_scheduler->cancel(*comparator.expiryEvent);
+            comparator.expiryEvent.reset();
+        }
+
+        const bool enabled = comparator.control & CTL_ENABLE;
+        const u64 counter = this->getCounter(now);
+        const bool expired = enabled && counter >= comparator.compareValue;
+        const bool asserted = expired && !(comparator.control & CTL_IMASK);
+
+        if (asserted != comparator.asserted) {
+            comparator.asserted = asserted;
+            if (this->m_interruptHandler)
+                this->m_interruptHandler(channel, asserted);
+        }
+
+        // Only the next expiry is ever scheduled. In real time mode the distance is just an estimate and gets re-checked once due
+        if (enabled && !expired && this->m_scheduler != nullptr) {
+            const u64 distance = comparator.compareValue - counter;
+            const vtime_t expiry = distance > std::numeric_limits<vtime_t>::max() - now ? std::numeric_limits<vtime_t>::max() : now + distance;
+
+            comparator.expiryEvent = this->m_scheduler->schedule(expiry, [this, channel] {
+                auto &comparator = this->m_comparators[u8(channel)];
+                comparator.expiryEvent.reset();
+
+                // Virtual time got ahead of the host clock, e.g. because the cores are idle. Let the host sleep until the counter catches up
+                if (this->m_realTime) {
+                    const u64 remaining = comparator.compareValue - std::min(comparator.compareValue, this->getCounter(0));
+                    std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(std::chrono::nanoseconds(remaining * 1'000 / (GenericTimerFrequency / 1'000'000)), MaxRealTimeSleep));
+                }
+
+                this->update(channel, this->m_scheduler->getTime());
+            });
+        }
+    }
+
+}
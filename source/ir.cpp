@@ -0,0 +1,319 @@
+#include "ir.hpp"
+
+#include <array>
+#include <numeric>
+#include <optional>
+
+namespace arm::ir {
+
+    namespace {
+
+        constexpr u8 RegisterCount = StackPointer + 1;
+
+        u8 getOperandCount(Opcode opcode) {
+            switch (opcode) {
+                case Opcode::Add:
+                case Opcode::Sub:
+                case Opcode::And:
+                case Opcode::Or:
+                case Opcode::Xor:
+                case Opcode::AddFlags:
+                case Opcode::SubFlags:
+                case Opcode::Store:
+                    return 2;
+                case Opcode::Shl:
+                case Opcode::Lsr:
+                case Opcode::Asr:
+                case Opcode::Ror:
+                case Opcode::LogicFlags:
+                case Opcode::SetRegister:
+                case Opcode::SetFlags:
+                case Opcode::Load:
+                case Opcode::ExitConditional:
+                case Opcode::ExitZero:
+                case Opcode::ExitNotZero:
+                    return 1;
+                default:
+                    return 0;
+            }
+        }
+
+        void remapOperands(Instruction &instruction, const std::vector<u16> &replacement) {
+            const u8 count = getOperandCount(instruction.opcode);
+
+            if (count > 0)
+                instruction.a = replacement[instruction.a];
+            instruction.b = count > 1 ? replacement[instruction.b] : instruction.a;
+        }
+
+        std::vector<u16> getIdentity(const Block &block) {
+            std::vector<u16> replacement(block.instructions.size());
+            std::iota(replacement.begin(), replacement.end(), 0);
+
+            return replacement;
+        }
+
+        void makeConst(Instruction &instruction, u64 value) {
+            instruction = { Opcode::Const, 64, 0, instruction.guest, 0, 0, value };
+        }
+
+    }
+
+    // A register read again after it was read or written already just reuses the value it held then
+    void forwardRegisters(Block &block) {
+        auto replacement = getIdentity(block);
+        std::array<std::optional<u16>, RegisterCount> registers;
+        std::optional<u16> flags;
+
+        for (u16 i = 0; i < block.instructions.size(); i++) {
+            auto &instruction = block.instructions[i];
+            remapOperands(instruction, replacement);
+
+            switch (instruction.opcode) {
+                case Opcode::GetRegister:
+                    if (registers[instruction.reg].has_value()) {
+                        replacement[i] = *registers[instruction.reg];
+                        instruction.opcode = Opcode::Nop;
+                    } else {
+                        registers[instruction.reg] = i;
+                    }
+                    break;
+                case Opcode::SetRegister:
+                    registers[instruction.reg] = instruction.a;
+                    break;
+                case Opcode::GetFlags:
+                    if (flags.has_value()) {
+                        replacement[i] = *flags;
+                        instruction.opcode = Opcode::Nop;
+                    } else {
+                        flags = i;
+                    }
+                    break;
+                case Opcode::SetFlags:
+                    flags = instruction.a;
+                    break;
+                case Opcode::Call:
+                    // Handlers may touch anything
+                    registers = { };
+                    flags.reset();
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Folds operations on constants, which turns MOVZ / MOVK and ADRP / ADD chains into a single constant
+    void propagateConstants(Block &block) {
+        auto replacement = getIdentity(block);
+        const addr_t nextBlock = block.address + block.guestInstructions * InstructionWidth;
+
+        const auto getConstant = [&](u16 value) -> std::optional<u64> {
+            if (block.instructions[value].opcode == Opcode::Const)
+                return block.instructions[value].imm;
+            else
+                return std::nullopt;
+        };
+
+        for (u16 i = 0; i < block.instructions.size(); i++) {
+            auto &instruction = block.instructions[i];
+            remapOperands(instruction, replacement);
+
+            const auto a = getConstant(instruction.a);
+            const auto b = getConstant(instruction.b);
+
+            if (isPure(instruction.opcode)) {
+                if (a.has_value() && b.has_value()) {
+                    makeConst(instruction, evaluate(instruction, *a, *b));
+                    continue;
+                }
+
+                // Identities only hold as is for 64 bit operations, 32 bit ones still have to truncate their operand
+                if (instruction.width != 64)
+                    continue;
+
+                bool identity = false;
+                switch (instruction.opcode) {
+                    case Opcode::Add:
+                    case Opcode::Or:
+                    case Opcode::Xor:
+                        if (a == 0u) {
+                            replacement[i] = instruction.b;
+                            instruction.opcode = Opcode::Nop;
+                            continue;
+                        }
+                        identity = b == 0u;
+                        break;
+                    case Opcode::Sub:
+                        identity = b == 0u;
+                        break;
+                    case Opcode::And:
+                        identity = b == ~0ULL;
+                        break;
+                    case Opcode::Shl:
+                    case Opcode::Lsr:
+                    case Opcode::Asr:
+                    case Opcode::Ror:
+                        identity = instruction.imm == 0;
+                        break;
+                    default:
+                        break;
+                }
+
+                if (identity) {
+                    replacement[i] = instruction.a;
+                    instruction.opcode = Opcode::Nop;
+                }
+            } else if (instruction.opcode == Opcode::ExitConditional && a.has_value()) {
+                instruction = { Opcode::Exit, 64, 0, instruction.guest, 0, 0, conditionHolds(instruction.reg, *a) ? instruction.imm : nextBlock };
+            } else if ((instruction.opcode == Opcode::ExitZero || instruction.opcode == Opcode::ExitNotZero) && a.has_value()) {
+                const bool zero = (instruction.width == 64 ? *a : u32(*a)) == 0;
+                const bool taken = instruction.opcode == Opcode::ExitZero ? zero : !zero;
+
+                instruction = { Opcode::Exit, 64, 0, instruction.guest, 0, 0, taken ? instruction.imm : nextBlock };
+            }
+        }
+    }
+
+    // NZCV written again before anything could have looked at it
+    void eliminateDeadFlags(Block &block) {
+        bool overwritten = false;
+
+        for (auto it = block.instructions.rbegin(); it != block.instructions.rend(); ++it) {
+            if (it->opcode == Opcode::SetFlags) {
+                if (overwritten)
+                    it->opcode = Opcode::Nop;
+                overwritten = true;
+            } else if (it->opcode == Opcode::GetFlags || isSynchronizing(it->opcode)) {
+                overwritten = false;
+            }
+        }
+    }
+
+    // Same for registers. Forwarding already dropped the reads in between, so only synchronizing instructions keep stores alive
+    void eliminateDeadRegisterStores(Block &block) {
+        std::array<bool, RegisterCount> overwritten = { };
+
+        for (auto it = block.instructions.rbegin(); it != block.instructions.rend(); ++it) {
+            if (it->opcode == Opcode::SetRegister) {
+                if (overwritten[it->reg])
+                    it->opcode = Opcode::Nop;
+                overwritten[it->reg] = true;
+            } else if (it->opcode == Opcode::GetRegister) {
+                overwritten[it->reg] = false;
+            } else if (isSynchronizing(it->opcode)) {
+                overwritten = { };
+            }
+        }
+    }
+
+    // Removes values nothing depends on and renumbers the rest
+    void eliminateDeadCode(Block &block) {
+        auto &instructions = block.instructions;
+        std::vector<bool> live(instructions.size());
+
+        for (size_t i = instructions.size(); i-- > 0;) {
+            const auto &instruction = instructions[i];
+            const bool sideEffect = !isPure(instruction.opcode) && instruction.opcode != Opcode::Nop && instruction.opcode != Opcode::Const &&
+                                    instruction.opcode != Opcode::GetRegister && instruction.opcode != Opcode::GetFlags;
+
+            if (!live[i] && !sideEffect)
+                continue;
+
+            live[i] = true;
+
+            const u8 count = getOperandCount(instruction.opcode);
+            if (count > 0)
+                live[instruction.a] = true;
+            if (count > 1)
+                live[instruction.b] = true;
+        }
+
+        std::vector<u16> replacement(instructions.size());
+        u16 count = 0;
+        for (u16 i = 0; i < instructions.size(); i++) {
+            if (!live[i])
+                continue;
+
+            replacement[i] = count;
+            instructions[count] = instructions[i];
+            remapOperands(instructions[count], replacement);
+            count++;
+        }
+
+        instructions.resize(count);
+    }
+
+    /*
+     * Constants and registers read before the first Call become values set up on block entry, register and flag writes
+     * sink down to the next synchronizing instruction and get performed all at once by a WriteBack right in front of it.
+     * Forwarding left no reads of a written register before that point, so moving the writes there changes nothing.
+     */
+    void packForInterpreter(Block &block) {
+        auto &instructions = block.instructions;
+        std::vector<u16> replacement(instructions.size());
+
+        for (u16 i = 0; i < instructions.size(); i++) {
+            if (instructions[i].opcode == Opcode::Const) {
+                replacement[i] = block.constants.size();
+                block.constants.push_back(instructions[i].imm);
+            }
+        }
+
+        bool called = false;
+        for (u16 i = 0; i < instructions.size(); i++) {
+            const auto &instruction = instructions[i];
+
+            if (instruction.opcode == Opcode::GetRegister && !called) {
+                replacement[i] = block.constants.size() + block.inputs.size();
+                block.inputs.push_back(instruction.reg);
+            } else if (instruction.opcode == Opcode::Call) {
+                called = true;
+            }
+        }
+
+        const size_t firstValue = block.constants.size() + block.inputs.size();
+        std::vector<Instruction> packed;
+        std::vector<RegisterWrite> pending;
+
+        called = false;
+        for (u16 i = 0; i < instructions.size(); i++) {
+            auto instruction = instructions[i];
+
+            if (instruction.opcode == Opcode::Const || (instruction.opcode == Opcode::GetRegister && !called))
+                continue;
+
+            remapOperands(instruction, replacement);
+
+            if (instruction.opcode == Opcode::SetRegister || instruction.opcode == Opcode::SetFlags) {
+                pending.push_back({ instruction.opcode == Opcode::SetFlags ? Flags : instruction.reg, instruction.a });
+                continue;
+            }
+
+            if (isSynchronizing(instruction.opcode) && !pending.empty()) {
+                packed.push_back({ Opcode::WriteBack, 64, 0, instruction.guest, u16(block.writes.size()), u16(pending.size()), 0 });
+                block.writes.insert(block.writes.end(), pending.begin(), pending.end());
+                pending.clear();
+            }
+
+            if (instruction.opcode == Opcode::Call)
+                called = true;
+
+            // WriteBack defines no value of its own, so numbering goes by the original instructions
+            replacement[i] = firstValue + packed.size();
+            packed.push_back(instruction);
+        }
+
+        instructions = std::move(packed);
+    }
+
+    void optimize(Block &block) {
+        forwardRegisters(block);
+        propagateConstants(block);
+        eliminateDeadFlags(block);
+        eliminateDeadRegisterStores(block);
+        eliminateDeadCode(block);
+        packForInterpreter(block);
+    }
+
+}
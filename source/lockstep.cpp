@@ -0,0 +1,163 @@
+#include "lockstep.hpp"
+
+namespace arm {
+
+    Lockstep::Lockstep(Board &reference, Board &accelerated, u64 compareInterval)
+        : m_reference(reference), m_accelerated(accelerated), m_compareInterval(compareInterval) {
+
+        if (reference.CPU.getCoreCount() != accelerated.CPU.getCoreCount())
+            Logger::fatal("Lockstep boards have a different number of cores!");
+
+        const u8 coreCount = reference.CPU.getCoreCount();
+        this->m_referenceWrites.resize(coreCount);
+        this->m_acceleratedWrites.resize(coreCount);
+        this->m_lastCompare.resize(coreCount);
+        this->m_lastAgreedPC.resize(coreCount);
+
+        for (u8 coreId = 0; coreId < coreCount; coreId++) {
+            auto &referenceCore = reference.CPU.getCore(coreId);
+            auto &acceleratedCore = accelerated.CPU.getCore(coreId);
+
+            referenceCore.setExecutionEngine(ExecutionEngine::Interpreter);
+            referenceCore.m_memoryWriteLog = &this->m_referenceWrites[coreId];
+            acceleratedCore.m_memoryWriteLog = &this->m_acceleratedWrites[coreId];
+
+            this->m_lastCompare[coreId] = acceleratedCore.getRetiredInstructionCount();
+            this->m_lastAgreedPC[coreId] = acceleratedCore.PC.X;
+        }
+    }
+
+    Lockstep::~Lockstep() {
+        for (u8 coreId = 0; coreId < this->m_reference.CPU.getCoreCount(); coreId++) {
+            this->m_reference.CPU.getCore(coreId).m_memoryWriteLog = nullptr;
+            this->m_accelerated.CPU.getCore(coreId).m_memoryWriteLog = nullptr;
+        }
+    }
+
+    bool Lockstep::step() {
+        if (this->m_diverged)
+            return false;
+
+        bool running = false;
+        for (u8 coreId = 0; coreId < this->m_reference.CPU.getCoreCount(); coreId++) {
+            auto &referenceCore = this->m_reference.CPU.getCore(coreId);
+            auto &acceleratedCore = this->m_accelerated.CPU.getCore(coreId);
+
+            if (acceleratedCore.isHalted() && referenceCore.isHalted())
+                continue;
+
+            // The accelerated engine retires a whole block, the reference interpreter catches up instruction by instruction
+            acceleratedCore.tick();
+            while (!referenceCore.isHalted() && referenceCore.getRetiredInstructionCount() < acceleratedCore.getRetiredInstructionCount())
+                referenceCore.tick();
+
+            const bool halted = acceleratedCore.isHalted() || referenceCore.isHalted();
+            if (halted || acceleratedCore.getRetiredInstructionCount() - this->m_lastCompare[coreId] >= this->m_compareInterval) {
+                if (!this->compare(coreId)) {
+                    this->reportDivergence(coreId);
+                    this->m_diverged = true;
+                    return false;
+                }
+            }
+
+            running = running || !halted;
+        }
+
+        return running;
+    }
+
+    bool Lockstep::run(u64 maxInstructions) {
+        const u64 start = this->m_accelerated.CPU.getCore(0).getRetiredInstructionCount();
+
+        while (this->m_accelerated.CPU.getCore(0).getRetiredInstructionCount() - start < maxInstructions) {
+            if (!this->step())
+                break;
+        }
+
+        return !this->m_diverged;
+    }
+
+    bool Lockstep::hasDiverged() const {
+        return this->m_diverged;
+    }
+
+    bool Lockstep::compare(u8 coreId) {
+        auto &reference = this->m_reference.CPU.getCore(coreId);
+        auto &accelerated = this->m_accelerated.CPU.getCore(coreId);
+
+        bool equal = reference.getRetiredInstructionCount() == accelerated.getRetiredInstructionCount() &&
+                     reference.isHalted() == accelerated.isHalted() &&
+                     reference.PC.X == accelerated.PC.X &&
+                     reference.PSTATE.N == accelerated.PSTATE.N && reference.PSTATE.Z == accelerated.PSTATE.Z &&
+                     reference.PSTATE.C == accelerated.PSTATE.C && reference.PSTATE.V == accelerated.PSTATE.V &&
+                     this->m_referenceWrites[coreId] == this->m_acceleratedWrites[coreId];
+
+        for (u8 R = 0; R < 36 && equal; R++) {
+            if (R != 31)
+                equal = reference.GPR[R].X == accelerated.GPR[R].X;
+        }
+
+        for (u8 R = 0; R < 32 && equal; R++)
+            equal = reference.V[R].D[0] == accelerated.V[R].D[0] && reference.V[R].D[1] == accelerated.V[R].D[1];
+
+        if (equal) {
+            this->m_referenceWrites[coreId].clear();
+            this->m_acceleratedWrites[coreId].clear();
+            this->m_lastCompare[coreId] = accelerated.getRetiredInstructionCount();
+            this->m_lastAgreedPC[coreId] = accelerated.PC.X;
+        }
+
+        return equal;
+    }
+
+    void Lockstep::reportDivergence(u8 coreId) {
+        auto &reference = this->m_reference.CPU.getCore(coreId);
+        auto &accelerated = this->m_accelerated.CPU.getCore(coreId);
+
+        Logger::error("== Lockstep divergence on core %u ==", coreId);
+        Logger::error(" Last agreement after %llu instructions at PC 0x%016llx", this->m_lastCompare[coreId], this->m_lastAgreedPC[coreId]);
+        Logger::error(" Retired: %llu / %llu", reference.getRetiredInstructionCount(), accelerated.getRetiredInstructionCount());
+
+        if (reference.PC.X != accelerated.PC.X)
+            Logger::error(" PC:   0x%016llx / 0x%016llx", reference.PC.X, accelerated.PC.X);
+        if (reference.PSTATE.N != accelerated.PSTATE.N || reference.PSTATE.Z != accelerated.PSTATE.Z ||
+            reference.PSTATE.C != accelerated.PSTATE.C || reference.PSTATE.V != accelerated.PSTATE.V)
+            Logger::error(" NZCV: %u%u%u%u / %u%u%u%u", reference.PSTATE.N, reference.PSTATE.Z, reference.PSTATE.C, reference.PSTATE.V,
+                          accelerated.PSTATE.N, accelerated.PSTATE.Z, accelerated.PSTATE.C, accelerated.PSTATE.V);
+
+        for (u8 R = 0; R < 36; R++) {
+            if (R != 31 && reference.GPR[R].X != accelerated.GPR[R].X)
+                Logger::error(" %s%u: 0x%016llx / 0x%016llx", R < 31 ? "X" : "SP_EL", R < 31 ? R : R - 32, reference.GPR[R].X, accelerated.GPR[R].X);
+        }
+
+        for (u8 R = 0; R < 32; R++) {
+            if (reference.V[R].D[0] != accelerated.V[R].D[0] || reference.V[R].D[1] != accelerated.V[R].D[1])
+                Logger::error(" V%u: 0x%016llx%016llx / 0x%016llx%016llx", R, reference.V[R].D[1], reference.V[R].D[0], accelerated.V[R].D[1], accelerated.V[R].D[0]);
+        }
+
+        const auto &referenceWrites = this->m_referenceWrites[coreId];
+        const auto &acceleratedWrites = this->m_acceleratedWrites[coreId];
+        for (size_t i = 0; i < std::max(referenceWrites.size(), acceleratedWrites.size()); i++) {
+            if (i < referenceWrites.size() && i < acceleratedWrites.size() && referenceWrites[i] == acceleratedWrites[i])
+                continue;
+
+            if (i < referenceWrites.size())
+                Logger::error(" Reference write:   [0x%016llx] <- 0x%016llx (%zu bytes)", referenceWrites[i].address, referenceWrites[i].value, referenceWrites[i].size);
+            if (i < acceleratedWrites.size())
+                Logger::error(" Accelerated write: [0x%016llx] <- 0x%016llx (%zu bytes)", acceleratedWrites[i].address, acceleratedWrites[i].value, acceleratedWrites[i].size);
+            break;
+        }
+
+        Logger::error(" Disassembly:");
+        const addr_t start = this->m_lastAgreedPC[coreId] - std::min<addr_t>(this->m_lastAgreedPC[coreId], LockstepWindowBefore * InstructionWidth);
+        for (addr_t address = start; address <= this->m_lastAgreedPC[coreId] + LockstepWindowAfter * InstructionWidth; address += InstructionWidth) {
+            try {
+                const inst_t instruction = reference.prefetch(address);
+                Logger::error(" %s 0x%016llx: %08x  %s", address == this->m_lastAgreedPC[coreId] ? "->" : "  ", address, instruction, Core::getInstructionName(instruction));
+            } catch (const TranslationFault&) {
+                Logger::error(" %s 0x%016llx: <unmapped>", address == this->m_lastAgreedPC[coreId] ? "->" : "  ", address);
+            }
+        }
+    }
+
+}
@@ -1,17 +1,150 @@
 #include "board.hpp"
+#include "profiler.hpp"
+#include "workloads.hpp"
+#include "devices/uart.hpp"
 
 #include "ui/window.hpp"
 
-int main() {
+#include <memory>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    u64 profileInterval = 0;
+    u64 profileTimerPeriod = 0;
+    std::string symbolPath;
+    std::string statisticsPath;
+    bool statisticsJson = false;
+    std::string workloadDirectory;
+    arm::ExecutionEngine engine = arm::ExecutionEngine::Interpreter;
+    bool lockstep = false;
+    std::string uartOutputPath;
+    bool uartPseudoTerminal = false;
+    bool realTimeTimer = false;
+    bool virtualization = false;
+    bool fastmem = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--profile" && i + 1 < argc)
+            profileInterval = std::stoull(argv[++i]);
+        else if (arg == "--profile-timer" && i + 1 < argc)
+            profileTimerPeriod = std::stoull(argv[++i]);
+        else if (arg == "--symbols" && i + 1 < argc)
+            symbolPath = argv[++i];
+        else if (arg == "--stats" && i + 1 < argc)
+            statisticsPath = argv[++i];
+        else if (arg == "--stats-json")
+            statisticsJson = true;
+        else if (arg == "--workloads" && i + 1 < argc)
+            workloadDirectory = argv[++i];
+        else if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "interpreter")
+                engine = arm::ExecutionEngine::Interpreter;
+            else if (name == "blockcache")
+                engine = arm::ExecutionEngine::BlockCache;
+            else
+                arm::Logger::fatal("Unknown execution engine " + name + "!");
+        }
+        else if (arg == "--lockstep")
+            lockstep = true;
+        else if (arg == "--uart-output" && i + 1 < argc)
+            uartOutputPath = argv[++i];
+        else if (arg == "--uart-pty")
+            uartPseudoTerminal = true;
+        else if (arg == "--realtime-timer")
+            realTimeTimer = true;
+        else if (arg == "--virtualization")
+            virtualization = true;
+        else if (arg == "--fastmem")
+            fastmem = true;
+        else
+            arm::Logger::fatal("Unknown argument " + arg + "!");
+    }
+
+    if (!workloadDirectory.empty()) {
+        bool passed = true;
+
+        printf("%-10s %14s %10s %10s %6s\n", "Workload", "Instructions", "Time [s]", "MIPS", "Result");
+        for (const auto &result : arm::runWorkloads(workloadDirectory, engine, lockstep, fastmem)) {
+            printf("%-10s %14llu %10.3f %10.2f %6s\n", result.name, static_cast<unsigned long long>(result.retiredInstructions),
+                   result.seconds, result.retiredInstructions / result.seconds / 1'000'000.0, result.passed ? "PASS" : "FAIL");
+            passed = passed && result.passed;
+        }
+
+        return passed ? 0 : 1;
+    }
 
     arm::Board board;
-    arm::ui::Window debuggerWindow(board);
+    for (u8 coreId = 0; coreId < board.CPU.getCoreCount(); coreId++) {
+        board.CPU.getCore(coreId).setExecutionEngine(engine);
+        board.CPU.getCore(coreId).getTimer().setRealTime(realTimeTimer);
+        board.CPU.getCore(coreId).enableVirtualization(virtualization);
+    }
+
+    if (fastmem && !board.CPU.enableFastmem())
+        arm::Logger::warn("Fastmem is not supported on this platform, running without it");
+
+    // The cores were already reset in EL1 when the board was built
+    if (virtualization)
+        board.CPU.reset();
+
+    auto uart = arm::Device::as<arm::dev::UART>(board.UART1);
+    FILE *uartOutput = nullptr;
+    if (uartPseudoTerminal)
+        arm::Logger::info("UART1 attached to " + uart->openPseudoTerminal());
+    else if (!uartOutputPath.empty()) {
+        uartOutput = fopen(uartOutputPath.c_str(), "wb");
+        if (uartOutput == nullptr)
+            arm::Logger::fatal("File " + uartOutputPath + " cannot be written!");
 
-    board.powerUp();
+        uart->setOutput(fileno(uartOutput));
+    }
 
-    while(debuggerWindow.update())
-        board.tick();
+    std::vector<std::unique_ptr<arm::Profiler>> profilers;
+    if (profileInterval > 0 || profileTimerPeriod > 0) {
+        for (u8 coreId = 0; coreId < board.CPU.getCoreCount(); coreId++) {
+            auto &profiler = profilers.emplace_back(std::make_unique<arm::Profiler>(profileInterval));
+            if (!symbolPath.empty())
+                profiler->loadSymbols(symbolPath);
+            if (profileTimerPeriod > 0)
+                profiler->startTimer(std::chrono::microseconds(profileTimerPeriod));
+
+            board.CPU.getCore(coreId).attachProfiler(profiler.get());
+        }
+    }
+
+    if (!statisticsPath.empty()) {
+        for (u8 coreId = 0; coreId < board.CPU.getCoreCount(); coreId++)
+            board.CPU.getCore(coreId).enableInstructionStatistics(true);
+    }
+
+    {
+        arm::ui::Window debuggerWindow(board);
+
+        board.powerUp();
+
+        while(debuggerWindow.update())
+            board.tick();
+    }
+
+    if (uartOutput != nullptr) {
+        uart->setOutput(fileno(stdout));
+        fclose(uartOutput);
+    }
+
+    for (u8 coreId = 0; coreId < profilers.size(); coreId++) {
+        board.CPU.getCore(coreId).attachProfiler(nullptr);
+        profilers[coreId]->writeReport("profile_core" + std::to_string(coreId) + ".txt");
+        profilers[coreId]->writeFoldedStacks("profile_core" + std::to_string(coreId) + ".folded");
+    }
+
+    if (!statisticsPath.empty()) {
+        for (u8 coreId = 0; coreId < board.CPU.getCoreCount(); coreId++)
+            board.CPU.getCore(coreId).dumpInstructionStatistics(statisticsPath + ".core" + std::to_string(coreId), statisticsJson);
+    }
 
     return 0;
 }
-
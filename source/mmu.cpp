@@ -0,0 +1,295 @@
+#include "mmu.hpp"
+
+namespace arm {
+
+    Mmu::Mmu(AddressSpace *addressSpace) : m_addressSpace(addressSpace) {
+    }
+
+    void Mmu::configure(u64 sctlr, u64 tcr, u64 ttbr0, u64 ttbr1, u64 hcr, u64 vtcr, u64 vttbr, bool hypervisor) {
+        const bool stage1Enabled = extract<BIT(0)>(sctlr);
+        const bool stage2Enabled = extract<BIT(0)>(hcr);
+        const u64 baseMask = ((u64(1) << PhysicalAddressBits) - 1);
+        const bool regimeChanged = stage1Enabled != this->m_stage1Enabled || tcr != this->m_tcr ||
+                                   stage2Enabled != this->m_stage2Enabled || vtcr != this->m_vtcr;
+        const bool lowerBaseChanged = ((ttbr0 ^ this->m_ttbr[0]) & baseMask) != 0;
+        const bool upperBaseChanged = ((ttbr1 ^ this->m_ttbr[1]) & baseMask) != 0;
+        const bool stage2BaseChanged = ((vttbr ^ this->m_vttbr) & baseMask) != 0;
+
+        // TCR.A1 selects which TTBR holds the ASID, TCR.AS whether it's 8 or 16 bit wide
+        const u16 asidMask = extract<BIT(36)>(tcr) ? 0xFFFF : 0xFF;
+        const u16 asid = ((extract<BIT(22)>(tcr) ? ttbr1 : ttbr0) >> 48) & asidMask;
+        const u16 vmid = stage2Enabled ? (vttbr >> 48) & 0xFF : 0;
+
+        this->m_enabled = !hypervisor && (stage1Enabled || stage2Enabled);
+        this->m_stage1Enabled = stage1Enabled;
+        this->m_stage2Enabled = stage2Enabled;
+        this->m_tcr = tcr;
+        this->m_ttbr[0] = ttbr0;
+        this->m_ttbr[1] = ttbr1;
+        this->m_vtcr = vtcr;
+        this->m_vttbr = vttbr;
+
+        // Switching ASIDs or VMIDs keeps the other contexts' entries around, only new tables under a context still in use drop it
+        if (regimeChanged || upperBaseChanged || (stage2BaseChanged && vmid == this->m_vmid))
+            this->invalidateAll();
+        else if (lowerBaseChanged && asid == this->m_asid && vmid == this->m_vmid)
+            this->invalidateAsid(vmid, asid);
+
+        this->m_asid = asid;
+        this->m_asidMask = asidMask;
+        this->m_vmid = vmid;
+    }
+
+    void Mmu::invalidateAll() {
+        for (auto &set : this->m_entries)
+            for (auto &entry : set)
+                entry.valid = false;
+
+        this->m_cachedShifts = 0;
+        this->notifyInvalidation(std::nullopt, std::nullopt, std::nullopt);
+    }
+
+    void Mmu::invalidateAsid(u16 vmid, u16 asid) {
+        asid &= this->m_asidMask;
+        for (auto &set : this->m_entries) {
+            for (auto &entry : set) {
+                if (!entry.global && entry.asid == asid && entry.vmid == vmid)
+                    entry.valid = false;
+            }
+        }
+
+        this->notifyInvalidation(vmid, asid, std::nullopt);
+    }
+
+    void Mmu::invalidateAddress(u16 vmid, addr_t address, std::optional<u16> asid) {
+        if (asid.has_value())
+            asid = *asid & this->m_asidMask;
+
+        for (u64 shifts = this->m_cachedShifts; shifts != 0; shifts &= shifts - 1) {
+            const u8 shift = std::countr_zero(shifts);
+            const u64 tag = address >> shift;
+
+            for (auto &entry : this->m_entries[tag % TLBSets]) {
+                if (entry.tag != tag || entry.shift != shift || entry.vmid != vmid)
+                    continue;
+
+                if (!asid.has_value() || entry.global || entry.asid == *asid)
+                    entry.valid = false;
+            }
+        }
+
+        this->notifyInvalidation(vmid, asid, address);
+    }
+
+    void Mmu::notifyInvalidation(std::optional<u16> vmid, std::optional<u16> asid, std::optional<addr_t> address) const {
+        if (this->m_invalidationHandler)
+            this->m_invalidationHandler(vmid, asid, address);
+    }
+
+    addr_t Mmu::walk(addr_t address, AccessType access, bool privileged) {
+        this->m_statistics.walks++;
+
+        const u8 required = getRequiredPermission(access, privileged);
+
+        // Without stage 1 the input address is used as the IPA, covering the whole address space with every permission
+        Mapping stage1 = { 64, 0, AllPermissions, true, 0 };
+        if (this->m_stage1Enabled)
+            stage1 = this->walkStage1(address, access);
+
+        if (!(stage1.permissions & required))
+            throw TranslationFault{ address, access, u8(PermissionFaultLevel0 + stage1.level) };
+
+        const u64 stage1Offset = stage1.shift == 64 ? address : address & ((u64(1) << stage1.shift) - 1);
+        const addr_t intermediateAddress = stage1.outputAddress | stage1Offset;
+
+        Mapping stage2 = { 64, 0, AllPermissions, true, 0 };
+        if (this->m_stage2Enabled)
+            stage2 = this->walkStage2(address, intermediateAddress, access, false);
+
+        if (!(stage2.permissions & required))
+            throw TranslationFault{ address, access, u8(PermissionFaultLevel0 + stage2.level), true, false, intermediateAddress };
+
+        const u64 stage2Offset = stage2.shift == 64 ? intermediateAddress : intermediateAddress & ((u64(1) << stage2.shift) - 1);
+        const addr_t physicalAddress = stage2.outputAddress | stage2Offset;
+
+        // The combined entry can only be as large as the smaller of the two mappings
+        Entry entry;
+        entry.valid = true;
+        entry.shift = std::min(stage1.shift, stage2.shift);
+        entry.level = stage1.level;
+        entry.stage2Level = stage2.level;
+        entry.permissions = stage1.permissions;
+        entry.stage2Permissions = stage2.permissions;
+        entry.global = stage1.global;
+        entry.asid = this->m_asid;
+        entry.vmid = this->m_vmid;
+        entry.tag = address >> entry.shift;
+
+        const u64 offsetMask = (u64(1) << entry.shift) - 1;
+        entry.intermediateAddress = intermediateAddress & ~offsetMask;
+        entry.outputAddress = physicalAddress & ~offsetMask;
+
+        const u32 set = entry.tag % TLBSets;
+        this->m_entries[set][this->m_nextVictim[set]] = entry;
+        this->m_nextVictim[set] = (this->m_nextVictim[set] + 1) % TLBWays;
+        this->m_cachedShifts |= u64(1) << entry.shift;
+
+        return physicalAddress;
+    }
+
+    Mmu::Mapping Mmu::walkStage1(addr_t address, AccessType access) {
+        // Bit 55 selects between the lower (TTBR0) and the upper (TTBR1) half of the address space
+        const bool upper = extract<BIT(55)>(address);
+        const u8 regionSize = upper ? extract<BITS(16:21)>(this->m_tcr) : extract<BITS(0:5)>(this->m_tcr);
+        const bool walkDisabled = upper ? extract<BIT(23)>(this->m_tcr) : extract<BIT(7)>(this->m_tcr);
+        const u8 granule = upper ? extract<BITS(30:31)>(this->m_tcr) : extract<BITS(14:15)>(this->m_tcr);
+
+        u8 granuleShift;
+        if (upper)
+            granuleShift = granule == 0b11 ? 16 : 12;
+        else
+            granuleShift = granule == 0b01 ? 16 : 12;
+
+        if ((upper && granule == 0b01) || (!upper && granule == 0b10))
+            Logger::fatal("16KiB translation granule is not supported!");
+
+        // Anything larger than 48 bit gets clamped, 52 bit addressing isn't implemented
+        const u8 inputSize = 64 - std::max<u8>(regionSize, 16);
+        const u64 topBits = address >> inputSize;
+        if (walkDisabled || topBits != (upper ? (u64(-1) >> inputSize) : 0))
+            throw TranslationFault{ address, access, TranslationFaultLevel0 };
+
+        const u8 stride = granuleShift - 3;
+        const u8 startLevel = 4 - (inputSize - granuleShift + stride - 1) / stride;
+        const u64 outputMask = ((u64(1) << PhysicalAddressBits) - 1);
+
+        addr_t table = this->m_ttbr[upper] & outputMask & ~u64(1);
+        bool tableNoEL0 = false, tableReadOnly = false, tableNoExecuteEL0 = false, tableNoExecuteEL1 = false;
+
+        for (u8 level = startLevel; level <= 3; level++) {
+            const u8 shift = granuleShift + stride * (3 - level);
+            const u8 indexBits = level == startLevel ? inputSize - shift : stride;
+            const u64 index = (address >> shift) & ((u64(1) << indexBits) - 1);
+
+            // Table addresses are IPAs themselves once stage 2 is enabled, every level costs a full stage 2 walk
+            addr_t descriptorAddress = table + index * sizeof(u64);
+            if (this->m_stage2Enabled) {
+                const Mapping mapping = this->walkStage2(address, descriptorAddress, AccessType::Read, true);
+                if (!(mapping.permissions & ReadEL1))
+                    throw TranslationFault{ address, access, u8(PermissionFaultLevel0 + mapping.level), true, true, descriptorAddress };
+
+                descriptorAddress = mapping.outputAddress | (descriptorAddress & ((u64(1) << mapping.shift) - 1));
+            }
+
+            const u64 descriptor = this->m_addressSpace->read(descriptorAddress, sizeof(u64));
+            this->m_statistics.descriptorReads++;
+
+            if (!extract<BIT(0)>(descriptor))
+                throw TranslationFault{ address, access, u8(TranslationFaultLevel0 + level) };
+
+            const bool isTable = extract<BIT(1)>(descriptor);
+            if (level < 3 && isTable) {
+                tableNoExecuteEL1 |= extract<BIT(59)>(descriptor);
+                tableNoExecuteEL0 |= extract<BIT(60)>(descriptor);
+                tableNoEL0        |= extract<BIT(61)>(descriptor);
+                tableReadOnly     |= extract<BIT(62)>(descriptor);
+
+                table = descriptor & outputMask & ~((u64(1) << granuleShift) - 1);
+                continue;
+            }
+
+            // Level 3 needs page descriptors, blocks only exist at level 1 and 2 (4KiB) or level 2 (64KiB)
+            const bool blockAllowed = level == 2 || (level == 1 && granuleShift == 12);
+            if ((level == 3 && !isTable) || (level < 3 && !blockAllowed))
+                throw TranslationFault{ address, access, u8(TranslationFaultLevel0 + level) };
+
+            if (!extract<BIT(10)>(descriptor))
+                throw TranslationFault{ address, access, u8(AccessFlagFaultLevel0 + level) };
+
+            const bool readOnly = extract<BIT(7)>(descriptor) || tableReadOnly;
+            const bool accessibleEL0 = extract<BIT(6)>(descriptor) && !tableNoEL0;
+            const bool noExecuteEL1 = extract<BIT(53)>(descriptor) || tableNoExecuteEL1;
+            const bool noExecuteEL0 = extract<BIT(54)>(descriptor) || tableNoExecuteEL0;
+
+            u8 permissions = ReadEL1;
+            if (!readOnly)
+                permissions |= WriteEL1;
+            // EL1 never executes from memory EL0 is allowed to write to
+            if (!noExecuteEL1 && !(accessibleEL0 && !readOnly))
+                permissions |= ExecuteEL1;
+            if (accessibleEL0) {
+                permissions |= ReadEL0;
+                if (!readOnly)
+                    permissions |= WriteEL0;
+                if (!noExecuteEL0)
+                    permissions |= ExecuteEL0;
+            }
+
+            return { shift, level, permissions, !extract<BIT(11)>(descriptor), descriptor & outputMask & ~((u64(1) << shift) - 1) };
+        }
+
+        throw TranslationFault{ address, access, TranslationFaultLevel0 };
+    }
+
+    Mmu::Mapping Mmu::walkStage2(addr_t address, addr_t inputAddress, AccessType access, bool stage1Walk) {
+        this->m_statistics.stage2Walks++;
+
+        const u8 regionSize = extract<BITS(0:5)>(this->m_vtcr);
+        const u8 startLevelSelect = extract<BITS(6:7)>(this->m_vtcr);
+        const u8 granule = extract<BITS(14:15)>(this->m_vtcr);
+
+        if (granule == 0b10)
+            Logger::fatal("16KiB translation granule is not supported!");
+
+        const u8 granuleShift = granule == 0b01 ? 16 : 12;
+        const u8 inputSize = 64 - std::max<u8>(regionSize, 16);
+        if (inputAddress >> inputSize != 0)
+            throw TranslationFault{ address, access, TranslationFaultLevel0, true, stage1Walk, inputAddress };
+
+        // The starting level is given explicitly, tables there may be concatenated and get indexed by all remaining bits
+        const u8 stride = granuleShift - 3;
+        const u8 startLevel = (granuleShift == 12 ? 2 : 3) - std::min<u8>(startLevelSelect, 2);
+        const u64 outputMask = ((u64(1) << PhysicalAddressBits) - 1);
+
+        addr_t table = this->m_vttbr & outputMask & ~u64(1);
+
+        for (u8 level = startLevel; level <= 3; level++) {
+            const u8 shift = granuleShift + stride * (3 - level);
+            const u8 indexBits = level == startLevel ? inputSize - shift : stride;
+            const u64 index = (inputAddress >> shift) & ((u64(1) << indexBits) - 1);
+
+            const u64 descriptor = this->m_addressSpace->read(table + index * sizeof(u64), sizeof(u64));
+            this->m_statistics.descriptorReads++;
+
+            if (!extract<BIT(0)>(descriptor))
+                throw TranslationFault{ address, access, u8(TranslationFaultLevel0 + level), true, stage1Walk, inputAddress };
+
+            const bool isTable = extract<BIT(1)>(descriptor);
+            if (level < 3 && isTable) {
+                table = descriptor & outputMask & ~((u64(1) << granuleShift) - 1);
+                continue;
+            }
+
+            const bool blockAllowed = level == 2 || (level == 1 && granuleShift == 12);
+            if ((level == 3 && !isTable) || (level < 3 && !blockAllowed))
+                throw TranslationFault{ address, access, u8(TranslationFaultLevel0 + level), true, stage1Walk, inputAddress };
+
+            if (!extract<BIT(10)>(descriptor))
+                throw TranslationFault{ address, access, u8(AccessFlagFaultLevel0 + level), true, stage1Walk, inputAddress };
+
+            // S2AP grants reads and writes to both EL0 and EL1, XN covers execution at either
+            u8 permissions = 0;
+            if (extract<BIT(6)>(descriptor))
+                permissions |= ReadEL0 | ReadEL1;
+            if (extract<BIT(7)>(descriptor))
+                permissions |= WriteEL0 | WriteEL1;
+            if (!extract<BIT(54)>(descriptor))
+                permissions |= ExecuteEL0 | ExecuteEL1;
+
+            return { shift, level, permissions, true, descriptor & outputMask & ~((u64(1) << shift) - 1) };
+        }
+
+        throw TranslationFault{ address, access, TranslationFaultLevel0, true, stage1Walk, inputAddress };
+    }
+
+}
@@ -0,0 +1,212 @@
+#include "profiler.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace arm {
+
+    namespace {
+
+        struct Elf64Header {
+            u8  ident[16];
+            u16 type;
+            u16 machine;
+            u32 version;
+            u64 entry;
+            u64 phoff;
+            u64 shoff;
+            u32 flags;
+            u16 ehsize;
+            u16 phentsize;
+            u16 phnum;
+            u16 shentsize;
+            u16 shnum;
+            u16 shstrndx;
+        };
+
+        struct Elf64SectionHeader {
+            u32 name;
+            u32 type;
+            u64 flags;
+            u64 addr;
+            u64 offset;
+            u64 size;
+            u32 link;
+            u32 info;
+            u64 addralign;
+            u64 entsize;
+        };
+
+        struct Elf64Symbol {
+            u32 name;
+            u8  info;
+            u8  other;
+            u16 shndx;
+            u64 value;
+            u64 size;
+        };
+
+        constexpr u32 SHT_SYMTAB = 2;
+        constexpr u8  STT_FUNC = 2;
+        constexpr u8  ELFCLASS64 = 2;
+
+    }
+
+    Profiler::Profiler(u64 sampleInterval) : m_sampleInterval(std::max<u64>(sampleInterval, 1)), m_countdown(m_sampleInterval) {
+        this->m_shadowStack.reserve(MaxShadowStackDepth);
+    }
+
+    Profiler::~Profiler() {
+        this->stopTimer();
+    }
+
+    void Profiler::loadSymbols(const std::string &path) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            Logger::fatal("File " + path + " cannot be read!");
+
+        fseek(file, 0, SEEK_END);
+        size_t fileSize = ftell(file);
+        rewind(file);
+
+        std::vector<u8> data(fileSize);
+        fread(data.data(), 1, fileSize, file);
+        fclose(file);
+
+        Elf64Header header;
+        if (fileSize < sizeof(header) || memcmp(data.data(), "\x7F" "ELF", 4) != 0 || data[4] != ELFCLASS64) {
+            Logger::warn("%s is not an ELF64 file, samples will not be symbolized", path.c_str());
+            return;
+        }
+        memcpy(&header, data.data(), sizeof(header));
+
+        if (header.shoff + u64(header.shnum) * sizeof(Elf64SectionHeader) > fileSize)
+            Logger::fatal("ELF section header table of %s is out of bounds!", path.c_str());
+
+        std::vector<Elf64SectionHeader> sections(header.shnum);
+        memcpy(sections.data(), &data[header.shoff], header.shnum * sizeof(Elf64SectionHeader));
+
+        for (const auto &section : sections) {
+            if (section.type != SHT_SYMTAB || section.link >= sections.size())
+                continue;
+
+            const auto &stringTable = sections[section.link];
+            if (section.offset + section.size > fileSize || stringTable.offset + stringTable.size > fileSize)
+                continue;
+
+            for (u64 offset = 0; offset + sizeof(Elf64Symbol) <= section.size; offset += sizeof(Elf64Symbol)) {
+                Elf64Symbol symbol;
+                memcpy(&symbol, &data[section.offset + offset], sizeof(symbol));
+
+                if ((symbol.info & 0x0F) != STT_FUNC || symbol.name >= stringTable.size)
+                    continue;
+
+                const char *name = reinterpret_cast<const char*>(&data[stringTable.offset + symbol.name]);
+                this->m_symbols.push_back({ symbol.value, symbol.size, std::string(name, strnlen(name, stringTable.size - symbol.name)) });
+            }
+        }
+
+        std::sort(this->m_symbols.begin(), this->m_symbols.end(), [](const Symbol &a, const Symbol &b) { return a.address < b.address; });
+
+        Logger::info("Loaded %zu function symbols from %s", this->m_symbols.size(), path.c_str());
+    }
+
+    void Profiler::startTimer(std::chrono::microseconds period) {
+        this->stopTimer();
+
+        this->m_timerStop = false;
+        this->m_timerRunning = true;
+        this->m_timerThread = std::thread([this, period] {
+            while (!this->m_timerStop.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(period);
+                this->m_timerExpired.store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    void Profiler::stopTimer() {
+        if (!this->m_timerThread.joinable())
+            return;
+
+        this->m_timerStop = true;
+        this->m_timerThread.join();
+        this->m_timerRunning = false;
+    }
+
+    void Profiler::sample(addr_t pc) {
+        this->m_totalSamples++;
+        this->m_histogram[pc]++;
+
+        std::vector<addr_t> stack = this->m_shadowStack;
+        stack.push_back(pc);
+        this->m_stacks[stack]++;
+    }
+
+    std::string Profiler::symbolize(addr_t address) const {
+        auto symbol = std::upper_bound(this->m_symbols.begin(), this->m_symbols.end(), address, [](addr_t address, const Symbol &symbol) { return address < symbol.address; });
+
+        if (symbol != this->m_symbols.begin()) {
+            symbol--;
+            // Symbols without a size extend up to the next symbol
+            if (symbol->size == 0 || address < symbol->address + symbol->size)
+                return symbol->name;
+        }
+
+        char buffer[19];
+        snprintf(buffer, sizeof(buffer), "0x%016llx", static_cast<unsigned long long>(address));
+        return buffer;
+    }
+
+    void Profiler::writeReport(const std::string &path) const {
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr)
+            Logger::fatal("File " + path + " cannot be written!");
+
+        std::map<std::string, u64> functions;
+        for (const auto &[pc, count] : this->m_histogram)
+            functions[this->symbolize(pc)] += count;
+
+        std::vector<std::pair<std::string, u64>> sortedFunctions(functions.begin(), functions.end());
+        std::sort(sortedFunctions.begin(), sortedFunctions.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+
+        std::vector<std::pair<addr_t, u64>> sortedAddresses(this->m_histogram.begin(), this->m_histogram.end());
+        std::sort(sortedAddresses.begin(), sortedAddresses.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+
+        const double total = std::max<u64>(this->m_totalSamples, 1);
+
+        fprintf(file, "== Hot Functions (%llu samples) ==\n", static_cast<unsigned long long>(this->m_totalSamples));
+        for (const auto &[name, count] : sortedFunctions)
+            fprintf(file, "%12llu %6.2f%%  %s\n", static_cast<unsigned long long>(count), count * 100.0 / total, name.c_str());
+
+        fprintf(file, "\n== Hot Addresses ==\n");
+        for (const auto &[pc, count] : sortedAddresses)
+            fprintf(file, "%12llu %6.2f%%  0x%016llx  %s\n", static_cast<unsigned long long>(count), count * 100.0 / total, static_cast<unsigned long long>(pc), this->symbolize(pc).c_str());
+
+        fclose(file);
+    }
+
+    void Profiler::writeFoldedStacks(const std::string &path) const {
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr)
+            Logger::fatal("File " + path + " cannot be written!");
+
+        // Call sites resolve to their caller, the final entry (the sampled PC) to the leaf function
+        std::map<std::string, u64> foldedStacks;
+        for (const auto &[stack, count] : this->m_stacks) {
+            std::string folded;
+            for (const auto &address : stack) {
+                if (!folded.empty())
+                    folded += ';';
+                folded += this->symbolize(address);
+            }
+
+            foldedStacks[folded] += count;
+        }
+
+        for (const auto &[folded, count] : foldedStacks)
+            fprintf(file, "%s %llu\n", folded.c_str(), static_cast<unsigned long long>(count));
+
+        fclose(file);
+    }
+
+}
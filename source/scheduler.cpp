@@ -0,0 +1,70 @@
+#include "scheduler.hpp"
+
+#include <limits>
+
+namespace arm {
+
+    EventId Scheduler::schedule(vtime_t time, Callback callback) {
+        const EventId id = this->m_nextId++;
+
+        time = std::max(time, this->m_time);
+        this->m_deadline = std::min(this->m_deadline, time);
+
+        this->m_events.push({ time, id });
+        this->m_callbacks.emplace(id, std::move(callback));
+
+        return id;
+    }
+
+    EventId Scheduler::scheduleIn(vtime_t delay, Callback callback) {
+        return this->schedule(this->m_time + delay, std::move(callback));
+    }
+
+    void Scheduler::cancel(EventId id) {
+        // The heap entry is dropped lazily once it reaches the top
+        this->m_callbacks.erase(id);
+    }
+
+    void Scheduler::beginQuantum(vtime_t length) {
+        this->m_deadline = std::min(this->getNextEventTime(), this->m_time + length);
+    }
+
+    void Scheduler::advance(vtime_t time) {
+        while (true) {
+            this->discardCancelledEvents();
+            if (this->m_events.empty() || this->m_events.top().time > time)
+                break;
+
+            const Event event = this->m_events.top();
+            this->m_events.pop();
+
+            auto callback = std::move(this->m_callbacks[event.id]);
+            this->m_callbacks.erase(event.id);
+
+            // Callbacks observe their own due time so periodic events can reschedule without drift
+            this->m_time = event.time;
+            callback();
+        }
+
+        this->m_time = std::max(this->m_time, time);
+    }
+
+    vtime_t Scheduler::getTime() const {
+        return this->m_time;
+    }
+
+    vtime_t Scheduler::getNextEventTime() {
+        this->discardCancelledEvents();
+
+        if (this->m_events.empty())
+            return std::numeric_limits<vtime_t>::max();
+        else
+            return this->m_events.top().time;
+    }
+
+    void Scheduler::discardCancelledEvents() {
+        while (!this->m_events.empty() && !this->m_callbacks.contains(this->m_events.top().id))
+            this->m_events.pop();
+    }
+
+}
@@ -0,0 +1,77 @@
+#include "workloads.hpp"
+
+#include "board.hpp"
+#include "lockstep.hpp"
+#include "devices/memory.hpp"
+
+#include <chrono>
+#include <memory>
+
+namespace arm {
+
+    const std::vector<Workload>& getWorkloads() {
+        static const std::vector<Workload> workloads = {
+            { "memcpy", { { 9,  0x1CC2'D70A'AFA7'0DEE }, { 0, 0x2008'0000 } } },
+            { "memset", { { 9,  0x1010'1010'1010'0000 }, { 1, 0x1010'1010'1010'1010 } } },
+            { "crc32",  { { 9,  0x0000'0000'F2C4'402F } } },
+            { "sort",   { { 9,  0x5CF8'D72A'9C07'60A0 } } },
+            { "list",   { { 9,  0xF580'00D2'F8F2'0000 }, { 0, 0x2000'0000 } } },
+            { "fsm",    { { 10, 0x0FEA }, { 11, 0x4CE5 }, { 12, 0x0986 }, { 13, 0x39D0 }, { 14, 0x0259 } } },
+        };
+
+        return workloads;
+    }
+
+    std::vector<WorkloadResult> runWorkloads(const std::string &directory, ExecutionEngine engine, bool lockstep, bool fastmem) {
+        std::vector<WorkloadResult> results;
+
+        for (const auto &workload : getWorkloads()) {
+            Board board;
+            std::unique_ptr<Board> referenceBoard = lockstep ? std::make_unique<Board>() : nullptr;
+
+            for (Board *currBoard : { &board, referenceBoard.get() }) {
+                if (currBoard == nullptr)
+                    continue;
+
+                Device::as<dev::Memory>(currBoard->BROM)->load(directory + "/" + workload.name + ".bin");
+
+                currBoard->CPU.reset();
+                currBoard->CPU.getCore(0).exitDebugMode();
+                currBoard->powerUp();
+            }
+
+            auto &core = board.CPU.getCore(0);
+            core.setExecutionEngine(engine);
+            if (fastmem && !board.CPU.enableFastmem())
+                Logger::warn("Fastmem is not supported on this platform, running without it");
+
+            const u64 startInstructions = core.getRetiredInstructionCount();
+            auto start = std::chrono::steady_clock::now();
+
+            bool passed = true;
+            if (lockstep) {
+                Lockstep checker(*referenceBoard, board);
+                while (checker.step());
+
+                passed = !checker.hasDiverged();
+            } else {
+                while (!core.isHalted())
+                    board.tick();
+            }
+
+            auto end = std::chrono::steady_clock::now();
+
+            for (const auto &[reg, value] : workload.expectedRegisters) {
+                if (core.GPZR(reg).X != value) {
+                    Logger::error("Workload %s: X%u is 0x%016llx, expected 0x%016llx", workload.name, reg, core.GPZR(reg).X, value);
+                    passed = false;
+                }
+            }
+
+            results.push_back({ workload.name, core.getRetiredInstructionCount() - startInstructions, std::chrono::duration<double>(end - start).count(), passed });
+        }
+
+        return results;
+    }
+
+}
@@ -0,0 +1,10 @@
+#!/bin/sh
+# Rebuilds the prebuilt workload images from their sources using the LLVM assembler
+cd "$(dirname "$0")"
+
+for source in *.S; do
+    name="${source%.S}"
+    llvm-mc -triple=aarch64 -filetype=obj "$source" -o "$name.o" &&
+    llvm-objcopy -O binary --only-section=.text "$name.o" "$name.bin"
+    rm -f "$name.o"
+done